@@ -0,0 +1,160 @@
+#ifndef BATTLESHIP_CLIENT_LIB_CLIENT_HPP
+#define BATTLESHIP_CLIENT_LIB_CLIENT_HPP
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ssl.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/beast/http/vector_body.hpp>
+#include <boost/beast/ssl.hpp>
+#include <nlohmann/json.hpp>
+#include "battleship/common/util/num_types.hpp"
+
+namespace battleship {
+	namespace beast = boost::beast;
+	namespace http  = beast::http;
+	namespace net   = boost::asio;
+	namespace ssl   = boost::asio::ssl;
+	using tcp = boost::asio::ip::tcp;
+	using nlohmann::json;
+
+	enum class Transport : u8 {
+		Tls,
+		// Plain HTTP, e.g. to a server behind a TLS terminating proxy
+		Plain
+	};
+
+	struct SslSessionFree {
+		void operator()(SSL_SESSION* session) const {
+			SSL_SESSION_free(session);
+		}
+	};
+
+	// TLS session, which a later connection may resume instead of a full handshake
+	using SslSession = std::unique_ptr<SSL_SESSION, SslSessionFree>;
+
+	// Asynchronous HTTPS (or plain HTTP) client for a single keep-alive connection to the server.
+	// Bodies are CBOR, like everywhere in the protocol.
+	// One request at a time, all calls must be made on the client's executor.
+	// Handlers receive only an error code, the response stays in `response()`
+	// until the next request, so nothing is copied on the way.
+	class Client {
+	public:
+		using Request  = http::request<http::vector_body<u8>>;
+		using Response = http::response<http::vector_body<u8>>;
+
+		// Longer than the longest /status?wait
+		static constexpr std::chrono::seconds TIMEOUT {30};
+
+		Client(const net::any_io_executor& executor, ssl::context& ctx, Transport transport = Transport::Tls);
+
+		// Connects to one of the endpoints & performs the TLS handshake, calls `handler(ec)`
+		template<class Handler>
+		void async_connect(
+			const tcp::resolver::results_type& endpoints,
+			const std::string& host,
+			Handler&& handler
+		) {
+			if (auto ec = set_host(host)) {
+				return handler(ec);
+			}
+			beast::get_lowest_layer(stream_).expires_after(TIMEOUT);
+			beast::get_lowest_layer(stream_).async_connect(endpoints, [
+				this, handler = std::forward<Handler>(handler)
+			](beast::error_code ec, const tcp::endpoint&) mutable {
+				if (ec || transport_ == Transport::Plain) { return handler(ec); }
+				beast::get_lowest_layer(stream_).expires_after(TIMEOUT);
+				stream_.async_handshake(ssl::stream_base::client, std::move(handler));
+			});
+		}
+
+		// Sends the request with a CBOR body & reads the response, calls `handler(ec)`
+		template<class Handler>
+		void async_request(
+			http::verb method,
+			std::string_view target,
+			std::vector<u8>&& body,
+			Handler&& handler
+		) {
+			req_ = {};
+			req_.method(method);
+			req_.target({target.data(), target.size()});
+			req_.version(11);
+			req_.set(http::field::host, host_);
+			req_.set(http::field::content_type, "application/cbor");
+			req_.keep_alive(true);
+			req_.body() = std::move(body);
+			req_.prepare_payload();
+
+			beast::get_lowest_layer(stream_).expires_after(TIMEOUT);
+			with_stream([this, &handler](auto& stream) {
+				http::async_write(stream, req_, [
+					this, &stream, handler = std::forward<Handler>(handler)
+				](beast::error_code ec, size_t) mutable {
+					if (ec) { return handler(ec); }
+					res_ = {};
+					http::async_read(stream, buffer_, res_, [
+						handler = std::move(handler)
+					](beast::error_code ec, size_t) mutable {
+						handler(ec);
+					});
+				});
+			});
+		}
+
+		// Same as above, but serializes the body
+		template<class Handler>
+		void async_request(http::verb method, std::string_view target, const json& body, Handler&& handler) {
+			async_request(method, target, json::to_cbor(body), std::forward<Handler>(handler));
+		}
+
+		[[nodiscard]] const Response& response() const {
+			return res_;
+		}
+
+		// Body of the last response, null if it's empty. Throws if it isn't CBOR.
+		[[nodiscard]] json response_json() const;
+
+		// Drops the connection without the TLS shutdown
+		void close();
+
+		// Copy of the session of the connection for `resume()`, null if it can't be resumed.
+		// TLS 1.3 sends tickets after the handshake, so take it after a response.
+		[[nodiscard]] SslSession session();
+
+		// Offers the session in the next handshake, call before `async_connect()`
+		void resume(const SslSession& session);
+
+		// The handshake has resumed the session offered by `resume()`
+		[[nodiscard]] bool session_reused();
+
+	private:
+		beast::ssl_stream<beast::tcp_stream> stream_;
+		Transport transport_;
+		beast::flat_buffer buffer_;
+		std::string host_;
+		Request req_;
+		Response res_;
+
+		// Host header & SNI, the server may host several names
+		beast::error_code set_host(const std::string& host);
+
+		// Calls `f` with the TLS stream or, for plain HTTP, with the TCP stream under it
+		template<class F>
+		void with_stream(F&& f) {
+			if (transport_ == Transport::Tls) {
+				f(stream_);
+			} else {
+				f(beast::get_lowest_layer(stream_));
+			}
+		}
+	};
+} // namespace battleship
+
+#endif //BATTLESHIP_CLIENT_LIB_CLIENT_HPP
@@ -0,0 +1,118 @@
+#ifndef BATTLESHIP_CLIENT_LIB_LOAD_GENERATOR_HPP
+#define BATTLESHIP_CLIENT_LIB_LOAD_GENERATOR_HPP
+
+#include <array>
+#include <chrono>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include "battleship/client_lib/client.hpp"
+#include "battleship/common/bot.hpp"
+#include "battleship/common/common.hpp"
+#include "battleship/common/util/histogram.hpp"
+
+namespace battleship {
+	struct LoadConfig {
+		std::string host {"127.0.0.1"};
+		std::string port {"8443"};
+		// Simulated players, each one has its own keep-alive connection
+		u32 players {1000};
+		u32 threads {std::max(std::thread::hardware_concurrency(), 1U)};
+		std::chrono::seconds duration {30};
+		// Players connect evenly over this time instead of all at once
+		std::chrono::milliseconds ramp_up {1000};
+		// Pause before every shot
+		std::chrono::milliseconds think_time {0};
+		// Play against server bots (/start?bot) instead of each other
+		std::optional<BotLevel> bot;
+		ProtocolVersion version {ProtocolVersion::V2};
+		u64 seed {0};
+		// Plain HTTP for the server's --plain-port
+		Transport transport {Transport::Tls};
+		// Reconnect after that many games to measure handshakes, 0 keeps connections open
+		u32 games_per_connection {0};
+		// Resume the TLS session when reconnecting instead of a full handshake
+		bool resume_sessions {true};
+	};
+
+	enum class Route : u8 {
+		Start,
+		// /status which is answered right away
+		Status,
+		// Long-polled /status, its latency includes waiting for the enemy
+		StatusWait,
+		Shoot,
+		Field,
+		// Not a request: TCP connect & TLS handshake
+		Connect
+	};
+
+	inline constexpr std::array<std::string_view, 6> ROUTE_NAMES {
+		"/start", "/status", "/status?wait", "/shoot", "/field", "connect"
+	};
+
+	struct LoadReport {
+		// Microseconds from sending a request till reading the whole response
+		using Latency = Histogram<>;
+
+		std::array<Latency, ROUTE_NAMES.size()> latency;
+		u64 games {0};
+		// Failed connections & unexpected responses
+		u64 errors {0};
+		// Connections which resumed a TLS session, the rest did full handshakes
+		u64 resumed {0};
+		std::chrono::duration<double> elapsed {0};
+
+		[[nodiscard]] double per_second(u64 count) const {
+			return (elapsed.count() == 0) ? 0.0 : static_cast<double>(count) / elapsed.count();
+		}
+
+		[[nodiscard]] double games_per_second() const {
+			return per_second(games);
+		}
+
+		[[nodiscard]] u64 connections() const {
+			return latency[static_cast<size_t>(Route::Connect)].count();
+		}
+
+		[[nodiscard]] u64 requests() const {
+			u64 total = 0;
+			for (size_t i = 0; i < latency.size(); ++i) {
+				if (i != static_cast<size_t>(Route::Connect)) {
+					total += latency[i].count();
+				}
+			}
+			return total;
+		}
+
+		void merge(const LoadReport& other) {
+			for (size_t i = 0; i < latency.size(); ++i) {
+				latency[i].merge(other.latency[i]);
+			}
+			games += other.games;
+			errors += other.errors;
+			resumed += other.resumed;
+			elapsed = std::max(elapsed, other.elapsed);
+		}
+	};
+
+	// Drives simulated players through /start -> /status -> /shoot -> /field against a server,
+	// game after game on the same connections, & measures latencies per route.
+	// Every thread runs its own io_context with its own players & stats,
+	// so the generator itself doesn't contend for anything.
+	class LoadGenerator {
+	public:
+		explicit LoadGenerator(LoadConfig config);
+
+		// Plays for `duration`, meanwhile calls `progress(games_done)` every second.
+		// Games which aren't finished in time are dropped.
+		LoadReport run(const std::function<void(u64)>& progress = {});
+
+	private:
+		LoadConfig config_;
+	};
+} // namespace battleship
+
+#endif //BATTLESHIP_CLIENT_LIB_LOAD_GENERATOR_HPP
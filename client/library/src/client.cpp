@@ -0,0 +1,55 @@
+#include "battleship/client_lib/client.hpp"
+
+namespace battleship {
+	Client::Client(const net::any_io_executor& executor, ssl::context& ctx, Transport transport):
+		stream_{executor, ctx},
+		transport_{transport} {}
+
+	json Client::response_json() const {
+		return res_.body().empty() ? json{} : json::from_cbor(res_.body());
+	}
+
+	beast::error_code Client::set_host(const std::string& host) {
+		host_ = host;
+		if (transport_ == Transport::Plain) {
+			return {};
+		}
+		// SSL_set_tlsext_host_name() without the C cast of the macro
+		if (SSL_ctrl(
+			stream_.native_handle(),
+			SSL_CTRL_SET_TLSEXT_HOSTNAME,
+			TLSEXT_NAMETYPE_host_name,
+			const_cast<char*>(host_.c_str())
+		) == 0) {
+			return {static_cast<int>(::ERR_get_error()), net::error::get_ssl_category()};
+		}
+		return {};
+	}
+
+	void Client::close() {
+		beast::error_code ec;
+		beast::get_lowest_layer(stream_).socket().close(ec);
+	}
+
+	SslSession Client::session() {
+		if (transport_ == Transport::Plain) {
+			return {};
+		}
+		const SSL_SESSION* live = SSL_get0_session(stream_.native_handle());
+		if (live == nullptr || SSL_SESSION_is_resumable(live) != 1) {
+			return {};
+		}
+		// A copy, as `close()` skips the TLS shutdown & OpenSSL invalidates sessions of such connections
+		return SslSession{SSL_SESSION_dup(live)};
+	}
+
+	void Client::resume(const SslSession& session) {
+		if (transport_ == Transport::Tls && session != nullptr) {
+			SSL_set_session(stream_.native_handle(), session.get());
+		}
+	}
+
+	bool Client::session_reused() {
+		return transport_ == Transport::Tls && SSL_session_reused(stream_.native_handle()) == 1;
+	}
+} // namespace battleship
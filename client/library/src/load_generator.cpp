@@ -0,0 +1,333 @@
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include "battleship/client_lib/client.hpp"
+#include "battleship/client_lib/load_generator.hpp"
+#include "battleship/common/fleet_generator.hpp"
+#include "battleship/common/util/random.hpp"
+
+namespace battleship {
+	namespace {
+		constexpr u8 ROWS = 10;
+		constexpr u8 COLS = 10;
+		using StdFleetGen = FleetGenerator<ROWS, COLS, POST_SOVIET_RULES.size(), POST_SOVIET_RULES>;
+		using StdBot      = Bot<ROWS, COLS, POST_SOVIET_RULES.size(), POST_SOVIET_RULES>;
+
+		// When all of them are hit, the game is won
+		constexpr size_t FLEET_CELLS = [] {
+			size_t cells = 0;
+			for (size_t i = 0; i < POST_SOVIET_RULES.size(); ++i) {
+				cells += (i + 1) * POST_SOVIET_RULES[i];
+			}
+			return cells;
+		}();
+
+		constexpr std::string_view STATUS_WAIT_TARGET = "/status?wait=25";
+		constexpr std::chrono::seconds RECONNECT_DELAY {1};
+
+		struct Worker;
+
+		// Simulated player, a state machine driven by completion handlers.
+		// Plays games one after another on the same connection (or on a new one
+		// every `games_per_connection` games), reconnects after any error.
+		class SimPlayer {
+		public:
+			SimPlayer(Worker& worker, u64 seed);
+
+			void start(std::chrono::steady_clock::duration delay);
+
+		private:
+			using Next = void (SimPlayer::*)();
+
+			Worker& worker_;
+			Xoshiro256 rng_;
+			StdFleetGen fleet_gen_;
+			std::optional<Client> client_;
+			// Of the previous connection, to be resumed by the next one
+			SslSession session_;
+			u32 connection_games_ {0};
+			net::steady_timer timer_;
+			std::optional<StdBot> bot_;
+			std::vector<u8> uuid_;
+			Position shot_ {};
+			size_t hits_ {0};
+
+			void connect();
+			void reconnect();
+			void fail();
+			void record(Route route, std::chrono::steady_clock::time_point sent);
+			void request(Route route, http::verb method, std::string_view target, const json& body, Next next);
+			[[nodiscard]] http::status status() const;
+			[[nodiscard]] json uuid_body() const;
+
+			void new_game();
+			void on_start();
+			void wait_status();
+			void final_status();
+			void on_status();
+			void think_then_shoot();
+			void shoot();
+			void on_shoot();
+			void field();
+			void on_field();
+			void finish_game(bool won);
+		};
+
+		struct Worker {
+			Worker(const LoadConfig& config, ssl::context& ctx, tcp::resolver::results_type endpoints):
+				config{config},
+				ctx{ctx},
+				endpoints{std::move(endpoints)},
+				start_target{config.bot.has_value()
+					? "/start?bot=" + std::string{bot_level_name(*config.bot)}
+					: "/start"}
+			{}
+
+			const LoadConfig& config;
+			ssl::context& ctx;
+			const tcp::resolver::results_type endpoints;
+			const std::string start_target;
+			net::io_context ioc {1};
+			// Destroyed before the io_context
+			std::vector<std::unique_ptr<SimPlayer>> players;
+			LoadReport report;
+			// Copy of report.games for progress reports from another thread
+			std::atomic<u64> games {0};
+		};
+
+		SimPlayer::SimPlayer(Worker& worker, u64 seed):
+			worker_{worker},
+			rng_{seed},
+			fleet_gen_{rng_()},
+			timer_{worker.ioc} {}
+
+		void SimPlayer::start(std::chrono::steady_clock::duration delay) {
+			timer_.expires_after(delay);
+			timer_.async_wait([this](beast::error_code ec) {
+				if (!ec) { connect(); }
+			});
+		}
+
+		void SimPlayer::connect() {
+			client_.emplace(worker_.ioc.get_executor(), worker_.ctx, worker_.config.transport);
+			if (worker_.config.resume_sessions) {
+				client_->resume(session_);
+			}
+			auto sent = std::chrono::steady_clock::now();
+			client_->async_connect(worker_.endpoints, worker_.config.host, [this, sent](beast::error_code ec) {
+				if (ec) { return fail(); }
+				record(Route::Connect, sent);
+				if (client_->session_reused()) {
+					++worker_.report.resumed;
+				}
+				connection_games_ = 0;
+				new_game();
+			});
+		}
+
+		// Drops the connection & opens a new one, resuming the TLS session
+		void SimPlayer::reconnect() {
+			session_ = client_->session();
+			client_->close();
+			connect();
+		}
+
+		void SimPlayer::fail() {
+			++worker_.report.errors;
+			client_->close();
+			start(RECONNECT_DELAY);
+		}
+
+		// Sends the request & calls `next` on success, latency is recorded under `route`
+		void SimPlayer::request(
+			Route route,
+			http::verb method,
+			std::string_view target,
+			const json& body,
+			Next next
+		) {
+			auto sent = std::chrono::steady_clock::now();
+			client_->async_request(method, target, body, [this, route, next, sent](beast::error_code ec) {
+				if (ec) { return fail(); }
+				record(route, sent);
+				try {
+					(this->*next)();
+				} catch (const json::exception&) {
+					fail();
+				}
+			});
+		}
+
+		void SimPlayer::record(Route route, std::chrono::steady_clock::time_point sent) {
+			auto latency = std::chrono::duration_cast<std::chrono::microseconds>(
+				std::chrono::steady_clock::now() - sent
+			);
+			worker_.report.latency[static_cast<size_t>(route)].record(static_cast<u64>(latency.count()));
+		}
+
+		http::status SimPlayer::status() const {
+			return client_->response().result();
+		}
+
+		// /start returns the UUID as a byte string, but other routes read it as an array of bytes
+		json SimPlayer::uuid_body() const {
+			return {{"uuid", uuid_}};
+		}
+
+		void SimPlayer::new_game() {
+			bot_.emplace(BotLevel::Normal, rng_());
+			hits_ = 0;
+			json body = fleet_gen_().ships;
+			body["version"] = worker_.config.version;
+			request(Route::Start, http::verb::post, worker_.start_target, body, &SimPlayer::on_start);
+		}
+
+		void SimPlayer::on_start() {
+			if (status() != http::status::ok) { return fail(); }
+			uuid_ = client_->response_json().at("uuid").get_binary();
+			wait_status();
+		}
+
+		void SimPlayer::wait_status() {
+			request(Route::StatusWait, http::verb::get, STATUS_WAIT_TARGET, uuid_body(), &SimPlayer::on_status);
+		}
+
+		void SimPlayer::final_status() {
+			request(Route::Status, http::verb::get, "/status", uuid_body(), &SimPlayer::on_status);
+		}
+
+		void SimPlayer::on_status() {
+			if (status() == http::status::locked) { return wait_status(); }
+			if (status() != http::status::ok) { return fail(); }
+			// Enemy moves don't matter, the bot sees only its own shots
+			int game_status = client_->response_json().at("status").get<int>();
+			if (game_status == 0) {
+				return think_then_shoot();
+			}
+			// /field answers only the side which has the move, i.e. the winner
+			if (game_status > 0) {
+				return field();
+			}
+			finish_game(false);
+		}
+
+		void SimPlayer::think_then_shoot() {
+			if (worker_.config.think_time.count() == 0) {
+				return shoot();
+			}
+			timer_.expires_after(worker_.config.think_time);
+			timer_.async_wait([this](beast::error_code ec) {
+				if (!ec) { shoot(); }
+			});
+		}
+
+		void SimPlayer::shoot() {
+			shot_ = bot_->next_shot();
+			json body = uuid_body();
+			body["shot"] = {shot_.row, shot_.col};
+			request(Route::Shoot, http::verb::patch, "/shoot", body, &SimPlayer::on_shoot);
+		}
+
+		void SimPlayer::on_shoot() {
+			// The enemy has left
+			if (status() == http::status::gone) { return final_status(); }
+			if (status() != http::status::ok) { return fail(); }
+			bool hit = client_->response_json().at(0).get<bool>();
+			bot_->observe(shot_, hit);
+			if (!hit) {
+				return wait_status();
+			}
+			if (++hits_ == FLEET_CELLS) {
+				return final_status();
+			}
+			think_then_shoot();
+		}
+
+		void SimPlayer::field() {
+			json body = uuid_body();
+			body["version"] = worker_.config.version;
+			// The fleet of /start is revision 0, so only the enemy's shots come back
+			request(Route::Field, http::verb::get, "/field?since=0", body, &SimPlayer::on_field);
+		}
+
+		void SimPlayer::on_field() {
+			if (status() != http::status::ok) { return fail(); }
+			finish_game(true);
+		}
+
+		void SimPlayer::finish_game(bool won) {
+			// Both sides of a game are ours unless it's played against a bot
+			if (won || worker_.config.bot.has_value()) {
+				++worker_.report.games;
+				worker_.games.fetch_add(1, std::memory_order_relaxed);
+			}
+			u32 per_connection = worker_.config.games_per_connection;
+			if (per_connection > 0 && ++connection_games_ >= per_connection) {
+				return reconnect();
+			}
+			new_game();
+		}
+	} // namespace
+
+	LoadGenerator::LoadGenerator(LoadConfig config): config_{std::move(config)} {}
+
+	LoadReport LoadGenerator::run(const std::function<void(u64)>& progress) {
+		// The server is local & its certificate is self-signed
+		ssl::context ctx {ssl::context::tls_client};
+		ctx.set_verify_mode(ssl::verify_none);
+
+		net::io_context resolver_ioc;
+		tcp::resolver resolver {resolver_ioc};
+		auto endpoints = resolver.resolve(config_.host, config_.port);
+
+		u32 thread_count = std::clamp(config_.threads, 1U, std::max(config_.players, 1U));
+		std::vector<std::unique_ptr<Worker>> workers;
+		workers.reserve(thread_count);
+		for (u32 i = 0; i < thread_count; ++i) {
+			workers.push_back(std::make_unique<Worker>(config_, ctx, endpoints));
+		}
+		for (u32 i = 0; i < config_.players; ++i) {
+			Worker& worker = *workers[i % thread_count];
+			auto& player = worker.players.emplace_back(
+				std::make_unique<SimPlayer>(worker, config_.seed ^ (i * 0x9E3779B97F4A7C15ULL))
+			);
+			player->start(config_.ramp_up * i / config_.players);
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		auto deadline = start + config_.duration;
+		std::chrono::duration<double> elapsed {0};
+		{
+			std::vector<std::jthread> threads;
+			threads.reserve(workers.size());
+			for (auto& worker: workers) {
+				threads.emplace_back([&worker] { worker->ioc.run(); });
+			}
+			for (auto now = start; now < deadline; now = std::chrono::steady_clock::now()) {
+				std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(
+					std::chrono::seconds{1}, deadline - now
+				));
+				if (progress) {
+					u64 games = 0;
+					for (const auto& worker: workers) {
+						games += worker->games.load(std::memory_order_relaxed);
+					}
+					progress(games);
+				}
+			}
+			elapsed = std::chrono::steady_clock::now() - start;
+			for (auto& worker: workers) {
+				worker->ioc.stop();
+			}
+		}
+
+		LoadReport total;
+		for (const auto& worker: workers) {
+			total.merge(worker->report);
+		}
+		total.elapsed = elapsed;
+		return total;
+	}
+} // namespace battleship
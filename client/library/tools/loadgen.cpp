@@ -0,0 +1,125 @@
+#include <charconv>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <span>
+#include <string_view>
+#include "battleship/client_lib/load_generator.hpp"
+
+namespace battleship {
+	namespace {
+		void print_usage() {
+			std::cerr << "Usage: battleship-loadgen [options]\n"
+				"    --host HOST      server address (default 127.0.0.1)\n"
+				"    --port PORT      server port (default 8443)\n"
+				"    --players N      concurrent players (default 1000)\n"
+				"    --threads N      client threads (default: all hardware threads)\n"
+				"    --duration S     seconds to run (default 30)\n"
+				"    --ramp-up-ms N   spread connecting over N ms (default 1000)\n"
+				"    --think-ms N     pause before every shot (default 0)\n"
+				"    --bot LEVEL      play against server bots: easy, normal or hard\n"
+				"    --version N      protocol version (default 2)\n"
+				"    --seed N         seed of fleets & shots (default 0)\n"
+				"    --transport T    tls (default) or plain, e.g. for the server's --plain-port\n"
+				"    --games-per-conn N  reconnect after N games to measure handshakes (default 0: never)\n"
+				"    --resume yes|no  resume TLS sessions when reconnecting (default yes)\n";
+		}
+
+		template<typename T>
+		bool parse_number(std::string_view str, T& value) {
+			auto [end, error] = std::from_chars(str.data(), str.data() + str.size(), value);
+			return error == std::errc{} && end == str.data() + str.size();
+		}
+
+		void print_report(const LoadReport& report) {
+			std::cout << std::fixed << std::setprecision(1)
+				<< "games:   " << report.games << '\n'
+				<< "games/s: " << report.games_per_second() << '\n'
+				<< "errors:  " << report.errors << '\n'
+				<< "requests/s:    " << report.per_second(report.requests()) << '\n'
+				<< "connections/s: " << report.per_second(report.connections())
+				<< " (" << report.resumed << " of " << report.connections() << " resumed)\n\n"
+				<< "latency, us     " << std::setw(10) << "requests" << std::setw(10) << "mean"
+				<< std::setw(10) << "p50" << std::setw(10) << "p99"
+				<< std::setw(10) << "p999" << std::setw(10) << "max" << '\n';
+			for (size_t i = 0; i < ROUTE_NAMES.size(); ++i) {
+				const auto& latency = report.latency[i];
+				std::cout << std::left << std::setw(16) << ROUTE_NAMES[i] << std::right
+					<< std::setw(10) << latency.count() << std::setw(10) << latency.mean()
+					<< std::setw(10) << latency.quantile(0.5) << std::setw(10) << latency.quantile(0.99)
+					<< std::setw(10) << latency.quantile(0.999) << std::setw(10) << latency.max() << '\n';
+			}
+		}
+	} // namespace
+
+	int loadgen_main(int argc, char** argv) {
+		const std::span<char*> args {argv, static_cast<size_t>(argc)};
+		LoadConfig config;
+		for (size_t i = 1; i < args.size(); ++i) {
+			std::string_view arg = args[i];
+			if (i + 1 == args.size()) {
+				print_usage();
+				return EXIT_FAILURE;
+			}
+			std::string_view value = args[++i];
+			bool ok = true;
+			u32 number = 0;
+			if (arg == "--host") {
+				config.host = value;
+			} else if (arg == "--port") {
+				config.port = value;
+			} else if (arg == "--players") {
+				ok = parse_number(value, config.players) && config.players > 0;
+			} else if (arg == "--threads") {
+				ok = parse_number(value, config.threads) && config.threads > 0;
+			} else if (arg == "--duration") {
+				ok = parse_number(value, number);
+				config.duration = std::chrono::seconds{number};
+			} else if (arg == "--ramp-up-ms") {
+				ok = parse_number(value, number);
+				config.ramp_up = std::chrono::milliseconds{number};
+			} else if (arg == "--think-ms") {
+				ok = parse_number(value, number);
+				config.think_time = std::chrono::milliseconds{number};
+			} else if (arg == "--bot") {
+				config.bot = bot_level(value);
+				ok = config.bot.has_value();
+			} else if (arg == "--version") {
+				ok = parse_number(value, number) && number > 0;
+				config.version = protocol_version(json{{"version", number}});
+			} else if (arg == "--seed") {
+				ok = parse_number(value, config.seed);
+			} else if (arg == "--transport") {
+				ok = value == "tls" || value == "plain";
+				config.transport = (value == "plain") ? Transport::Plain : Transport::Tls;
+			} else if (arg == "--games-per-conn") {
+				ok = parse_number(value, config.games_per_connection);
+			} else if (arg == "--resume") {
+				ok = value == "yes" || value == "no";
+				config.resume_sessions = value == "yes";
+			} else {
+				ok = false;
+			}
+			if (!ok) {
+				print_usage();
+				return EXIT_FAILURE;
+			}
+		}
+
+		try {
+			LoadGenerator generator {config};
+			auto report = generator.run([](u64 games) {
+				std::cerr << games << " games\n";
+			});
+			print_report(report);
+		} catch (const std::exception& e) {
+			std::cerr << e.what() << '\n';
+			return EXIT_FAILURE;
+		}
+		return EXIT_SUCCESS;
+	}
+} // namespace battleship
+
+int main(int argc, char** argv) {
+	return battleship::loadgen_main(argc, argv);
+}
@@ -0,0 +1,18 @@
+// Instantiates the first SHIP_MASKS_TABLES tables of the ship masks (0 to 2),
+// compiled by ship_masks.sh to measure what the tables cost the compiler
+#include "battleship/common/common.hpp"
+
+namespace battleship {
+#if SHIP_MASKS_TABLES >= 1
+	// 10x10 with ships of 1 to 4 cells, post-soviet rules
+	const void* post_soviet_masks() {
+		return &SHIP_MASKS<10, 10, 4>;
+	}
+#endif
+#if SHIP_MASKS_TABLES >= 2
+	// 10x10 with ships of 2 to 5 cells, american rules
+	const void* american_masks() {
+		return &SHIP_MASKS<10, 10, 5>;
+	}
+#endif
+} // namespace battleship
@@ -0,0 +1,29 @@
+#!/bin/sh
+# Compile-time cost of the constexpr ship mask tables: compiles ship_masks.cpp
+# with 0, 1 & 2 tables & prints the time GCC's -ftime-report gives to constant
+# expression evaluation, the whole compilation & the size of the tables.
+# Usage: ship_masks.sh <c++ compiler> [compiler flags, e.g. -I...]
+set -eu
+
+if [ $# -lt 1 ]; then
+	echo "Usage: $0 <c++ compiler> [compiler flags]" >&2
+	exit 1
+fi
+CXX=$1
+shift
+SOURCE="$(dirname "$0")/ship_masks.cpp"
+OUT=$(mktemp -d)
+trap 'rm -rf "$OUT"' EXIT
+
+"$CXX" --version | head -n 1
+printf '%-8s %16s %12s %14s\n' tables "constexpr eval" "total" ".rodata bytes"
+for tables in 0 1 2; do
+	"$CXX" -std=c++20 -O2 -ftime-report -DSHIP_MASKS_TABLES=$tables "$@" \
+		-c "$SOURCE" -o "$OUT/masks.o" 2> "$OUT/report.txt"
+	# Columns of the report are usr, sys & wall times with their shares, the wall one is shown
+	wall='{ sub(/^[^:]*:/, ""); gsub(/\([^)]*\)/, ""); print $3 }'
+	eval_time=$(awk "/constant expression evaluation/ $wall" "$OUT/report.txt")
+	total_time=$(awk "/TOTAL/ $wall" "$OUT/report.txt")
+	rodata=$(size -A "$OUT/masks.o" | awk '/SHIP_MASKS/ { sum += $2 } END { print sum + 0 }')
+	printf '%-8s %14ss %11ss %14s\n' "$tables" "${eval_time:-0}" "$total_time" "$rodata"
+done
@@ -0,0 +1,23 @@
+#ifndef BATTLESHIP_BENCH_HPP
+#define BATTLESHIP_BENCH_HPP
+
+#include "battleship/common/common.hpp"
+#include "battleship/common/fleet_generator.hpp"
+
+namespace battleship::bench {
+	constexpr u8 ROWS = 10;
+	constexpr u8 COLS = 10;
+
+	using StdGrid  = Grid<ROWS, COLS>;
+	using StdShips = Ships<ROWS, COLS, POST_SOVIET_RULES.size(), POST_SOVIET_RULES>;
+	using StdField = PlayerField<ROWS, COLS, POST_SOVIET_RULES.size(), POST_SOVIET_RULES>;
+	using StdFleetGen = FleetGenerator<ROWS, COLS, POST_SOVIET_RULES.size(), POST_SOVIET_RULES>;
+
+	// Same full field on every run, so results are comparable between releases
+	inline const StdField& sample_field() {
+		static const StdField field = StdFleetGen{42}();
+		return field;
+	}
+} // namespace battleship::bench
+
+#endif //BATTLESHIP_BENCH_HPP
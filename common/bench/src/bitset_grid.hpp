@@ -0,0 +1,64 @@
+#ifndef BATTLESHIP_BENCH_BITSET_GRID_HPP
+#define BATTLESHIP_BENCH_BITSET_GRID_HPP
+
+#include <algorithm>
+#include <bitset>
+#include <optional>
+#include "bench.hpp"
+
+namespace battleship::bench {
+	// Grid as it was before Bitboard: std::bitset with an optional index per cell,
+	// & ship overlaps checked cell by cell. Kept as the baseline of the grid & field benchmarks.
+	class BitsetGrid {
+	public:
+		explicit BitsetGrid(const StdGrid& grid) {
+			for (size_t i = 0; i < StdGrid::SIZE; ++i) {
+				ships_[i] = grid.ship_cells().test(i);
+				shots_[i] = grid.shot_cells().test(i);
+			}
+		}
+
+		bool place_shot(const Position& pos) {
+			std::optional<size_t> i = index(pos);
+			if (i.has_value()) { shots_[*i] = true; }
+			return i.has_value();
+		}
+
+		[[nodiscard]] bool has_ship(const Position& pos) const {
+			std::optional<size_t> i = index(pos);
+			return i.has_value() && ships_[*i];
+		}
+
+		[[nodiscard]] bool all_ships_shot() const {
+			return (ships_ & ~shots_).none();
+		}
+
+		// The ship or its neighbour cells touch a ship
+		[[nodiscard]] bool overlaps(const Ship& ship) const {
+			Rectangle zone {
+				{
+					static_cast<u8>((ship.zone.first.row > 0) ? ship.zone.first.row - 1 : 0),
+					static_cast<u8>((ship.zone.first.col > 0) ? ship.zone.first.col - 1 : 0)
+				},
+				{
+					static_cast<u8>(std::min(ship.zone.last.row + 1, ROWS - 1)),
+					static_cast<u8>(std::min(ship.zone.last.col + 1, COLS - 1))
+				}
+			};
+			return std::any_of(zone.begin(), zone.end(), [this](const auto& pos) { return has_ship(pos); });
+		}
+
+	private:
+		std::bitset<StdGrid::SIZE> ships_;
+		std::bitset<StdGrid::SIZE> shots_;
+
+		static std::optional<size_t> index(const Position& pos) {
+			if (pos.row < ROWS && pos.col < COLS) {
+				return static_cast<size_t>(COLS * pos.row + pos.col);
+			}
+			return {};
+		}
+	};
+} // namespace battleship::bench
+
+#endif //BATTLESHIP_BENCH_BITSET_GRID_HPP
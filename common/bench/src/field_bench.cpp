@@ -0,0 +1,93 @@
+#include <benchmark/benchmark.h>
+#include "battleship/common/bot.hpp"
+#include "bench.hpp"
+#include "bitset_grid.hpp"
+
+namespace battleship::bench {
+	namespace {
+		void field_try_from_ships(benchmark::State& state) {
+			const StdShips& ships = sample_field().ships;
+			for (auto _: state) {
+				auto field = StdField::try_from_ships(StdShips{ships});
+				benchmark::DoNotOptimize(field);
+			}
+			state.SetItemsProcessed(state.iterations() * static_cast<i64>(StdShips::SHIP_COUNT));
+		}
+		BENCHMARK(field_try_from_ships);
+
+		// Every position of a horizontal 2-cell ship against a full field
+		void field_overlaps(benchmark::State& state) {
+			const StdField& field = sample_field();
+			for (auto _: state) {
+				size_t overlaps = 0;
+				for (u8 row = 0; row < ROWS; ++row) {
+					for (u8 col = 0; col + 1 < COLS; ++col) {
+						Ship ship {Rectangle{{row, col}, {row, static_cast<u8>(col + 1)}}};
+						if (field.overlaps(ship)) { ++overlaps; }
+					}
+				}
+				benchmark::DoNotOptimize(overlaps);
+			}
+			state.SetItemsProcessed(state.iterations() * ROWS * (COLS - 1));
+		}
+		BENCHMARK(field_overlaps);
+
+		// The same, cell by cell on the std::bitset grid which Bitboard has replaced
+		void bitset_field_overlaps(benchmark::State& state) {
+			const BitsetGrid grid {sample_field().grid};
+			for (auto _: state) {
+				size_t overlaps = 0;
+				for (u8 row = 0; row < ROWS; ++row) {
+					for (u8 col = 0; col + 1 < COLS; ++col) {
+						Ship ship {Rectangle{{row, col}, {row, static_cast<u8>(col + 1)}}};
+						if (grid.overlaps(ship)) { ++overlaps; }
+					}
+				}
+				benchmark::DoNotOptimize(overlaps);
+			}
+			state.SetItemsProcessed(state.iterations() * ROWS * (COLS - 1));
+		}
+		BENCHMARK(bitset_field_overlaps);
+
+		// Argument is the number of Gibbs sweeps
+		void fleet_generator(benchmark::State& state) {
+			StdFleetGen generate {42, static_cast<u8>(state.range(0))};
+			for (auto _: state) {
+				benchmark::DoNotOptimize(generate());
+			}
+			state.SetItemsProcessed(state.iterations());
+		}
+		BENCHMARK(fleet_generator)->Arg(0)->Arg(1)->Arg(2)->Arg(4);
+
+		// Whole game of a bot against the sample field, per move
+		void bot_game(benchmark::State& state) {
+			using StdBot = Bot<ROWS, COLS, POST_SOVIET_RULES.size(), POST_SOVIET_RULES>;
+			const auto level = static_cast<BotLevel>(state.range(0));
+			u64 seed = 0;
+			i64 moves = 0;
+			for (auto _: state) {
+				StdBot bot {level, seed++};
+				StdGrid grid = sample_field().grid;
+				for (;;) {
+					Position pos = bot.next_shot();
+					grid.place_shot(pos);
+					bool hit = grid.has_ship(pos);
+					bot.observe(pos, hit);
+					++moves;
+					if (hit && grid.all_ships_shot()) {
+						break;
+					}
+				}
+			}
+			state.SetItemsProcessed(moves);
+			state.counters["shots_per_game"] = benchmark::Counter(
+				static_cast<double>(moves) / static_cast<double>(state.iterations())
+			);
+		}
+		BENCHMARK(bot_game)
+			->Arg(static_cast<i64>(BotLevel::Easy))
+			->Arg(static_cast<i64>(BotLevel::Normal))
+			->Arg(static_cast<i64>(BotLevel::Hard))
+			->Unit(benchmark::kMicrosecond);
+	} // namespace
+} // namespace battleship::bench
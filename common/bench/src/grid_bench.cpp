@@ -0,0 +1,107 @@
+#include <benchmark/benchmark.h>
+#include "bench.hpp"
+#include "bitset_grid.hpp"
+
+namespace battleship::bench {
+	namespace {
+		void grid_place_shot(benchmark::State& state) {
+			StdGrid grid = sample_field().grid;
+			for (auto _: state) {
+				for (u8 row = 0; row < ROWS; ++row) {
+					for (u8 col = 0; col < COLS; ++col) {
+						benchmark::DoNotOptimize(grid.place_shot({row, col}));
+					}
+				}
+				benchmark::ClobberMemory();
+			}
+			state.SetItemsProcessed(state.iterations() * static_cast<i64>(StdGrid::SIZE));
+		}
+		BENCHMARK(grid_place_shot);
+
+		void grid_has_ship(benchmark::State& state) {
+			const StdGrid& grid = sample_field().grid;
+			for (auto _: state) {
+				size_t hits = 0;
+				for (u8 row = 0; row < ROWS; ++row) {
+					for (u8 col = 0; col < COLS; ++col) {
+						if (grid.has_ship({row, col})) { ++hits; }
+					}
+				}
+				benchmark::DoNotOptimize(hits);
+			}
+			state.SetItemsProcessed(state.iterations() * static_cast<i64>(StdGrid::SIZE));
+		}
+		BENCHMARK(grid_has_ship);
+
+		void grid_all_ships_shot(benchmark::State& state) {
+			StdGrid grid = sample_field().grid;
+			for (auto _: state) {
+				benchmark::DoNotOptimize(grid.all_ships_shot());
+			}
+		}
+		BENCHMARK(grid_all_ships_shot);
+
+		// The same on the std::bitset grid which Bitboard has replaced
+		void bitset_grid_place_shot(benchmark::State& state) {
+			BitsetGrid grid {sample_field().grid};
+			for (auto _: state) {
+				for (u8 row = 0; row < ROWS; ++row) {
+					for (u8 col = 0; col < COLS; ++col) {
+						benchmark::DoNotOptimize(grid.place_shot({row, col}));
+					}
+				}
+				benchmark::ClobberMemory();
+			}
+			state.SetItemsProcessed(state.iterations() * static_cast<i64>(StdGrid::SIZE));
+		}
+		BENCHMARK(bitset_grid_place_shot);
+
+		void bitset_grid_has_ship(benchmark::State& state) {
+			const BitsetGrid grid {sample_field().grid};
+			for (auto _: state) {
+				size_t hits = 0;
+				for (u8 row = 0; row < ROWS; ++row) {
+					for (u8 col = 0; col < COLS; ++col) {
+						if (grid.has_ship({row, col})) { ++hits; }
+					}
+				}
+				benchmark::DoNotOptimize(hits);
+			}
+			state.SetItemsProcessed(state.iterations() * static_cast<i64>(StdGrid::SIZE));
+		}
+		BENCHMARK(bitset_grid_has_ship);
+
+		void bitset_grid_all_ships_shot(benchmark::State& state) {
+			BitsetGrid grid {sample_field().grid};
+			for (auto _: state) {
+				benchmark::DoNotOptimize(grid.all_ships_shot());
+			}
+		}
+		BENCHMARK(bitset_grid_all_ships_shot);
+
+		// Whole grid, then a ship-sized strip
+		void rectangle_iter(benchmark::State& state) {
+			const Rectangle rect = (state.range(0) == 0) ? StdGrid::RECT : Rectangle{{3, 2}, {3, 5}};
+			for (auto _: state) {
+				size_t sum = 0;
+				for (const Position& pos: rect) {
+					sum += pos.row + pos.col;
+				}
+				benchmark::DoNotOptimize(sum);
+			}
+			state.SetItemsProcessed(state.iterations() * rect.width() * rect.height());
+		}
+		BENCHMARK(rectangle_iter)->Arg(0)->Arg(1);
+
+		void bitboard_nth_set(benchmark::State& state) {
+			const StdGrid::Cells free = ~sample_field().grid.ship_cells();
+			const size_t count = free.count();
+			size_t n = 0;
+			for (auto _: state) {
+				benchmark::DoNotOptimize(free.nth_set(n));
+				n = (n + 1 == count) ? 0 : n + 1;
+			}
+		}
+		BENCHMARK(bitboard_nth_set);
+	} // namespace
+} // namespace battleship::bench
@@ -0,0 +1,75 @@
+#include <vector>
+#include <benchmark/benchmark.h>
+#include "battleship/common/ships_sax.hpp"
+#include "bench.hpp"
+
+namespace battleship::bench {
+	namespace {
+		// Text JSON carries bitsets as "0101..." strings, i.e. protocol v1
+		void field_json_round_trip(benchmark::State& state) {
+			const StdField& field = sample_field();
+			for (auto _: state) {
+				std::string text = field.serialize(ProtocolVersion::V1).dump();
+				auto parsed = json::parse(text).get<StdField>();
+				benchmark::DoNotOptimize(parsed);
+			}
+		}
+		BENCHMARK(field_json_round_trip);
+
+		void field_cbor_round_trip(benchmark::State& state) {
+			const StdField& field = sample_field();
+			for (auto _: state) {
+				std::vector<u8> cbor = json::to_cbor(json(field));
+				auto parsed = json::from_cbor(cbor).get<StdField>();
+				benchmark::DoNotOptimize(parsed);
+			}
+		}
+		BENCHMARK(field_cbor_round_trip);
+
+		// Argument is the protocol version
+		void field_serialize(benchmark::State& state) {
+			const StdField& field = sample_field();
+			const auto version = static_cast<ProtocolVersion>(state.range(0));
+			for (auto _: state) {
+				benchmark::DoNotOptimize(json::to_cbor(field.serialize(version)));
+			}
+		}
+		BENCHMARK(field_serialize)
+			->Arg(static_cast<i64>(ProtocolVersion::V1))
+			->Arg(static_cast<i64>(ProtocolVersion::V2));
+
+		void ships_json_round_trip(benchmark::State& state) {
+			const StdShips& ships = sample_field().ships;
+			for (auto _: state) {
+				std::string text = json(ships).dump();
+				auto parsed = json::parse(text).get<StdShips>();
+				benchmark::DoNotOptimize(parsed);
+			}
+		}
+		BENCHMARK(ships_json_round_trip);
+
+		void ships_cbor_round_trip(benchmark::State& state) {
+			const StdShips& ships = sample_field().ships;
+			for (auto _: state) {
+				std::vector<u8> cbor = json::to_cbor(json(ships));
+				auto parsed = json::from_cbor(cbor).get<StdShips>();
+				benchmark::DoNotOptimize(parsed);
+			}
+		}
+		BENCHMARK(ships_cbor_round_trip);
+
+		// The /start body as the server decodes it, without building a json DOM
+		void ships_cbor_sax(benchmark::State& state) {
+			json body = sample_field().ships;
+			body["version"] = 2;
+			const std::vector<u8> cbor = json::to_cbor(body);
+			for (auto _: state) {
+				StdShips ships;
+				benchmark::DoNotOptimize(ships_from_cbor(cbor, ships));
+				benchmark::DoNotOptimize(ships);
+			}
+			state.SetBytesProcessed(state.iterations() * static_cast<i64>(cbor.size()));
+		}
+		BENCHMARK(ships_cbor_sax);
+	} // namespace
+} // namespace battleship::bench
@@ -24,6 +24,14 @@ option(${PROJECT_NAME}_USE_GOOGLE_MOCK "Use the GoogleMock project for extending
 
 option(${PROJECT_NAME}_USE_CATCH2 "Use the Catch2 project for creating unit tests." OFF)
 
+# Benchmarks
+# Currently supporting: Google Benchmark.
+option(${PROJECT_NAME}_ENABLE_BENCHMARKS "Build microbenchmarks of the hot paths (from the `bench` subfolder)." OFF)
+
+# Logging
+set(${PROJECT_NAME}_LOG_LEVEL "info" CACHE STRING "Log records below this level are compiled out: trace, debug, info, warn, error or off.")
+set_property(CACHE ${PROJECT_NAME}_LOG_LEVEL PROPERTY STRINGS trace debug info warn error off)
+
 # Static analyzers
 # Currently supporting: Clang-Tidy, Cppcheck.
 option(${PROJECT_NAME}_ENABLE_CLANG_TIDY "Enable static analysis with Clang-Tidy." ON)
@@ -0,0 +1,340 @@
+#ifndef BATTLESHIP_BOT_HPP
+#define BATTLESHIP_BOT_HPP
+
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "common.hpp"
+#include "util/random.hpp"
+
+namespace battleship {
+	enum class BotLevel : u8 {
+		// Random cells where a ship still fits, finishes hit ships like Normal
+		Easy,
+		// Cell covered by the most placements of the remaining fleet
+		Normal,
+		// Cell occupied most often in random layouts of the remaining fleet
+		Hard
+	};
+
+	// "easy", "normal" or "hard", nothing otherwise
+	inline std::optional<BotLevel> bot_level(std::string_view name) {
+		if (name == "easy") { return BotLevel::Easy; }
+		if (name == "normal") { return BotLevel::Normal; }
+		if (name == "hard") { return BotLevel::Hard; }
+		return {};
+	}
+
+	// Reverse of `bot_level()`
+	inline std::string_view bot_level_name(BotLevel level) {
+		switch (level) {
+		case BotLevel::Easy: return "easy";
+		case BotLevel::Normal: return "normal";
+		case BotLevel::Hard: return "hard";
+		}
+		return "normal";
+	}
+
+	// Computer player, which sees the enemy's grid only through results of its own shots,
+	// like a human does.
+	// Ships are straight & don't touch each other even by corners, so the bot knows
+	// a ship is sunk when its hits are closed from both ends by misses, known empty cells
+	// or the border, & marks everything around sunk ships & diagonal to hits as empty.
+	// Shots are chosen by probability density over the remaining fleet:
+	// placements allowed by what's known are counted for all cells at once with bitboards
+	// (`ShipMasks::origins()` & `BitCounters`), only through unsunk hits while there are any.
+	// Hard level samples whole random layouts of the remaining fleet instead while hunting,
+	// which accounts for ships crowding each other out, optionally on several threads.
+	template<u8 ROWS, u8 COLS, u8 SHIP_TYPE_COUNT, const std::array<u8, SHIP_TYPE_COUNT>& RULES>
+	class Bot {
+	public:
+		using Cells = typename Grid<ROWS, COLS>::Cells;
+
+		static constexpr u32 DEFAULT_SAMPLES = 64;
+
+		explicit Bot(
+			BotLevel level,
+			u64 seed,
+			u32 samples = DEFAULT_SAMPLES,
+			u32 threads = 1
+		): rng_{seed}, level_{level}, samples_{samples}, threads_{std::max(threads, 1U)} {}
+
+		// Cell to shoot next, never shot before
+		Position next_shot() {
+			Cells candidates = ~(blocked_ | shots_);
+			if (candidates.none()) {
+				// Contradicting results, just shoot anything left
+				candidates = ~shots_;
+			}
+			Cells choice;
+			if (level_ == BotLevel::Hard && hits_.none()) {
+				choice = sample_max(candidates);
+			} else {
+				auto density = placement_density();
+				choice = (level_ == BotLevel::Easy && hits_.none())
+					? density.nonzero() & candidates
+					: density.max_of(candidates);
+			}
+			if ((choice & candidates).none()) {
+				choice = candidates;
+			}
+			choice &= candidates;
+			return Grid<ROWS, COLS>::position(choice.nth_set(rng_.below(static_cast<u32>(choice.count()))));
+		}
+
+		// Learns the result of the shot
+		void observe(const Position& pos, bool hit) {
+			size_t index = Grid<ROWS, COLS>::index(pos);
+			shots_.set(index);
+			if (!hit) {
+				blocked_.set(index);
+				// the miss may close a hit ship
+				for (const Position& neighbour: neighbours(pos)) {
+					if (Grid<ROWS, COLS>::RECT.contains(neighbour)
+						&& hits_.test(Grid<ROWS, COLS>::index(neighbour))) {
+						check_sunk(neighbour);
+					}
+				}
+				return;
+			}
+			hits_.set(index);
+			// A ship doesn't touch others by corners
+			for (int dr: {-1, 1}) {
+				for (int dc: {-1, 1}) {
+					block({static_cast<u8>(pos.row + dr), static_cast<u8>(pos.col + dc)});
+				}
+			}
+			// ... & goes in one direction, so cells aside from a pair of hits are empty
+			auto around = neighbours(pos);
+			for (size_t i = 0; i < around.size(); ++i) {
+				const Position& neighbour = around[i];
+				if (!Grid<ROWS, COLS>::RECT.contains(neighbour)
+					|| !hits_.test(Grid<ROWS, COLS>::index(neighbour))) {
+					continue;
+				}
+				// neighbours are up, down, left, right
+				bool is_vertical = i < 2;
+				for (const Position& cell: {pos, neighbour}) {
+					auto side = neighbours(cell);
+					block(side[is_vertical ? 2 : 0]);
+					block(side[is_vertical ? 3 : 1]);
+				}
+			}
+			check_sunk(pos);
+		}
+
+		// All ships are sunk
+		[[nodiscard]] inline bool is_done() const {
+			return std::all_of(remaining_.begin(), remaining_.end(), [](u8 count) { return count == 0; });
+		}
+
+		[[nodiscard]] inline BotLevel level() const {
+			return level_;
+		}
+
+		[[nodiscard]] inline const Cells& shots() const {
+			return shots_;
+		}
+
+	private:
+		static constexpr const ShipMasks<ROWS, COLS, SHIP_TYPE_COUNT>& MASKS {
+			SHIP_MASKS<ROWS, COLS, SHIP_TYPE_COUNT>
+		};
+		// Enough for placement counts of any reasonable fleet
+		static constexpr size_t DENSITY_PLANES = 8;
+
+		Xoshiro256 rng_;
+		BotLevel level_;
+		u32 samples_;
+		u32 threads_;
+		Cells shots_;
+		// Hits of ships which aren't sunk yet
+		Cells hits_;
+		// Cells which can't have a ship of the remaining fleet:
+		// misses, sunk ships & around them, cells next to hits where a ship can't go
+		Cells blocked_;
+		// Ships which aren't sunk yet by length
+		std::array<u8, SHIP_TYPE_COUNT> remaining_ {RULES};
+
+		// Up, down, left, right, may be out of the grid
+		static std::array<Position, 4> neighbours(const Position& pos) {
+			return {{
+				{static_cast<u8>(pos.row - 1), pos.col},
+				{static_cast<u8>(pos.row + 1), pos.col},
+				{pos.row, static_cast<u8>(pos.col - 1)},
+				{pos.row, static_cast<u8>(pos.col + 1)}
+			}};
+		}
+
+		void block(const Position& pos) {
+			if (Grid<ROWS, COLS>::RECT.contains(pos)) {
+				blocked_.set(Grid<ROWS, COLS>::index(pos));
+			}
+		}
+
+		// Cell is out of the grid or can't have a ship
+		[[nodiscard]] bool is_closed(const Position& pos) const {
+			return !Grid<ROWS, COLS>::RECT.contains(pos) || blocked_.test(Grid<ROWS, COLS>::index(pos));
+		}
+
+		[[nodiscard]] bool is_hit(const Position& pos) const {
+			return Grid<ROWS, COLS>::RECT.contains(pos) && hits_.test(Grid<ROWS, COLS>::index(pos));
+		}
+
+		[[nodiscard]] u8 longest_remaining() const {
+			for (u8 len = SHIP_TYPE_COUNT; len > 0; --len) {
+				if (remaining_[len - 1] > 0) { return len; }
+			}
+			return 0;
+		}
+
+		// Marks the ship with a hit at `pos` as sunk, if it has to be
+		void check_sunk(const Position& pos) {
+			Position first = pos, last = pos;
+			while (is_hit({first.row, static_cast<u8>(first.col - 1)})) { --first.col; }
+			while (is_hit({last.row, static_cast<u8>(last.col + 1)})) { ++last.col; }
+			if (first.col == last.col) {
+				while (is_hit({static_cast<u8>(first.row - 1), first.col})) { --first.row; }
+				while (is_hit({static_cast<u8>(last.row + 1), last.col})) { ++last.row; }
+			}
+			Rectangle zone {first, last};
+			auto len = static_cast<u8>(std::max(zone.width(), zone.height()));
+			auto orientation = (zone.height() == 1) ? Orientation::Horizontal : Orientation::Vertical;
+
+			bool is_closed_horizontally =
+				is_closed({first.row, static_cast<u8>(first.col - 1)})
+				&& is_closed({last.row, static_cast<u8>(last.col + 1)});
+			bool is_closed_vertically =
+				is_closed({static_cast<u8>(first.row - 1), first.col})
+				&& is_closed({static_cast<u8>(last.row + 1), last.col});
+			bool is_sunk = (len == 1)
+				? is_closed_horizontally && is_closed_vertically
+				: (orientation == Orientation::Horizontal ? is_closed_horizontally : is_closed_vertically);
+			is_sunk = is_sunk || len >= longest_remaining();
+
+			const auto* masks = MASKS.find(len, orientation, zone.first);
+			if (!is_sunk || masks == nullptr || remaining_[len - 1] == 0) {
+				return;
+			}
+			--remaining_[len - 1];
+			hits_ &= ~masks->footprint;
+			blocked_ |= masks->halo;
+		}
+
+		// Counts placements of the remaining ships allowed by what's known for every cell,
+		// only placements through unsunk hits if there are any
+		BitCounters<Cells::size(), DENSITY_PLANES> placement_density() const {
+			BitCounters<Cells::size(), DENSITY_PLANES> density;
+			Cells free = ~blocked_;
+			bool is_targeting = hits_.any();
+			for (u8 len = 1; len <= SHIP_TYPE_COUNT; ++len) {
+				if (remaining_[len - 1] == 0) { continue; }
+				for (auto orientation: {Orientation::Horizontal, Orientation::Vertical}) {
+					// 1-cell ship is the same in both orientations
+					if (len == 1 && orientation == Orientation::Vertical) { continue; }
+					size_t step = MASKS.step(orientation);
+					Cells origins = MASKS.origins(free, len, orientation);
+					if (is_targeting) {
+						Cells through_hits;
+						for (u8 offset = 0; offset < len; ++offset) {
+							through_hits |= hits_ >> (offset * step);
+						}
+						origins &= through_hits;
+					}
+					for (u8 offset = 0; offset < len; ++offset) {
+						Cells cells = origins << (offset * step);
+						for (u8 count = 0; count < remaining_[len - 1]; ++count) {
+							density.add(cells);
+						}
+					}
+				}
+			}
+			return density;
+		}
+
+		// Places the remaining ships randomly `samples` times & counts how often every cell has a ship,
+		// returns the number of layouts without dead ends
+		u32 sample(Xoshiro256& rng, u32 samples, std::array<u32, Cells::size()>& counts) const {
+			u32 layouts = 0;
+			for (u32 i = 0; i < samples; ++i) {
+				Cells blocked = blocked_;
+				Cells ships;
+				bool is_complete = true;
+				for (u8 len = SHIP_TYPE_COUNT; len > 0 && is_complete; --len) {
+					for (u8 count = 0; count < remaining_[len - 1]; ++count) {
+						Cells free = ~blocked;
+						Cells horizontal = MASKS.origins(free, len, Orientation::Horizontal);
+						Cells vertical = (len == 1) ? Cells{} : MASKS.origins(free, len, Orientation::Vertical);
+						auto horizontal_count = static_cast<u32>(horizontal.count());
+						auto total = horizontal_count + static_cast<u32>(vertical.count());
+						if (total == 0) {
+							is_complete = false;
+							break;
+						}
+						u32 n = rng.below(total);
+						bool is_horizontal = n < horizontal_count;
+						size_t index = is_horizontal ? horizontal.nth_set(n) : vertical.nth_set(n - horizontal_count);
+						const auto* masks = MASKS.find(
+							len,
+							is_horizontal ? Orientation::Horizontal : Orientation::Vertical,
+							Grid<ROWS, COLS>::position(index)
+						);
+						ships |= masks->footprint;
+						blocked |= masks->halo;
+					}
+				}
+				if (!is_complete) { continue; }
+				++layouts;
+				ships.for_each_set([&counts](size_t cell) { ++counts[cell]; });
+			}
+			return layouts;
+		}
+
+		// Candidates with ships in the most sampled layouts
+		Cells sample_max(const Cells& candidates) {
+			std::array<u32, Cells::size()> counts {};
+			u32 layouts = 0;
+			if (threads_ == 1) {
+				layouts = sample(rng_, samples_, counts);
+			} else {
+				std::vector<std::array<u32, Cells::size()>> thread_counts(threads_);
+				std::vector<u32> thread_layouts(threads_);
+				{
+					std::vector<std::jthread> workers;
+					workers.reserve(threads_);
+					for (u32 t = 0; t < threads_; ++t) {
+						u32 share = samples_ / threads_ + (t < samples_ % threads_ ? 1 : 0);
+						workers.emplace_back([this, t, share, seed = rng_(), &thread_counts, &thread_layouts] {
+							Xoshiro256 rng {seed};
+							thread_layouts[t] = sample(rng, share, thread_counts[t]);
+						});
+					}
+				}
+				for (u32 t = 0; t < threads_; ++t) {
+					layouts += thread_layouts[t];
+					for (size_t cell = 0; cell < counts.size(); ++cell) {
+						counts[cell] += thread_counts[t][cell];
+					}
+				}
+			}
+			if (layouts == 0) {
+				return placement_density().max_of(candidates);
+			}
+
+			Cells best;
+			u32 best_count = 0;
+			candidates.for_each_set([&](size_t cell) {
+				if (counts[cell] > best_count) {
+					best_count = counts[cell];
+					best = Cells{};
+				}
+				if (counts[cell] == best_count) {
+					best.set(cell);
+				}
+			});
+			return best;
+		}
+	};
+} // namespace battleship
+
+#endif //BATTLESHIP_BOT_HPP
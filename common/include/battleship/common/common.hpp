@@ -1,12 +1,12 @@
 #ifndef BATTLESHIP_COMMON_HPP
 #define BATTLESHIP_COMMON_HPP
 
-#include <bitset>
 #include <iostream>
 #include <iomanip>
 #include <span>
 #include <nlohmann/json.hpp>
 #include <optional>
+#include <stdexcept>
 #include <string_view>
 #include <variant>
 #include <array>
@@ -14,13 +14,31 @@
 #include <tuple>
 #include <algorithm>
 #include <boost/container/static_vector.hpp>
+#include "util/bitboard.hpp"
 #include "util/geometry.hpp"
+#include "util/log.hpp"
 #include "util/num_types.hpp"
 #include "util/result.hpp"
 
 using nlohmann::json;
 
 namespace battleship {
+	// Wire format version, clients send theirs in the "version" field
+	enum class ProtocolVersion : u8 {
+		// Bitsets are "0101..." strings
+		V1 = 1,
+		// Bitsets are CBOR byte strings, see the serializer of `Bitboard`
+		V2 = 2
+	};
+
+	constexpr ProtocolVersion LATEST_PROTOCOL = ProtocolVersion::V2;
+
+	// Unknown versions are treated as the oldest one
+	inline ProtocolVersion protocol_version(const json& j) {
+		auto version = j.is_object() ? j.value("version", 1) : 1;
+		return (version >= 2) ? ProtocolVersion::V2 : ProtocolVersion::V1;
+	}
+
 	template<u8 ROWS, u8 COLS>
 	struct Grid;
 
@@ -30,28 +48,57 @@ namespace battleship {
 	template<u8 ROWS, u8 COLS>
 	struct Grid {
 		static constexpr size_t SIZE = ROWS * COLS;
-		static constexpr Rectangle RECT {{0, 0}, {ROWS, COLS}};
+		static constexpr Rectangle RECT {{0, 0}, {ROWS - 1, COLS - 1}};
+
+		// One bit per cell, cell (row, col) is bit (row * COLS + col)
+		using Cells = Bitboard<SIZE>;
 
 		inline bool place_ship(const Position& pos) {
-			std::optional<size_t> i = index(pos);
-			if (i.has_value()) { ships[*i] = true; }
-			return i.has_value();
+			if (!contains(pos)) { return false; }
+			ships.set(index(pos));
+			return true;
+		}
+
+		// Places all cells of the mask at once
+		inline void place_ships(const Cells& mask) {
+			ships |= mask;
 		}
 
 		[[nodiscard]] inline bool has_ship(const Position& pos) const {
-			std::optional<size_t> i = index(pos);
-			return i.has_value() && ships[*i];
+			return contains(pos) && ships.test(index(pos));
+		}
+
+		// Any cell of the mask has a ship, a single AND per word
+		[[nodiscard]] inline bool has_ship_in(const Cells& mask) const {
+			return ships.intersects(mask);
 		}
 
 		bool place_shot(const Position& pos) {
-			std::optional<size_t> i = index(pos);
-			if (i.has_value()) { shots[*i] = true; }
-			return i.has_value();
+			if (!contains(pos)) { return false; }
+			shots.set(index(pos));
+			return true;
+		}
+
+		// Places all cells of the mask at once
+		inline void place_shots(const Cells& mask) {
+			shots |= mask;
 		}
 
 		[[nodiscard]] inline bool has_shot(const Position& pos) const {
-			std::optional<u8> i = index(pos);
-			return i.has_value() && shots[*i];
+			return contains(pos) && shots.test(index(pos));
+		}
+
+		// All ships are sunk
+		[[nodiscard]] inline bool all_ships_shot() const {
+			return shots.contains(ships);
+		}
+
+		[[nodiscard]] inline const Cells& ship_cells() const {
+			return ships;
+		}
+
+		[[nodiscard]] inline const Cells& shot_cells() const {
+			return shots;
 		}
 
 		[[nodiscard]] inline bool contains(const Rectangle& rect) const {
@@ -62,19 +109,52 @@ namespace battleship {
 			return RECT.contains(pos);
 		}
 
-		friend std::ostream& operator<< <>(std::ostream& os, const Grid& grid);
+		[[nodiscard]] static constexpr size_t index(const Position& pos) {
+			return static_cast<size_t>(COLS * pos.row + pos.col);
+		}
 
-	private: 
-		std::bitset<SIZE> ships;
-		std::bitset<SIZE> shots;
+		[[nodiscard]] static constexpr Position position(size_t index) {
+			return {static_cast<u8>(index / COLS), static_cast<u8>(index % COLS)};
+		}
 
-		inline static std::optional<size_t> index(const Position& pos) {
-			if (pos.row < ROWS && pos.col < COLS) {
-				return COLS * pos.row + pos.col;
+		// Cells of the rectangle, which must be inside the grid
+		[[nodiscard]] static constexpr Cells mask(const Rectangle& rect) {
+			Cells cells;
+			for (size_t row = rect.first.row; row <= rect.last.row; ++row) {
+				cells.set_range(COLS * row + rect.first.col, rect.width());
 			}
-			return {};
+			return cells;
 		}
 
+		// Cells of the rectangle grown by 1 cell in every direction & clipped by the grid,
+		// i.e. the rectangle with its neighbours
+		[[nodiscard]] static constexpr Cells halo_mask(const Rectangle& rect) {
+			return mask({
+				{
+					static_cast<u8>((rect.first.row > 0) ? rect.first.row - 1 : 0),
+					static_cast<u8>((rect.first.col > 0) ? rect.first.col - 1 : 0)
+				},
+				{
+					static_cast<u8>(std::min(rect.last.row + 1, ROWS - 1)),
+					static_cast<u8>(std::min(rect.last.col + 1, COLS - 1))
+				}
+			});
+		}
+
+		// Serializes in the format of the given protocol version
+		[[nodiscard]] json serialize(ProtocolVersion version) const {
+			if (version == ProtocolVersion::V1) {
+				return {{"ships", ships.to_string()}, {"shots", shots.to_string()}};
+			}
+			return *this;
+		}
+
+		friend std::ostream& operator<< <>(std::ostream& os, const Grid& grid);
+
+	private: 
+		Cells ships;
+		Cells shots;
+
 		NLOHMANN_DEFINE_TYPE_INTRUSIVE(Grid, ships, shots)
 	};
 
@@ -91,12 +171,12 @@ namespace battleship {
 			os << '-';
 		}
 		os << '\n';
-		for (int row = 0; row < ROWS; ++row) {
+		for (u8 row = 0; row < ROWS; ++row) {
 			os << std::setw(2) << row + 1 << '|';
-			for (int col = 0; col < COLS; ++col) {
-				size_t index = Grid<ROWS, COLS>::index({row, col}).value();
-				bool is_ship = grid.ships[index];
-				bool is_shot = grid.shots[index];
+			for (u8 col = 0; col < COLS; ++col) {
+				size_t index = Grid<ROWS, COLS>::index({row, col});
+				bool is_ship = grid.ships.test(index);
+				bool is_shot = grid.shots.test(index);
 				if (is_ship && is_shot) {
 					os << 'x';
 				} else if (is_ship) {
@@ -112,6 +192,97 @@ namespace battleship {
 		return os;
 	}
 
+	enum class Orientation : u8 { Horizontal, Vertical };
+
+	// Footprint & halo (footprint with neighbours) of every straight ship
+	// of length 1..MAX_LENGTH which fits into the grid, keyed by (length, orientation, origin).
+	// Built at compile time, so placing a ship is a lookup & mask tests.
+	// Size is MAX_LENGTH * 2 * ROWS * COLS entries of 2 masks each,
+	// i.e. 25 KiB for 10x10 grid & 4 ship types.
+	template<u8 ROWS, u8 COLS, u8 MAX_LENGTH>
+	class ShipMasks {
+	public:
+		using Cells = typename Grid<ROWS, COLS>::Cells;
+
+		struct Entry {
+			Cells footprint;
+			Cells halo;
+		};
+
+		static constexpr size_t ORIENTATIONS = 2;
+		static constexpr size_t SIZE = MAX_LENGTH * ORIENTATIONS * Grid<ROWS, COLS>::SIZE;
+
+		constexpr ShipMasks() {
+			for (u8 len = 1; len <= MAX_LENGTH; ++len) {
+				for (auto orientation: {Orientation::Horizontal, Orientation::Vertical}) {
+					for (size_t index = 0; index < Grid<ROWS, COLS>::SIZE; ++index) {
+						Position first = Grid<ROWS, COLS>::position(index);
+						bool is_horizontal = orientation == Orientation::Horizontal;
+						Position last {
+							static_cast<u8>(first.row + (is_horizontal ? 0 : len - 1)),
+							static_cast<u8>(first.col + (is_horizontal ? len - 1 : 0))
+						};
+						if (last.row >= ROWS || last.col >= COLS) {
+							continue;
+						}
+						Rectangle zone {first, last};
+						entries_[slot(len, orientation, index)] = {
+							Grid<ROWS, COLS>::mask(zone),
+							Grid<ROWS, COLS>::halo_mask(zone)
+						};
+						origins_[len - 1][static_cast<size_t>(orientation)].set(index);
+					}
+				}
+			}
+		}
+
+		// Masks of the ship starting at `origin` (its top left cell),
+		// nullptr if the length is unknown or the ship doesn't fit into the grid
+		[[nodiscard]] constexpr const Entry* find(
+			u8 length, Orientation orientation, const Position& origin
+		) const {
+			if (length == 0 || length > MAX_LENGTH || origin.row >= ROWS || origin.col >= COLS) {
+				return nullptr;
+			}
+			const Entry& entry = entries_[slot(length, orientation, Grid<ROWS, COLS>::index(origin))];
+			return entry.footprint.none() ? nullptr : &entry;
+		}
+
+		// Distance between indices of neighbour cells of a ship
+		[[nodiscard]] static constexpr size_t step(Orientation orientation) {
+			return (orientation == Orientation::Horizontal) ? 1 : COLS;
+		}
+
+		// Origins of all ships of the given length & orientation, which lie entirely in `free`.
+		// Found for all cells at once by ANDing `free` with itself shifted,
+		// the length of the free run doubles every step.
+		[[nodiscard]] constexpr Cells origins(
+			const Cells& free, u8 length, Orientation orientation
+		) const {
+			Cells result = free;
+			for (u8 run = 1; run < length;) {
+				u8 shift = std::min(run, static_cast<u8>(length - run));
+				result &= result >> (shift * step(orientation));
+				run = static_cast<u8>(run + shift);
+			}
+			return result & origins_[length - 1][static_cast<size_t>(orientation)];
+		}
+
+	private:
+		// Entries of ships which don't fit have empty masks
+		std::array<Entry, SIZE> entries_ {};
+		// Origins of ships which fit into the grid, by length & orientation
+		std::array<std::array<Cells, ORIENTATIONS>, MAX_LENGTH> origins_ {};
+
+		static constexpr size_t slot(u8 length, Orientation orientation, size_t index) {
+			size_t row = (length - 1U) * ORIENTATIONS + static_cast<size_t>(orientation);
+			return row * Grid<ROWS, COLS>::SIZE + index;
+		}
+	};
+
+	template<u8 ROWS, u8 COLS, u8 MAX_LENGTH>
+	inline constexpr ShipMasks<ROWS, COLS, MAX_LENGTH> SHIP_MASKS {};
+
 	struct Ship {
 		Rectangle zone;
 
@@ -129,8 +300,8 @@ namespace battleship {
 	template<u8 SHIP_TYPE_COUNT>
 	using Rules = std::array<u8, SHIP_TYPE_COUNT>;
 
-	constexpr Rules<4> POST_SOVIET_RULES {4, 3, 2, 1};
-	constexpr Rules<5> AMERICAN_RULES {0, 1, 2, 1, 1};
+	inline constexpr Rules<4> POST_SOVIET_RULES {4, 3, 2, 1};
+	inline constexpr Rules<5> AMERICAN_RULES {0, 1, 2, 1, 1};
 
 	template<u8 ROWS, u8 COLS, u8 SHIP_TYPE_COUNT, const std::array<u8, SHIP_TYPE_COUNT>& RULES>
 	struct Ships {
@@ -174,28 +345,24 @@ namespace battleship {
 	struct PlayerField {
 		using PlayerShips = Ships<ROWS, COLS, SHIP_TYPE_COUNT, RULES>;
 
+		static constexpr const ShipMasks<ROWS, COLS, SHIP_TYPE_COUNT>& MASKS {
+			SHIP_MASKS<ROWS, COLS, SHIP_TYPE_COUNT>
+		};
+
 		[[nodiscard]] inline bool is_out_of_bounds(const Ship& ship) const {
 			return !grid.contains(ship.zone);
 		}
 
+		// The ship or its neighbour cells touch a ship which is already placed
 		[[nodiscard]] inline bool overlaps(const Ship& ship) const {
-			Rectangle zone {
-				{
-					static_cast<u8>((ship.zone.first.row > 0) ? ship.zone.first.row - 1 : 0),
-					static_cast<u8>((ship.zone.first.col > 0) ? ship.zone.first.col - 1 : 0)
-				},
-				{
-					static_cast<u8>(
-						(ship.zone.last.row < ROWS - 1) ? ship.zone.first.row + 1 : ROWS - 1
-					),
-					static_cast<u8>(
-						(ship.zone.last.col < COLS - 1) ? ship.zone.first.col + 1 : COLS - 1
-					)
+			// Ships of the rules have their halo in the table, anything else is masked on the fly
+			if (std::min(ship.zone.width(), ship.zone.height()) == 1) {
+				auto orientation = (ship.zone.height() == 1) ? Orientation::Horizontal : Orientation::Vertical;
+				if (const auto* masks = MASKS.find(ship.length(), orientation, ship.zone.first); masks != nullptr) {
+					return grid.has_ship_in(masks->halo);
 				}
-			};
-			return std::any_of(zone.begin(), zone.end(),
-				[this](const auto& pos){ return grid.has_ship(pos); }
-			);
+			}
+			return grid.has_ship_in(Grid<ROWS, COLS>::halo_mask(ship.zone));
 		}
 
 		[[nodiscard]] inline bool is_full() const {
@@ -204,23 +371,23 @@ namespace battleship {
 
 		inline Result<std::monostate, ShipPlacementError> try_place_ship(Ship&& ship) {
 			u8 len = ship.length();
-			if (len > SHIP_TYPE_COUNT || len == 0) {
+			bool is_straight = std::min(ship.zone.width(), ship.zone.height()) == 1;
+			if (len > SHIP_TYPE_COUNT || len == 0 || !is_straight) {
 				return ShipPlacementError::WrongLength;
 			}
-			if (is_out_of_bounds(ship)) {
+			auto orientation = (ship.zone.height() == 1) ? Orientation::Horizontal : Orientation::Vertical;
+			const auto* masks = MASKS.find(len, orientation, ship.zone.first);
+			if (masks == nullptr) {
 				return ShipPlacementError::OutOfBounds;
 			}
-			if (overlaps(ship)) {
+			if (grid.has_ship_in(masks->halo)) {
 				return ShipPlacementError::Overlap;
 			}
-			if (is_full()) {
+			if (ships.count[len - 1] >= RULES[len - 1]) {
 				return ShipPlacementError::TooManyShips;
 			}
 
-			for (auto pos: ship.zone) { // NOLINT
-				grid.place_ship(pos);
-			}
-
+			grid.place_ships(masks->footprint);
 			ships.push(std::move(ship));
 			return {};
 		}
@@ -232,12 +399,12 @@ namespace battleship {
 		) {
 			PlayerField field;
 			for (Ship ship: ships.ships) {
-				std::cout << json{ship} << '\n';
+				BATTLESHIP_LOG(Trace, "placing ship", log::kv("ship", json(ship).dump()));
 				auto result = field.try_place_ship(std::move(ship));
-				std::cout << "try_place_ship() success\n";
-				std::cout << field.grid << "\n\n";
 				if (is_err(result)) {
-					return std::get<ShipPlacementError>(result);
+					auto error = std::get<ShipPlacementError>(result);
+					BATTLESHIP_LOG(Debug, "ship rejected", log::kv("error", static_cast<int>(error)));
+					return error;
 				}
 			}
 			return field;
@@ -246,6 +413,11 @@ namespace battleship {
 		Grid<ROWS, COLS> grid;
 		PlayerShips ships;
 
+		// Serializes in the format of the given protocol version
+		[[nodiscard]] json serialize(ProtocolVersion version) const {
+			return {{"grid", grid.serialize(version)}, {"ships", ships}};
+		}
+
 		NLOHMANN_DEFINE_TYPE_INTRUSIVE(PlayerField, grid, ships)
 	};
 } // namespace battleship
@@ -254,29 +426,41 @@ namespace nlohmann {
 	template <typename T, const size_t N>
 	struct adl_serializer<boost::container::static_vector<T, N>> {
 		static void to_json(json& j, const boost::container::static_vector<T, N>& vec) {
-			// TODO: come up with some clever way to do that without copying
-			std::array<T, N> arr;
-			std::copy(vec.begin(), vec.end(), arr.begin());
-			j = arr;
+			j = json::array();
+			auto& arr = j.get_ref<json::array_t&>();
+			arr.reserve(vec.size());
+			for (const T& elem: vec) {
+				arr.emplace_back(elem);
+			}
 		}
 
 		static void from_json(const json& j, boost::container::static_vector<T, N>& vec) {
-			// TODO: come up with some clever way to do that without copying
-			std::array<T, N> arr = j;
-			vec.assign(arr.begin(), arr.end());
+			const auto& arr = j.get_ref<const json::array_t&>();
+			if (arr.size() > N) {
+				throw std::out_of_range("too many elements for static_vector");
+			}
+			vec.clear();
+			for (const json& elem: arr) {
+				vec.emplace_back(elem.get<T>());
+			}
 		}
 	};
 
+	// Bitboard is a byte string (ProtocolVersion::V2), cell i is bit (i % 8) of byte (i / 8),
+	// "0101..." strings of ProtocolVersion::V1 are still accepted
 	template <const size_t N>
-	struct adl_serializer<std::bitset<N>> {
-		static void to_json(json& j, const std::bitset<N>& bits) {
-			// TODO: come up with more clever way to do that
-			j = bits.to_string();
+	struct adl_serializer<battleship::Bitboard<N>> {
+		static void to_json(json& j, const battleship::Bitboard<N>& bits) {
+			auto bytes = bits.to_bytes();
+			j = json::binary_t{{bytes.begin(), bytes.end()}};
 		}
 
-		static void from_json(const json& j, std::bitset<N>& bits) {
-			// TODO: come up with more clever way to do that
-			bits = std::bitset<N>(j.get<std::string>());
+		static void from_json(const json& j, battleship::Bitboard<N>& bits) {
+			if (j.is_binary()) {
+				bits = battleship::Bitboard<N>::from_bytes(j.get_binary());
+			} else {
+				bits = battleship::Bitboard<N>::from_string(j.get_ref<const std::string&>());
+			}
 		}
 	};
 } // namespace nlohmann
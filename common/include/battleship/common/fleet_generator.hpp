@@ -0,0 +1,140 @@
+#ifndef BATTLESHIP_FLEET_GENERATOR_HPP
+#define BATTLESHIP_FLEET_GENERATOR_HPP
+
+#include "common.hpp"
+#include "util/random.hpp"
+
+namespace battleship {
+	// Generator of random valid fleets ("auto-place").
+	// Ships are placed from the longest to the shortest, each one uniformly
+	// among all positions still allowed by the ships already placed.
+	// Allowed origins are found for all cells at once by `ShipMasks::origins()`,
+	// so there is no blind rejection: a layout is restarted only if some ship can't be
+	// placed at all, which is rare for standard rules.
+	// Sequential placement alone is biased (long ships stay away from the borders
+	// more often than they should), so then every ship is moved `sweeps` times
+	// to a uniformly chosen position allowed by all the others.
+	// Such moves keep the uniform distribution of layouts,
+	// so every sweep brings the result closer to it at the cost of another pass.
+	// With 1 sweep a cell of the standard field is still off by up to 1.3 percentage points.
+	// common/test checks the default sweeps against every layout of a 3-ship, a 2-ship
+	// & two 1-ships on 6x6: over 200k layouts the share of every cell & of horizontal ships
+	// of every length is within 4.5 standard errors of the exact one, while sequential
+	// placement alone (0 sweeps) is off by more than 18.
+	template<u8 ROWS, u8 COLS, u8 SHIP_TYPE_COUNT, const std::array<u8, SHIP_TYPE_COUNT>& RULES>
+	class FleetGenerator {
+	public:
+		using Field = PlayerField<ROWS, COLS, SHIP_TYPE_COUNT, RULES>;
+		using Cells = typename Grid<ROWS, COLS>::Cells;
+
+		static constexpr u8 DEFAULT_SWEEPS = 4;
+
+		explicit FleetGenerator(u64 seed, u8 sweeps = DEFAULT_SWEEPS):
+			rng_{seed}, sweeps_{sweeps} {}
+
+		// Random full field
+		Field operator()() {
+			while (!try_place_all()) {
+				++restarts_;
+			}
+			for (u8 sweep = 0; sweep < sweeps_; ++sweep) {
+				for (size_t i = 0; i < fleet_.size(); ++i) {
+					move(i);
+				}
+			}
+
+			Field field;
+			for (const Placement& ship: fleet_) {
+				field.grid.place_ships(ship.masks->footprint);
+				field.ships.push(Ship{ship.zone});
+			}
+			return field;
+		}
+
+		// Layouts thrown away because of a dead end
+		[[nodiscard]] inline u64 restarts() const {
+			return restarts_;
+		}
+
+	private:
+		using Masks = typename ShipMasks<ROWS, COLS, SHIP_TYPE_COUNT>::Entry;
+
+		struct Placement {
+			u8 length;
+			Rectangle zone;
+			const Masks* masks;
+		};
+
+		// Lengths from the longest, as the ships are placed
+		static constexpr auto LENGTHS = [] {
+			std::array<u8, Field::PlayerShips::SHIP_COUNT> lengths {};
+			size_t i = 0;
+			for (u8 len = SHIP_TYPE_COUNT; len > 0; --len) {
+				for (u8 count = 0; count < RULES[len - 1]; ++count) {
+					lengths[i++] = len;
+				}
+			}
+			return lengths;
+		}();
+
+		Xoshiro256 rng_;
+		u8 sweeps_;
+		u64 restarts_ {0};
+		std::array<Placement, Field::PlayerShips::SHIP_COUNT> fleet_ {};
+
+		// Places all ships one by one, false on a dead end
+		bool try_place_all() {
+			// ships & their neighbours
+			Cells blocked;
+			for (size_t i = 0; i < fleet_.size(); ++i) {
+				if (!try_place(fleet_[i], LENGTHS[i], blocked)) {
+					return false;
+				}
+				blocked |= fleet_[i].masks->halo;
+			}
+			return true;
+		}
+
+		// Moves i-th ship to a random position allowed by the others,
+		// which may be the same one
+		void move(size_t i) {
+			Cells blocked;
+			for (size_t j = 0; j < fleet_.size(); ++j) {
+				if (j != i) {
+					blocked |= fleet_[j].masks->halo;
+				}
+			}
+			try_place(fleet_[i], LENGTHS[i], blocked);
+		}
+
+		// Places ship uniformly among positions, where its cells don't touch `blocked`
+		bool try_place(Placement& ship, u8 len, const Cells& blocked) {
+			Cells free = ~blocked;
+			Cells horizontal = Field::MASKS.origins(free, len, Orientation::Horizontal);
+			// 1-cell ship is the same in both orientations
+			Cells vertical = (len == 1) ? Cells{} : Field::MASKS.origins(free, len, Orientation::Vertical);
+
+			auto horizontal_count = static_cast<u32>(horizontal.count());
+			auto total = horizontal_count + static_cast<u32>(vertical.count());
+			if (total == 0) {
+				return false;
+			}
+			u32 n = rng_.below(total);
+			bool is_horizontal = n < horizontal_count;
+			size_t index = is_horizontal
+				? horizontal.nth_set(n)
+				: vertical.nth_set(n - horizontal_count);
+
+			Position first = Grid<ROWS, COLS>::position(index);
+			Position last {
+				static_cast<u8>(first.row + (is_horizontal ? 0 : len - 1)),
+				static_cast<u8>(first.col + (is_horizontal ? len - 1 : 0))
+			};
+			auto orientation = is_horizontal ? Orientation::Horizontal : Orientation::Vertical;
+			ship = {len, Rectangle{first, last}, Field::MASKS.find(len, orientation, first)};
+			return true;
+		}
+	};
+} // namespace battleship
+
+#endif //BATTLESHIP_FLEET_GENERATOR_HPP
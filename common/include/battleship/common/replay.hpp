@@ -0,0 +1,271 @@
+#ifndef BATTLESHIP_REPLAY_HPP
+#define BATTLESHIP_REPLAY_HPP
+
+#include <algorithm>
+#include <array>
+#include <optional>
+#include <span>
+#include <vector>
+#include "common.hpp"
+
+namespace battleship {
+	// Finished game as it's archived: both fleets & every shot in order.
+	// Who made a shot isn't stored, as the side which moves first shoots until it misses,
+	// then the other side does, so the shots alone replay the whole game.
+	//
+	// Encoding (numbers are little-endian):
+	//   u8 flags: bit 0 - the second side moved first, bit 1 - the game ended by a timeout,
+	//             bit 2 - the second side won by the timeout
+	//   16 bytes of the game id, u64 end time in ms since the Unix epoch
+	//   fleet of each side, SHIP_COUNT bytes: ships from the longest to the shortest,
+	//     each as (index of its top left cell) * 2 + (1 if vertical)
+	//   u8 shot count, then the index of the cell of every shot
+	// i.e. 46 bytes + 1 byte per shot for the 10x10 grid & post-soviet rules.
+	template<u8 ROWS, u8 COLS, u8 SHIP_TYPE_COUNT, const std::array<u8, SHIP_TYPE_COUNT>& RULES>
+	struct GameReplay {
+		using GameGrid = Grid<ROWS, COLS>;
+		using Cells = typename GameGrid::Cells;
+		using GameShips = Ships<ROWS, COLS, SHIP_TYPE_COUNT, RULES>;
+
+		static constexpr size_t SHIP_COUNT = GameShips::SHIP_COUNT;
+		// Every cell of both grids but one, the last ship sinks with the last shot
+		static constexpr size_t MAX_SHOTS = 2 * GameGrid::SIZE - 1;
+		static_assert(GameGrid::SIZE <= 128, "a ship & a shot must fit in one byte");
+		static constexpr size_t MIN_SIZE = 1 + 16 + 8 + 2 * SHIP_COUNT + 1;
+
+		// Lengths of the encoded ships in their order
+		static constexpr std::array<u8, SHIP_COUNT> LENGTHS = [] {
+			std::array<u8, SHIP_COUNT> lengths {};
+			size_t i = 0;
+			for (size_t len = SHIP_TYPE_COUNT; len > 0; --len) {
+				for (u8 n = 0; n < RULES[len - 1]; ++n) {
+					lengths[i++] = static_cast<u8>(len);
+				}
+			}
+			return lengths;
+		}();
+
+		std::array<u8, 16> id {};
+		u64 finished_at {0};
+		// Side which moved first, 0 or 1
+		u8 first {0};
+		// Side which won because the other one ran out of time,
+		// nothing if the game was played to the last ship
+		std::optional<u8> forfeit_winner;
+		// Full fleets of both sides
+		std::array<GameShips, 2> ships;
+		// Cell index of every shot, in order
+		std::vector<u8> shots;
+
+		// Appends the encoded game to `out`
+		void encode(std::vector<u8>& out) const {
+			u8 flags = static_cast<u8>(first & 1U);
+			if (forfeit_winner.has_value()) {
+				flags |= static_cast<u8>(2U | ((*forfeit_winner & 1U) << 2));
+			}
+			out.push_back(flags);
+			out.insert(out.end(), id.begin(), id.end());
+			for (size_t byte = 0; byte < sizeof(finished_at); ++byte) {
+				out.push_back(static_cast<u8>(finished_at >> (8 * byte)));
+			}
+			for (const GameShips& fleet: ships) {
+				auto sorted = fleet.ships;
+				std::stable_sort(sorted.begin(), sorted.end(), [](const Ship& a, const Ship& b) {
+					return a.length() > b.length();
+				});
+				for (const Ship& ship: sorted) {
+					bool is_vertical = ship.zone.height() > 1;
+					out.push_back(static_cast<u8>(GameGrid::index(ship.zone.first) * 2 + (is_vertical ? 1 : 0)));
+				}
+			}
+			out.push_back(static_cast<u8>(shots.size()));
+			out.insert(out.end(), shots.begin(), shots.end());
+		}
+
+		// Encoded game read in place, without allocations
+		class View {
+		public:
+			// Parses the game at the front of `bytes` & drops it from there,
+			// nothing if it's malformed
+			static std::optional<View> parse(std::span<const u8>& bytes) {
+				if (bytes.size() < MIN_SIZE) { return {}; }
+				View view;
+				view.bytes_ = bytes;
+				for (size_t i = 0; i < 2 * SHIP_COUNT; ++i) {
+					if (view.ship_entry(bytes[FLEETS + i], i % SHIP_COUNT) == nullptr) { return {}; }
+				}
+				size_t shot_count = bytes[FLEETS + 2 * SHIP_COUNT];
+				size_t size = MIN_SIZE + shot_count;
+				if (shot_count > MAX_SHOTS || bytes.size() < size) { return {}; }
+				view.bytes_ = bytes.first(size);
+				for (u8 cell: view.shots()) {
+					if (cell >= GameGrid::SIZE) { return {}; }
+				}
+				bytes = bytes.subspan(size);
+				return view;
+			}
+
+			[[nodiscard]] inline std::span<const u8, 16> id() const {
+				return bytes_.template subspan<1, 16>();
+			}
+
+			[[nodiscard]] u64 finished_at() const {
+				u64 ms = 0;
+				for (size_t byte = 0; byte < sizeof(ms); ++byte) {
+					ms |= static_cast<u64>(bytes_[17 + byte]) << (8 * byte);
+				}
+				return ms;
+			}
+
+			[[nodiscard]] inline u8 first() const {
+				return bytes_[0] & 1U;
+			}
+
+			[[nodiscard]] inline std::optional<u8> forfeit_winner() const {
+				if ((bytes_[0] & 2U) == 0) { return {}; }
+				return static_cast<u8>((bytes_[0] >> 2) & 1U);
+			}
+
+			// Cells of all ships of the side
+			[[nodiscard]] Cells ship_cells(u8 side) const {
+				Cells cells;
+				for (size_t i = 0; i < SHIP_COUNT; ++i) {
+					cells |= ship_entry(bytes_[FLEETS + side * SHIP_COUNT + i], i)->footprint;
+				}
+				return cells;
+			}
+
+			[[nodiscard]] GameShips ships(u8 side) const {
+				GameShips fleet;
+				for (size_t i = 0; i < SHIP_COUNT; ++i) {
+					u8 ship = bytes_[FLEETS + side * SHIP_COUNT + i];
+					Position first = GameGrid::position(ship / 2U);
+					bool is_vertical = (ship & 1U) != 0;
+					Position last {
+						static_cast<u8>(first.row + (is_vertical ? LENGTHS[i] - 1 : 0)),
+						static_cast<u8>(first.col + (is_vertical ? 0 : LENGTHS[i] - 1))
+					};
+					fleet.push(Ship{Rectangle{first, last}});
+				}
+				return fleet;
+			}
+
+			// Cell indices of the shots, in order
+			[[nodiscard]] inline std::span<const u8> shots() const {
+				return bytes_.subspan(MIN_SIZE);
+			}
+
+			[[nodiscard]] inline std::span<const u8> bytes() const {
+				return bytes_;
+			}
+
+		private:
+			using Masks = ShipMasks<ROWS, COLS, SHIP_TYPE_COUNT>;
+
+			static constexpr size_t FLEETS = 1 + 16 + 8;
+
+			std::span<const u8> bytes_;
+
+			View() = default;
+
+			// Masks of the encoded ship, nullptr if it doesn't fit into the grid
+			static const typename Masks::Entry* ship_entry(u8 ship, size_t i) {
+				if (ship / 2U >= GameGrid::SIZE) { return nullptr; }
+				auto orientation = ((ship & 1U) != 0) ? Orientation::Vertical : Orientation::Horizontal;
+				return SHIP_MASKS<ROWS, COLS, SHIP_TYPE_COUNT>.find(LENGTHS[i], orientation, GameGrid::position(ship / 2U));
+			}
+		};
+
+		// Grids of both sides at any move of the game, replayed from the start
+		class Cursor {
+		public:
+			explicit Cursor(const View& game): game_{game} {
+				rewind();
+			}
+
+			// Number of shots made so far
+			[[nodiscard]] inline size_t move() const {
+				return move_;
+			}
+
+			[[nodiscard]] inline bool is_done() const {
+				return move_ == game_.shots().size();
+			}
+
+			// Makes the next shot, returns false if there are no more
+			bool step() {
+				if (is_done()) { return false; }
+				GameGrid& target = grids_[1 - mover_];
+				Position pos = GameGrid::position(game_.shots()[move_++]);
+				target.place_shot(pos);
+				last_hit_ = target.has_ship(pos);
+				++shots_[mover_];
+				if (last_hit_ && target.all_ships_shot()) {
+					winner_ = mover_;
+				} else if (!last_hit_) {
+					mover_ = static_cast<u8>(1 - mover_);
+				}
+				return true;
+			}
+
+			// State after `move` shots (or all of them, if there are fewer),
+			// replays from the start if it's behind
+			void seek(size_t move) {
+				if (move < move_) {
+					rewind();
+				}
+				while (move_ < move && step()) {}
+			}
+
+			// Ships of the side & shots of the enemy at them
+			[[nodiscard]] inline const GameGrid& grid(u8 side) const {
+				return grids_[side];
+			}
+
+			// Side which makes the next shot
+			[[nodiscard]] inline u8 mover() const {
+				return mover_;
+			}
+
+			// Shots made by the side so far
+			[[nodiscard]] inline size_t shots(u8 side) const {
+				return shots_[side];
+			}
+
+			[[nodiscard]] inline bool last_hit() const {
+				return last_hit_;
+			}
+
+			// Side which sank all enemy ships so far, or won by a timeout after the last shot
+			[[nodiscard]] std::optional<u8> winner() const {
+				if (winner_.has_value() || !is_done()) {
+					return winner_;
+				}
+				return game_.forfeit_winner();
+			}
+
+		private:
+			View game_;
+			std::array<GameGrid, 2> grids_;
+			std::array<size_t, 2> shots_ {};
+			size_t move_ {0};
+			u8 mover_ {0};
+			bool last_hit_ {false};
+			std::optional<u8> winner_;
+
+			void rewind() {
+				for (u8 side = 0; side < 2; ++side) {
+					grids_[side] = {};
+					grids_[side].place_ships(game_.ship_cells(side));
+				}
+				shots_ = {};
+				move_ = 0;
+				mover_ = game_.first();
+				last_hit_ = false;
+				winner_.reset();
+			}
+		};
+	};
+} // namespace battleship
+
+#endif // BATTLESHIP_REPLAY_HPP
@@ -0,0 +1,198 @@
+#ifndef BATTLESHIP_REPLAY_FILE_HPP
+#define BATTLESHIP_REPLAY_FILE_HPP
+
+#include <atomic>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <vector>
+#include "replay.hpp"
+#include "util/mapped_file.hpp"
+
+namespace battleship {
+	// Grid & rules of the games in a replay file
+	struct ReplayFormat {
+		u8 rows {0};
+		u8 cols {0};
+		std::vector<u8> rules;
+
+		bool operator==(const ReplayFormat&) const = default;
+
+		template<u8 ROWS, u8 COLS, u8 SHIP_TYPE_COUNT, const std::array<u8, SHIP_TYPE_COUNT>& RULES>
+		static ReplayFormat of() {
+			return {ROWS, COLS, {RULES.begin(), RULES.end()}};
+		}
+	};
+
+	// Encoded games, compressed & written as a whole
+	struct ReplayBlock {
+		// Raw size a block is written at, big enough to compress well
+		// & small enough to decompress in L2 cache
+		static constexpr size_t TARGET_SIZE = 64 * 1024;
+
+		std::vector<u8> bytes;
+		u32 games {0};
+
+		[[nodiscard]] inline bool is_full() const {
+			return bytes.size() >= TARGET_SIZE;
+		}
+
+		inline void clear() {
+			bytes.clear();
+			games = 0;
+		}
+	};
+
+	// File of archived games, see `GameReplay` for the encoding of a game.
+	// Layout (numbers are little-endian):
+	//   header: "BSREPLAY", u8 version, u8 rows, u8 cols, u8 ship type count, ships of each type
+	//   blocks: u32 compressed size, u32 raw size, u32 game count, u32 CRC-32C of the compressed bytes,
+	//           then the games compressed with zlib
+	//   index (once the file is closed): u64 offset & u64 number of the first game of every block
+	//   footer: u64 offset of the index, u64 game count, "BSRINDEX"
+	// Blocks are independent, so they are read in place from a mapping & scanned in parallel,
+	// & the index finds the block of any game without reading the others.
+	// A file which wasn't closed has no index, its blocks are found by walking their headers.
+	class ReplayFile {
+	public:
+		static constexpr u8 VERSION = 1;
+		static constexpr size_t BLOCK_HEADER_SIZE = 16;
+
+		// Maps the file & loads its index, throws std::runtime_error if it isn't a replay file
+		explicit ReplayFile(const std::filesystem::path& path);
+
+		[[nodiscard]] inline const ReplayFormat& format() const {
+			return format_;
+		}
+
+		[[nodiscard]] inline size_t block_count() const {
+			return blocks_.size();
+		}
+
+		[[nodiscard]] inline u64 game_count() const {
+			return games_;
+		}
+
+		// Number of the first game of the block
+		[[nodiscard]] inline u64 first_game(size_t block) const {
+			return blocks_[block].first_game;
+		}
+
+		// Block which holds the game, `block_count()` if there is no such game
+		[[nodiscard]] size_t find_block(u64 game) const;
+
+		// The file was closed properly, rather than cut short by a crash
+		[[nodiscard]] inline bool is_complete() const {
+			return is_complete_;
+		}
+
+		// Decompresses the block into `out`, returns its number of games.
+		// Thread safe. Throws std::runtime_error if the block is corrupted.
+		u32 read_block(size_t block, std::vector<u8>& out) const;
+
+	private:
+		struct Block {
+			u64 offset;
+			u64 first_game;
+		};
+
+		MappedFile file_;
+		ReplayFormat format_;
+		std::vector<Block> blocks_;
+		u64 games_ {0};
+		bool is_complete_ {false};
+		// Offset of the first block
+		size_t data_offset_ {0};
+
+		bool load_index();
+		void scan_blocks();
+		// Compressed bytes of the block at the offset after their CRC is checked,
+		// nothing if the block is cut short or corrupted
+		[[nodiscard]] std::optional<std::span<const u8>> payload(u64 offset) const;
+	};
+
+	// Writes a replay file, replacing an existing one
+	class ReplayFileWriter {
+	public:
+		// zlib level, -1 is its default
+		ReplayFileWriter(const std::filesystem::path& path, const ReplayFormat& format, int level = -1);
+		ReplayFileWriter(const ReplayFileWriter&) = delete;
+		ReplayFileWriter& operator=(const ReplayFileWriter&) = delete;
+		// Closes the file if it's still open, errors are lost
+		~ReplayFileWriter();
+
+		// Compresses & appends the block, thread safe: blocks of many threads are compressed
+		// in parallel & only the write is serialized. Empty blocks are skipped.
+		// Throws std::runtime_error on I/O errors.
+		void write(const ReplayBlock& block);
+
+		// Writes the index, syncs & closes the file, nothing may be written after it
+		void close();
+
+		[[nodiscard]] inline u64 games() const {
+			return games_.load(std::memory_order_relaxed);
+		}
+
+		[[nodiscard]] inline u64 bytes_written() const {
+			return bytes_written_.load(std::memory_order_relaxed);
+		}
+
+	private:
+		const int level_;
+		int fd_ {-1};
+		std::mutex mutex_;
+		std::vector<u8> index_;
+		std::atomic<u64> games_ {0};
+		std::atomic<u64> bytes_written_ {0};
+
+		void write_all(std::span<const u8> bytes);
+	};
+
+	// Games of a range of blocks of a replay file, one at a time.
+	// Only one block is decompressed at a time & games are read in place.
+	template<u8 ROWS, u8 COLS, u8 SHIP_TYPE_COUNT, const std::array<u8, SHIP_TYPE_COUNT>& RULES>
+	class ReplayStream {
+	public:
+		using Replay = GameReplay<ROWS, COLS, SHIP_TYPE_COUNT, RULES>;
+
+		// Blocks [first_block, last_block) of the file, which must outlive the stream.
+		// Throws std::runtime_error if the file holds games of other grid or rules.
+		ReplayStream(const ReplayFile& file, size_t first_block, size_t last_block):
+			file_{file},
+			block_{first_block},
+			last_block_{std::min(last_block, file.block_count())}
+		{
+			if (file.format() != ReplayFormat::of<ROWS, COLS, SHIP_TYPE_COUNT, RULES>()) {
+				throw std::runtime_error("replay file has games of other grid or rules");
+			}
+		}
+
+		explicit ReplayStream(const ReplayFile& file): ReplayStream{file, 0, file.block_count()} {}
+
+		// Next game, valid until the next call, nothing after the last one.
+		// Throws std::runtime_error if a block is corrupted.
+		std::optional<typename Replay::View> next() {
+			while (rest_.empty()) {
+				if (block_ >= last_block_) { return {}; }
+				file_.read_block(block_++, buffer_);
+				rest_ = buffer_;
+			}
+			auto game = Replay::View::parse(rest_);
+			if (!game.has_value()) {
+				throw std::runtime_error("malformed game in block " + std::to_string(block_ - 1));
+			}
+			return game;
+		}
+
+	private:
+		const ReplayFile& file_;
+		size_t block_;
+		size_t last_block_;
+		std::vector<u8> buffer_;
+		std::span<const u8> rest_;
+	};
+} // namespace battleship
+
+#endif // BATTLESHIP_REPLAY_FILE_HPP
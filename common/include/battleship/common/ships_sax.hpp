@@ -0,0 +1,281 @@
+#ifndef BATTLESHIP_SHIPS_SAX_HPP
+#define BATTLESHIP_SHIPS_SAX_HPP
+
+#include <optional>
+#include <span>
+#include <string>
+#include "common.hpp"
+
+namespace battleship {
+	// SAX handler, which reads {"ships": [{"zone": {"first": {"row", "col"}, "last": ...}}, ...],
+	// "version": N} straight into `Ships`, without building a json tree.
+	// Fails as soon as something is malformed: wrong structure, coordinates not fitting u8,
+	// zones which aren't straight lines, too long ships, too many ships.
+	// Unknown keys are skipped with their values.
+	template<u8 ROWS, u8 COLS, u8 SHIP_TYPE_COUNT, const std::array<u8, SHIP_TYPE_COUNT>& RULES>
+	class ShipsSax {
+	public:
+		using PlayerShips = Ships<ROWS, COLS, SHIP_TYPE_COUNT, RULES>;
+
+		explicit ShipsSax(PlayerShips& ships): ships_{ships} {}
+
+		[[nodiscard]] inline ProtocolVersion version() const {
+			return version_;
+		}
+
+		[[nodiscard]] inline bool is_complete() const {
+			return place_ == Place::Done;
+		}
+
+		// json_sax interface
+
+		bool null() {
+			return other_value();
+		}
+
+		bool boolean([[maybe_unused]] bool value) {
+			return other_value();
+		}
+
+		bool number_integer(json::number_integer_t value) {
+			if (value < 0) { return other_value(); }
+			return number_unsigned(static_cast<json::number_unsigned_t>(value));
+		}
+
+		bool number_unsigned(json::number_unsigned_t value) {
+			if (skip_depth_ > 0) { return true; }
+			switch (expect_) {
+			case Expect::Any:
+				break;
+			case Expect::Version:
+				version_ = (value >= 2) ? ProtocolVersion::V2 : ProtocolVersion::V1;
+				break;
+			case Expect::Row:
+			case Expect::Col: {
+				if (value > UINT8_MAX) { return false; }
+				Position& corner = is_first_ ? first_ : last_;
+				bool is_row = expect_ == Expect::Row;
+				(is_row ? corner.row : corner.col) = static_cast<u8>(value);
+				coords_ |= static_cast<u8>((is_row ? 1U : 2U) << (is_first_ ? 0U : 2U));
+				break;
+			}
+			default:
+				return false;
+			}
+			expect_ = Expect::Key;
+			return true;
+		}
+
+		bool number_float(
+			[[maybe_unused]] json::number_float_t value,
+			[[maybe_unused]] const std::string& str
+		) {
+			return other_value();
+		}
+
+		bool string([[maybe_unused]] std::string& value) {
+			return other_value();
+		}
+
+		bool binary([[maybe_unused]] json::binary_t& value) {
+			return other_value();
+		}
+
+		bool start_object([[maybe_unused]] std::size_t size) {
+			if (skip_depth_ > 0) {
+				++skip_depth_;
+				return true;
+			}
+			switch (expect_) {
+			case Expect::Any:
+				skip_depth_ = 1;
+				expect_ = Expect::Key;
+				return true;
+			case Expect::Root:
+				place_ = Place::Root;
+				break;
+			case Expect::Ship:
+				if (ships_.ships.size() == ships_.ships.capacity()) { return false; }
+				place_ = Place::Ship;
+				has_zone_ = false;
+				break;
+			case Expect::Zone:
+				place_ = Place::Zone;
+				coords_ = 0;
+				break;
+			case Expect::Corner:
+				place_ = Place::Corner;
+				break;
+			default:
+				return false;
+			}
+			expect_ = Expect::Key;
+			return true;
+		}
+
+		bool key(std::string& key) {
+			if (skip_depth_ > 0) { return true; }
+			if (expect_ != Expect::Key) { return false; }
+			expect_ = Expect::Any;
+			switch (place_) {
+			case Place::Root:
+				if (key == "ships") {
+					if (has_ships_) { return false; }
+					has_ships_ = true;
+					expect_ = Expect::ShipsArray;
+				} else if (key == "version") {
+					expect_ = Expect::Version;
+				}
+				break;
+			case Place::Ship:
+				if (key == "zone") {
+					if (has_zone_) { return false; }
+					expect_ = Expect::Zone;
+				}
+				break;
+			case Place::Zone:
+				if (key == "first" || key == "last") {
+					is_first_ = key == "first";
+					expect_ = Expect::Corner;
+				}
+				break;
+			case Place::Corner:
+				if (key == "row") {
+					expect_ = Expect::Row;
+				} else if (key == "col") {
+					expect_ = Expect::Col;
+				}
+				break;
+			default:
+				return false;
+			}
+			return true;
+		}
+
+		bool end_object() {
+			if (skip_depth_ > 0) {
+				--skip_depth_;
+				return true;
+			}
+			if (expect_ != Expect::Key) { return false; }
+			switch (place_) {
+			case Place::Corner:
+				place_ = Place::Zone;
+				break;
+			case Place::Zone:
+				if (coords_ != ALL_COORDS) { return false; }
+				has_zone_ = true;
+				place_ = Place::Ship;
+				break;
+			case Place::Ship:
+				if (!has_zone_ || !push_ship()) { return false; }
+				place_ = Place::Ships;
+				expect_ = Expect::Ship;
+				return true;
+			case Place::Root:
+				if (!has_ships_) { return false; }
+				place_ = Place::Done;
+				expect_ = Expect::Nothing;
+				return true;
+			default:
+				return false;
+			}
+			return true;
+		}
+
+		bool start_array([[maybe_unused]] std::size_t size) {
+			if (skip_depth_ > 0) {
+				++skip_depth_;
+				return true;
+			}
+			if (expect_ == Expect::Any) {
+				skip_depth_ = 1;
+				expect_ = Expect::Key;
+				return true;
+			}
+			if (expect_ != Expect::ShipsArray) { return false; }
+			place_ = Place::Ships;
+			expect_ = Expect::Ship;
+			return true;
+		}
+
+		bool end_array() {
+			if (skip_depth_ > 0) {
+				--skip_depth_;
+				return true;
+			}
+			if (place_ != Place::Ships || expect_ != Expect::Ship) { return false; }
+			place_ = Place::Root;
+			expect_ = Expect::Key;
+			return true;
+		}
+
+		bool parse_error(
+			[[maybe_unused]] std::size_t position,
+			[[maybe_unused]] const std::string& last_token,
+			[[maybe_unused]] const nlohmann::detail::exception& ex
+		) {
+			return false;
+		}
+
+	private:
+		// Object or array we're in
+		enum class Place { Top, Root, Ships, Ship, Zone, Corner, Done };
+		// What the next event should be
+		enum class Expect {
+			Root, Key, ShipsArray, Version, Ship, Zone, Corner, Row, Col,
+			// value of unknown key, which is skipped
+			Any,
+			Nothing
+		};
+
+		// bits of `coords_`: first.row, first.col, last.row, last.col
+		static constexpr u8 ALL_COORDS = 0b1111;
+
+		PlayerShips& ships_;
+		ProtocolVersion version_ {ProtocolVersion::V1};
+		Place place_ {Place::Top};
+		Expect expect_ {Expect::Root};
+		size_t skip_depth_ {0};
+		bool has_ships_ {false};
+		bool has_zone_ {false};
+		bool is_first_ {true};
+		u8 coords_ {0};
+		Position first_ {}, last_ {};
+
+		bool other_value() {
+			if (skip_depth_ > 0) { return true; }
+			if (expect_ != Expect::Any) { return false; }
+			expect_ = Expect::Key;
+			return true;
+		}
+
+		bool push_ship() {
+			Ship ship {Rectangle{first_, last_}};
+			u8 len = ship.length();
+			if (std::min(ship.zone.width(), ship.zone.height()) != 1
+				|| len == 0 || len > SHIP_TYPE_COUNT) {
+				return false;
+			}
+			ships_.push(std::move(ship));
+			return true;
+		}
+	};
+
+	// Decodes ships sent to /start straight from CBOR,
+	// returns protocol version of the client or nothing if the input is malformed
+	template<u8 ROWS, u8 COLS, u8 SHIP_TYPE_COUNT, const std::array<u8, SHIP_TYPE_COUNT>& RULES>
+	std::optional<ProtocolVersion> ships_from_cbor(
+		std::span<const u8> cbor,
+		Ships<ROWS, COLS, SHIP_TYPE_COUNT, RULES>& ships
+	) {
+		ShipsSax<ROWS, COLS, SHIP_TYPE_COUNT, RULES> sax {ships};
+		bool ok = json::sax_parse(cbor.begin(), cbor.end(), &sax, json::input_format_t::cbor);
+		if (!ok || !sax.is_complete()) {
+			return {};
+		}
+		return sax.version();
+	}
+} // namespace battleship
+
+#endif //BATTLESHIP_SHIPS_SAX_HPP
@@ -0,0 +1,181 @@
+#ifndef BATTLESHIP_UTIL_ASYNC_LOG_HPP
+#define BATTLESHIP_UTIL_ASYNC_LOG_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "log.hpp"
+#include "num_types.hpp"
+
+namespace battleship::log {
+	// Sink which hands records over to a background thread, writing them into `target`.
+	// Every logging thread has its own single-producer ring, so `write()` is a copy
+	// & a release store, no locks & no I/O. When a ring is full the record is dropped,
+	// the writer reports how many were lost.
+	class AsyncSink final: public Sink {
+	public:
+		explicit AsyncSink(Sink& target, size_t ring_capacity = 1024):
+			target_{target},
+			capacity_{std::bit_ceil(std::max<size_t>(ring_capacity, 2))},
+			writer_{[this](std::stop_token stop) { run(stop); }} {}
+
+		AsyncSink(const AsyncSink&) = delete;
+		AsyncSink& operator=(const AsyncSink&) = delete;
+
+		// Writes everything logged before
+		~AsyncSink() override {
+			writer_.request_stop();
+			writer_.join();
+		}
+
+		void write(const Record& record) override {
+			if (!local().push(record)) {
+				dropped_.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+
+		// Waits till the writer has taken all records logged before
+		void flush() override {
+			std::vector<Ring*> rings;
+			snapshot(rings);
+			for (Ring* ring: rings) {
+				ring->wait_empty();
+			}
+			target_.flush();
+		}
+
+	private:
+		// Single producer, single consumer
+		class Ring {
+		public:
+			explicit Ring(size_t capacity): slots_{std::make_unique<Record[]>(capacity)}, mask_{capacity - 1} {}
+
+			bool push(const Record& record) {
+				u64 tail = tail_.load(std::memory_order_relaxed);
+				if (tail - head_.load(std::memory_order_acquire) > mask_) {
+					return false;
+				}
+				slots_[tail & mask_] = record;
+				tail_.store(tail + 1, std::memory_order_release);
+				return true;
+			}
+
+			// Moves all records into `out`
+			void drain(std::vector<Record>& out) {
+				u64 head = head_.load(std::memory_order_relaxed);
+				u64 tail = tail_.load(std::memory_order_acquire);
+				for (; head != tail; ++head) {
+					out.push_back(slots_[head & mask_]);
+				}
+				head_.store(head, std::memory_order_release);
+			}
+
+			void wait_empty() const {
+				u64 tail = tail_.load(std::memory_order_acquire);
+				while (head_.load(std::memory_order_acquire) < tail) {
+					std::this_thread::sleep_for(IDLE_SLEEP);
+				}
+			}
+
+		private:
+			std::unique_ptr<Record[]> slots_;
+			const u64 mask_;
+			// Apart, so the producer & the consumer don't share a cache line
+			alignas(64) std::atomic<u64> head_ {0};
+			alignas(64) std::atomic<u64> tail_ {0};
+		};
+
+		static constexpr std::chrono::milliseconds IDLE_SLEEP {2};
+
+		Sink& target_;
+		const size_t capacity_;
+		// Tells apart sinks allocated at the same address
+		const u64 id_ {next_id()};
+		std::mutex mutex_;
+		// Never removed, a ring outlives its thread till the sink is destroyed
+		std::vector<std::unique_ptr<Ring>> rings_;
+		std::atomic<u64> dropped_ {0};
+		// The last member, so the thread starts after the rest is constructed
+		std::jthread writer_;
+
+		static u64 next_id() {
+			static std::atomic<u64> next {1};
+			return next.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		// Ring of the calling thread, registered on the first call
+		Ring& local() {
+			struct Cache {
+				u64 owner {0};
+				Ring* ring {nullptr};
+			};
+			thread_local Cache cache;
+			if (cache.owner != id_) {
+				std::scoped_lock lock{mutex_};
+				cache.ring = rings_.emplace_back(std::make_unique<Ring>(capacity_)).get();
+				cache.owner = id_;
+			}
+			return *cache.ring;
+		}
+
+		// Copies the list of rings into `out`, so that they are read without the lock.
+		// The writer reuses one vector, so polling doesn't allocate.
+		void snapshot(std::vector<Ring*>& out) {
+			std::scoped_lock lock{mutex_};
+			out.clear();
+			for (const auto& ring: rings_) {
+				out.push_back(ring.get());
+			}
+		}
+
+		// Writes out everything in the rings, returns whether there was anything
+		bool drain(std::vector<Ring*>& rings, std::vector<Record>& batch) {
+			batch.clear();
+			snapshot(rings);
+			for (Ring* ring: rings) {
+				ring->drain(batch);
+			}
+			u64 dropped = dropped_.exchange(0, std::memory_order_relaxed);
+			if (batch.empty() && dropped == 0) {
+				return false;
+			}
+			// Threads are drained one by one, so restore the order of all of them
+			std::stable_sort(batch.begin(), batch.end(), [](const Record& a, const Record& b) {
+				return a.time < b.time;
+			});
+			for (const Record& record: batch) {
+				target_.write(record);
+			}
+			if (dropped != 0) {
+				Record record;
+				record.time = std::chrono::system_clock::now();
+				record.level = Level::Warn;
+				record.thread = detail::thread_index();
+				RecordWriter writer {record};
+				writer.append("log records dropped");
+				writer.field(kv("count", dropped));
+				target_.write(record);
+			}
+			target_.flush();
+			return true;
+		}
+
+		void run(std::stop_token stop) {
+			std::vector<Ring*> rings;
+			std::vector<Record> batch;
+			while (!stop.stop_requested()) {
+				if (!drain(rings, batch)) {
+					std::this_thread::sleep_for(IDLE_SLEEP);
+				}
+			}
+			drain(rings, batch);
+		}
+	};
+} // namespace battleship::log
+
+#endif //BATTLESHIP_UTIL_ASYNC_LOG_HPP
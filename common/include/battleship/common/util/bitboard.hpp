@@ -0,0 +1,278 @@
+#ifndef BATTLESHIP_UTIL_BITBOARD_HPP
+#define BATTLESHIP_UTIL_BITBOARD_HPP
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <climits>
+#include <span>
+#include <string>
+#include <string_view>
+#include "num_types.hpp"
+
+namespace battleship {
+	// Set of N bits packed in 64-bit words.
+	// Unlike std::bitset it's usable in constant expressions & exposes its words,
+	// so masks can be precomputed at compile time & (de)serialized word by word.
+	// Bits past N are always zero.
+	template<size_t N>
+	class Bitboard {
+	public:
+		static constexpr size_t WORD_BITS = 64;
+		static constexpr size_t WORDS = (N + WORD_BITS - 1) / WORD_BITS;
+		static constexpr size_t BYTES = (N + CHAR_BIT - 1) / CHAR_BIT;
+
+		constexpr Bitboard() = default;
+
+		[[nodiscard]] static constexpr size_t size() {
+			return N;
+		}
+
+		[[nodiscard]] constexpr bool test(size_t i) const {
+			return ((words_[i / WORD_BITS] >> (i % WORD_BITS)) & 1U) != 0;
+		}
+
+		constexpr Bitboard& set(size_t i) {
+			words_[i / WORD_BITS] |= u64{1} << (i % WORD_BITS);
+			return *this;
+		}
+
+		constexpr Bitboard& reset(size_t i) {
+			words_[i / WORD_BITS] &= ~(u64{1} << (i % WORD_BITS));
+			return *this;
+		}
+
+		// Sets bits [first, first + count), touches at most 2 words if count <= 64
+		constexpr Bitboard& set_range(size_t first, size_t count) {
+			while (count > 0) {
+				size_t offset = first % WORD_BITS;
+				size_t chunk = std::min(count, WORD_BITS - offset);
+				u64 ones = (chunk == WORD_BITS) ? ~u64{0} : ((u64{1} << chunk) - 1);
+				words_[first / WORD_BITS] |= ones << offset;
+				first += chunk;
+				count -= chunk;
+			}
+			return *this;
+		}
+
+		[[nodiscard]] constexpr bool any() const {
+			return std::any_of(words_.begin(), words_.end(), [](u64 w) { return w != 0; });
+		}
+
+		[[nodiscard]] constexpr bool none() const {
+			return !any();
+		}
+
+		[[nodiscard]] constexpr size_t count() const {
+			size_t sum = 0;
+			for (u64 w: words_) { sum += static_cast<size_t>(std::popcount(w)); }
+			return sum;
+		}
+
+		// Same as (*this & other).any(), but without a temporary
+		[[nodiscard]] constexpr bool intersects(const Bitboard& other) const {
+			for (size_t i = 0; i < WORDS; ++i) {
+				if ((words_[i] & other.words_[i]) != 0) { return true; }
+			}
+			return false;
+		}
+
+		// All bits of `other` are set here
+		[[nodiscard]] constexpr bool contains(const Bitboard& other) const {
+			for (size_t i = 0; i < WORDS; ++i) {
+				if ((other.words_[i] & ~words_[i]) != 0) { return false; }
+			}
+			return true;
+		}
+
+		// Index of the `n`-th (from 0) set bit, N if there are fewer set bits
+		[[nodiscard]] constexpr size_t nth_set(size_t n) const {
+			for (size_t i = 0; i < WORDS; ++i) {
+				u64 w = words_[i];
+				auto ones = static_cast<size_t>(std::popcount(w));
+				if (n >= ones) {
+					n -= ones;
+					continue;
+				}
+				for (; n > 0; --n) { w &= w - 1; }
+				return i * WORD_BITS + static_cast<size_t>(std::countr_zero(w));
+			}
+			return N;
+		}
+
+		// Calls `f(index)` for every set bit in increasing order
+		template<typename F>
+		constexpr void for_each_set(F&& f) const {
+			for (size_t i = 0; i < WORDS; ++i) {
+				for (u64 w = words_[i]; w != 0; w &= w - 1) {
+					f(i * WORD_BITS + static_cast<size_t>(std::countr_zero(w)));
+				}
+			}
+		}
+
+		constexpr Bitboard& operator&=(const Bitboard& other) {
+			for (size_t i = 0; i < WORDS; ++i) { words_[i] &= other.words_[i]; }
+			return *this;
+		}
+
+		constexpr Bitboard& operator|=(const Bitboard& other) {
+			for (size_t i = 0; i < WORDS; ++i) { words_[i] |= other.words_[i]; }
+			return *this;
+		}
+
+		constexpr Bitboard& operator^=(const Bitboard& other) {
+			for (size_t i = 0; i < WORDS; ++i) { words_[i] ^= other.words_[i]; }
+			return *this;
+		}
+
+		// Towards higher indices
+		constexpr Bitboard& operator<<=(size_t shift) {
+			if (shift >= N) { return *this = Bitboard{}; }
+			size_t word_shift = shift / WORD_BITS;
+			size_t bit_shift = shift % WORD_BITS;
+			for (size_t i = WORDS; i-- > 0;) {
+				u64 w = 0;
+				if (i >= word_shift) {
+					w = words_[i - word_shift] << bit_shift;
+					if (bit_shift != 0 && i > word_shift) {
+						w |= words_[i - word_shift - 1] >> (WORD_BITS - bit_shift);
+					}
+				}
+				words_[i] = w;
+			}
+			return trim();
+		}
+
+		// Towards lower indices
+		constexpr Bitboard& operator>>=(size_t shift) {
+			if (shift >= N) { return *this = Bitboard{}; }
+			size_t word_shift = shift / WORD_BITS;
+			size_t bit_shift = shift % WORD_BITS;
+			for (size_t i = 0; i < WORDS; ++i) {
+				u64 w = 0;
+				if (i + word_shift < WORDS) {
+					w = words_[i + word_shift] >> bit_shift;
+					if (bit_shift != 0 && i + word_shift + 1 < WORDS) {
+						w |= words_[i + word_shift + 1] << (WORD_BITS - bit_shift);
+					}
+				}
+				words_[i] = w;
+			}
+			return *this;
+		}
+
+		[[nodiscard]] constexpr Bitboard operator~() const {
+			Bitboard result;
+			for (size_t i = 0; i < WORDS; ++i) { result.words_[i] = ~words_[i]; }
+			return result.trim();
+		}
+
+		friend constexpr Bitboard operator&(Bitboard a, const Bitboard& b) { return a &= b; }
+		friend constexpr Bitboard operator|(Bitboard a, const Bitboard& b) { return a |= b; }
+		friend constexpr Bitboard operator^(Bitboard a, const Bitboard& b) { return a ^= b; }
+		friend constexpr Bitboard operator<<(Bitboard a, size_t shift) { return a <<= shift; }
+		friend constexpr Bitboard operator>>(Bitboard a, size_t shift) { return a >>= shift; }
+
+		constexpr bool operator==(const Bitboard& other) const = default;
+
+		[[nodiscard]] constexpr const std::array<u64, WORDS>& words() const {
+			return words_;
+		}
+
+		// Bit i goes to bit (i % 8) of byte (i / 8)
+		[[nodiscard]] std::array<u8, BYTES> to_bytes() const {
+			std::array<u8, BYTES> bytes {};
+			for (size_t i = 0; i < BYTES; ++i) {
+				bytes[i] = static_cast<u8>(words_[i / sizeof(u64)] >> (CHAR_BIT * (i % sizeof(u64))));
+			}
+			return bytes;
+		}
+
+		// Reverse of `to_bytes()`, missing bytes are zeros, extra ones are ignored
+		static Bitboard from_bytes(std::span<const u8> bytes) {
+			Bitboard result;
+			size_t size = std::min(bytes.size(), BYTES);
+			for (size_t i = 0; i < size; ++i) {
+				result.words_[i / sizeof(u64)] |=
+					static_cast<u64>(bytes[i]) << (CHAR_BIT * (i % sizeof(u64)));
+			}
+			return result.trim();
+		}
+
+		// "0101..." with bit N - 1 first, like std::bitset::to_string()
+		[[nodiscard]] std::string to_string() const {
+			std::string str(N, '0');
+			for_each_set([&str](size_t i) { str[N - 1 - i] = '1'; });
+			return str;
+		}
+
+		// Reverse of `to_string()`, the last character is bit 0
+		static Bitboard from_string(std::string_view str) {
+			Bitboard result;
+			size_t size = std::min(str.size(), N);
+			for (size_t i = 0; i < size; ++i) {
+				if (str[str.size() - 1 - i] == '1') { result.set(i); }
+			}
+			return result;
+		}
+
+	private:
+		std::array<u64, WORDS> words_ {};
+
+		constexpr Bitboard& trim() {
+			if constexpr (N % WORD_BITS != 0) {
+				words_[WORDS - 1] &= (u64{1} << (N % WORD_BITS)) - 1;
+			}
+			return *this;
+		}
+	};
+
+	// Small counters, one per bit of Bitboard<N>, stored bit-sliced:
+	// plane p holds bit p of every counter. So a whole mask is added with
+	// a ripple of ANDs & XORs over the planes instead of N increments.
+	// Counters wrap around at 2^PLANES.
+	template<size_t N, size_t PLANES>
+	class BitCounters {
+	public:
+		// Adds 1 to the counters of all set bits of the mask
+		constexpr void add(Bitboard<N> carry) {
+			for (Bitboard<N>& plane: planes_) {
+				Bitboard<N> next = plane & carry;
+				plane ^= carry;
+				carry = next;
+				if (carry.none()) { break; }
+			}
+		}
+
+		// Bits of `candidates` with the largest counter among them, narrowed down from the top plane
+		[[nodiscard]] constexpr Bitboard<N> max_of(Bitboard<N> candidates) const {
+			for (size_t p = PLANES; p-- > 0;) {
+				Bitboard<N> with_bit = candidates & planes_[p];
+				if (with_bit.any()) {
+					candidates = with_bit;
+				}
+			}
+			return candidates;
+		}
+
+		// Bits with non-zero counters
+		[[nodiscard]] constexpr Bitboard<N> nonzero() const {
+			Bitboard<N> result;
+			for (const Bitboard<N>& plane: planes_) { result |= plane; }
+			return result;
+		}
+
+		[[nodiscard]] constexpr size_t get(size_t i) const {
+			size_t value = 0;
+			for (size_t p = 0; p < PLANES; ++p) {
+				value |= static_cast<size_t>(planes_[p].test(i)) << p;
+			}
+			return value;
+		}
+
+	private:
+		std::array<Bitboard<N>, PLANES> planes_ {};
+	};
+} // namespace battleship
+
+#endif //BATTLESHIP_UTIL_BITBOARD_HPP
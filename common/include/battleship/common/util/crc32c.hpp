@@ -0,0 +1,36 @@
+#ifndef BATTLESHIP_UTIL_CRC32C_HPP
+#define BATTLESHIP_UTIL_CRC32C_HPP
+
+#include <array>
+#include <span>
+#include "num_types.hpp"
+
+namespace battleship {
+	// CRC-32C (Castagnoli), table-driven
+	class Crc32c {
+	public:
+		[[nodiscard]] static u32 of(std::span<const u8> bytes) {
+			u32 crc = ~u32{0};
+			for (u8 byte: bytes) {
+				crc = TABLE[(crc ^ byte) & 0xFFU] ^ (crc >> 8);
+			}
+			return ~crc;
+		}
+
+	private:
+		static constexpr std::array<u32, 256> TABLE = [] {
+			constexpr u32 POLY = 0x82F63B78;
+			std::array<u32, 256> table {};
+			for (u32 i = 0; i < table.size(); ++i) {
+				u32 crc = i;
+				for (int bit = 0; bit < 8; ++bit) {
+					crc = (crc & 1U) ? (crc >> 1) ^ POLY : crc >> 1;
+				}
+				table[i] = crc;
+			}
+			return table;
+		}();
+	};
+} // namespace battleship
+
+#endif // BATTLESHIP_UTIL_CRC32C_HPP
@@ -107,7 +107,7 @@ namespace battleship {
 			}
 		}
 
-		Rectangle(const Position& first, const Position& last):
+		constexpr Rectangle(const Position& first, const Position& last):
 			first{first}, last{last}
 		{
 			if (first > last) { //NOLINT
@@ -123,20 +123,20 @@ namespace battleship {
 			return {*this, {static_cast<u8>(last.row + 1), first.col}};
 		}
 	
-		[[nodiscard]] inline bool contains(const Rectangle& other) const {
-			return (other.first >= first) && (other.last <= last); //NOLINT
+		[[nodiscard]] constexpr bool contains(const Rectangle& other) const {
+			return contains(other.first) && contains(other.last);
 		}
 
-		[[nodiscard]] inline bool contains(const Position& point) const {
+		[[nodiscard]] constexpr bool contains(const Position& point) const {
 			return (point.row >= first.row) && (point.row <= last.row)
 				&& (point.col >= first.col) && (point.col <= last.col);
 		}
 	
-		[[nodiscard]] inline u8 width() const {
+		[[nodiscard]] constexpr u8 width() const {
 			return static_cast<u8>(last.col - first.col + 1);
 		}
 
-		[[nodiscard]] inline u8 height() const {
+		[[nodiscard]] constexpr u8 height() const {
 			return static_cast<u8>(last.row - first.row + 1);
 		}
 
@@ -0,0 +1,103 @@
+#ifndef BATTLESHIP_UTIL_HISTOGRAM_HPP
+#define BATTLESHIP_UTIL_HISTOGRAM_HPP
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include "num_types.hpp"
+
+namespace battleship {
+	// Log-linear histogram of u64 values (e.g. latencies in microseconds), like HdrHistogram:
+	// values below 2^SUB_BITS have their own buckets, every higher power of two
+	// is split into 2^SUB_BITS equal buckets. So recording is a couple of shifts,
+	// the size is fixed & quantiles are off by less than 2^-SUB_BITS of the value.
+	template<u8 SUB_BITS = 5>
+	class Histogram {
+	public:
+		static constexpr size_t SUB_BUCKETS = size_t{1} << SUB_BITS;
+		static constexpr size_t BUCKETS = (64 - SUB_BITS + 1) * SUB_BUCKETS;
+
+		constexpr void record(u64 value) {
+			++counts_[bucket(value)];
+			++count_;
+			sum_ += value;
+			max_ = std::max(max_, value);
+		}
+
+		constexpr void merge(const Histogram& other) {
+			for (size_t i = 0; i < BUCKETS; ++i) {
+				counts_[i] += other.counts_[i];
+			}
+			count_ += other.count_;
+			sum_ += other.sum_;
+			max_ = std::max(max_, other.max_);
+		}
+
+		[[nodiscard]] constexpr u64 count() const {
+			return count_;
+		}
+
+		[[nodiscard]] constexpr u64 sum() const {
+			return sum_;
+		}
+
+		[[nodiscard]] constexpr u64 max() const {
+			return max_;
+		}
+
+		[[nodiscard]] constexpr double mean() const {
+			return (count_ == 0) ? 0.0 : static_cast<double>(sum_) / static_cast<double>(count_);
+		}
+
+		// The smallest recorded value which isn't less than `q` (from [0, 1]) of all values,
+		// rounded up to its bucket
+		[[nodiscard]] u64 quantile(double q) const {
+			if (count_ == 0) { return 0; }
+			auto rank = static_cast<u64>(std::ceil(q * static_cast<double>(count_)));
+			rank = std::clamp<u64>(rank, 1, count_);
+			u64 seen = 0;
+			for (size_t i = 0; i < BUCKETS; ++i) {
+				seen += counts_[i];
+				if (seen >= rank) {
+					return std::min(upper_bound(i), max_);
+				}
+			}
+			return max_;
+		}
+
+		// Number of values in the bucket & its range, for exporting the whole histogram
+		[[nodiscard]] constexpr u64 bucket_count(size_t i) const {
+			return counts_[i];
+		}
+
+		[[nodiscard]] static constexpr size_t bucket(u64 value) {
+			if (value < SUB_BUCKETS) {
+				return value;
+			}
+			// value >> shift has exactly SUB_BITS + 1 bits
+			size_t shift = 63 - SUB_BITS - static_cast<size_t>(std::countl_zero(value));
+			return (shift + 1) * SUB_BUCKETS + (value >> shift) - SUB_BUCKETS;
+		}
+
+		[[nodiscard]] static constexpr u64 lower_bound(size_t bucket) {
+			if (bucket < SUB_BUCKETS) {
+				return bucket;
+			}
+			size_t shift = bucket / SUB_BUCKETS - 1;
+			return u64{SUB_BUCKETS + bucket % SUB_BUCKETS} << shift;
+		}
+
+		[[nodiscard]] static constexpr u64 upper_bound(size_t bucket) {
+			return (bucket + 1 == BUCKETS) ? UINT64_MAX : lower_bound(bucket + 1) - 1;
+		}
+
+	private:
+		std::array<u64, BUCKETS> counts_ {};
+		u64 count_ {0};
+		u64 sum_ {0};
+		u64 max_ {0};
+	};
+} // namespace battleship
+
+#endif //BATTLESHIP_UTIL_HISTOGRAM_HPP
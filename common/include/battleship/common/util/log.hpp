@@ -0,0 +1,233 @@
+#ifndef BATTLESHIP_UTIL_LOG_HPP
+#define BATTLESHIP_UTIL_LOG_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <concepts>
+#include <ctime>
+#include <iostream>
+#include <mutex>
+#include <string_view>
+#include "num_types.hpp"
+
+// Records below this level are compiled out:
+// 0 trace, 1 debug, 2 info, 3 warn, 4 error, 5 off
+#ifndef BATTLESHIP_LOG_LEVEL
+#define BATTLESHIP_LOG_LEVEL 2
+#endif
+
+namespace battleship::log {
+	enum class Level : u8 {
+		Trace,
+		Debug,
+		Info,
+		Warn,
+		Error,
+		Off
+	};
+
+	inline constexpr std::array<std::string_view, 5> LEVEL_NAMES {
+		"TRACE", "DEBUG", "INFO", "WARN", "ERROR"
+	};
+
+	inline constexpr Level COMPILED_LEVEL = static_cast<Level>(BATTLESHIP_LOG_LEVEL);
+
+	// One log line: a message & key=value fields, formatted by the logging thread.
+	// Fixed size, so it's copied into a ring buffer without allocating. Longer text is cut.
+	struct Record {
+		static constexpr size_t CAPACITY = 224;
+
+		std::chrono::system_clock::time_point time;
+		Level level {Level::Info};
+		u32 thread {0};
+		u16 size {0};
+		std::array<char, CAPACITY> text;
+
+		[[nodiscard]] std::string_view message() const {
+			return {text.data(), size};
+		}
+	};
+
+	// Where records go. `write()` may be called by many threads at once.
+	class Sink {
+	public:
+		virtual ~Sink() = default;
+		virtual void write(const Record& record) = 0;
+		virtual void flush() {}
+	};
+
+	// "2021-06-01T12:00:00.123456Z INFO [3] message key=value ..."
+	inline void format(std::ostream& out, const Record& record) {
+		auto since_epoch = std::chrono::duration_cast<std::chrono::microseconds>(record.time.time_since_epoch());
+		std::time_t seconds = since_epoch.count() / 1'000'000;
+		auto micros = static_cast<u32>(since_epoch.count() % 1'000'000);
+		std::tm utc {};
+		gmtime_r(&seconds, &utc);
+
+		std::array<char, 64> time {};
+		size_t size = std::strftime(time.data(), time.size(), "%Y-%m-%dT%H:%M:%S", &utc);
+		std::array<char, 8> fraction {'.', '0', '0', '0', '0', '0', '0', 'Z'};
+		for (size_t i = 6; i > 0; --i, micros /= 10) {
+			fraction[i] = static_cast<char>('0' + micros % 10);
+		}
+
+		out.write(time.data(), static_cast<std::streamsize>(size));
+		out.write(fraction.data(), fraction.size());
+		out << ' ' << LEVEL_NAMES[static_cast<size_t>(record.level)]
+			<< " [" << record.thread << "] " << record.message() << '\n';
+	}
+
+	// Formats records into a stream under a mutex, e.g. into std::clog
+	class StreamSink final: public Sink {
+	public:
+		explicit StreamSink(std::ostream& out): out_{out} {}
+
+		void write(const Record& record) override {
+			std::scoped_lock lock{mutex_};
+			format(out_, record);
+		}
+
+		void flush() override {
+			std::scoped_lock lock{mutex_};
+			out_.flush();
+		}
+
+	private:
+		std::mutex mutex_;
+		std::ostream& out_;
+	};
+
+	namespace detail {
+		inline std::atomic<Sink*> sink {nullptr};
+		inline std::atomic<Level> level {COMPILED_LEVEL};
+
+		inline Sink& default_sink() {
+			static StreamSink sink {std::clog};
+			return sink;
+		}
+
+		// Small numbers are easier to read than std::thread::id
+		inline u32 thread_index() {
+			static std::atomic<u32> next {0};
+			thread_local u32 index = next.fetch_add(1, std::memory_order_relaxed);
+			return index;
+		}
+	} // namespace detail
+
+	// Records go to std::clog until another sink is set.
+	// The sink must outlive its use, `nullptr` restores the default one.
+	inline void set_sink(Sink* sink) {
+		detail::sink.store(sink, std::memory_order_release);
+	}
+
+	inline Sink& sink() {
+		Sink* sink = detail::sink.load(std::memory_order_acquire);
+		return (sink != nullptr) ? *sink : detail::default_sink();
+	}
+
+	// Runtime threshold, can't go below the compiled one
+	inline void set_level(Level level) {
+		detail::level.store(std::max(level, COMPILED_LEVEL), std::memory_order_relaxed);
+	}
+
+	[[nodiscard]] inline bool enabled(Level level) {
+		return level >= detail::level.load(std::memory_order_relaxed);
+	}
+
+	// Structured field of a record, made by `kv()`
+	template<typename T>
+	struct Field {
+		std::string_view key;
+		const T& value;
+	};
+
+	template<typename T>
+	[[nodiscard]] Field<T> kv(std::string_view key, const T& value) {
+		return {key, value};
+	}
+
+	// Appends text to a record & drops what doesn't fit
+	class RecordWriter {
+	public:
+		explicit RecordWriter(Record& record): record_{record} {}
+
+		void append(std::string_view text) {
+			size_t count = std::min(text.size(), Record::CAPACITY - record_.size);
+			std::copy_n(text.data(), count, record_.text.data() + record_.size);
+			record_.size = static_cast<u16>(record_.size + count);
+		}
+
+		void append(char c) {
+			append(std::string_view{&c, 1});
+		}
+
+		template<typename T>
+		void field(const Field<T>& field) {
+			append(' ');
+			append(field.key);
+			append('=');
+			value(field.value);
+		}
+
+	private:
+		Record& record_;
+
+		template<typename T>
+			requires std::same_as<T, bool>
+		void value(T value) {
+			append(value ? "true" : "false");
+		}
+
+		template<typename T>
+			requires (std::integral<T> || std::floating_point<T>) && (!std::same_as<T, bool>)
+		void value(T value) {
+			std::array<char, 32> buf {};
+			auto [end, ec] = std::to_chars(buf.data(), buf.data() + buf.size(), +value);
+			append(std::string_view{buf.data(), end});
+		}
+
+		// Strings are quoted only when they have to be
+		void value(std::string_view text) {
+			bool quote = text.empty() || text.find_first_of(" =\"\\\n") != std::string_view::npos;
+			if (!quote) {
+				return append(text);
+			}
+			append('"');
+			for (char c: text) {
+				if (c == '"' || c == '\\') {
+					append('\\');
+				}
+				append((c == '\n') ? ' ' : c);
+			}
+			append('"');
+		}
+	};
+
+	template<typename... Ts>
+	void write(Level level, std::string_view message, const Field<Ts>&... fields) {
+		Record record;
+		record.time = std::chrono::system_clock::now();
+		record.level = level;
+		record.thread = detail::thread_index();
+		RecordWriter writer {record};
+		writer.append(message);
+		(writer.field(fields), ...);
+		sink().write(record);
+	}
+} // namespace battleship::log
+
+// BATTLESHIP_LOG(Info, "message", log::kv("key", value), ...)
+// Below BATTLESHIP_LOG_LEVEL the arguments aren't even evaluated.
+#define BATTLESHIP_LOG(LEVEL, ...) \
+	do { \
+		if constexpr (::battleship::log::Level::LEVEL >= ::battleship::log::COMPILED_LEVEL) { \
+			if (::battleship::log::enabled(::battleship::log::Level::LEVEL)) { \
+				::battleship::log::write(::battleship::log::Level::LEVEL, __VA_ARGS__); \
+			} \
+		} \
+	} while (false)
+
+#endif //BATTLESHIP_UTIL_LOG_HPP
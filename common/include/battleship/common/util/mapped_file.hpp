@@ -0,0 +1,33 @@
+#ifndef BATTLESHIP_UTIL_MAPPED_FILE_HPP
+#define BATTLESHIP_UTIL_MAPPED_FILE_HPP
+
+#include <filesystem>
+#include <span>
+#include "num_types.hpp"
+
+namespace battleship {
+	// Whole file mapped read-only into memory, throws std::runtime_error if it can't be
+	class MappedFile {
+	public:
+		enum class Access : u8 {
+			// Read once from start to end
+			Sequential,
+			Random
+		};
+
+		explicit MappedFile(const std::filesystem::path& path, Access access = Access::Sequential);
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+		~MappedFile();
+
+		[[nodiscard]] inline std::span<const u8> bytes() const {
+			return {static_cast<const u8*>(data_), size_};
+		}
+
+	private:
+		void* data_ {nullptr};
+		size_t size_ {0};
+	};
+} // namespace battleship
+
+#endif // BATTLESHIP_UTIL_MAPPED_FILE_HPP
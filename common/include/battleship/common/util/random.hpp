@@ -0,0 +1,66 @@
+#ifndef BATTLESHIP_UTIL_RANDOM_HPP
+#define BATTLESHIP_UTIL_RANDOM_HPP
+
+#include <array>
+#include <bit>
+#include <limits>
+#include "num_types.hpp"
+
+namespace battleship {
+	// xoshiro256** by Blackman & Vigna: small, fast & good enough for games & simulations.
+	// Not cryptographically secure, don't use it for anything secret.
+	// Satisfies UniformRandomBitGenerator, so works with <random> distributions.
+	class Xoshiro256 {
+	public:
+		using result_type = u64;
+
+		// The state is expanded from the seed with splitmix64, so any seed is fine
+		explicit constexpr Xoshiro256(u64 seed = 0) {
+			for (u64& word: state_) {
+				seed += 0x9E3779B97F4A7C15;
+				u64 z = seed;
+				z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+				z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+				word = z ^ (z >> 31);
+			}
+		}
+
+		[[nodiscard]] static constexpr result_type min() {
+			return 0;
+		}
+
+		[[nodiscard]] static constexpr result_type max() {
+			return std::numeric_limits<result_type>::max();
+		}
+
+		constexpr result_type operator()() {
+			u64 result = std::rotl(state_[1] * 5, 7) * 9;
+			u64 t = state_[1] << 17;
+			state_[2] ^= state_[0];
+			state_[3] ^= state_[1];
+			state_[1] ^= state_[2];
+			state_[0] ^= state_[3];
+			state_[2] ^= t;
+			state_[3] = std::rotl(state_[3], 45);
+			return result;
+		}
+
+		// Uniform number in [0, bound), bound > 0.
+		// Lemire's multiply & shift with rejection, no division on the fast path.
+		constexpr u32 below(u32 bound) {
+			u64 product = ((*this)() >> 32) * bound;
+			if (static_cast<u32>(product) < bound) {
+				u32 threshold = (0U - bound) % bound;
+				while (static_cast<u32>(product) < threshold) {
+					product = ((*this)() >> 32) * bound;
+				}
+			}
+			return static_cast<u32>(product >> 32);
+		}
+
+	private:
+		std::array<u64, 4> state_ {};
+	};
+} // namespace battleship
+
+#endif //BATTLESHIP_UTIL_RANDOM_HPP
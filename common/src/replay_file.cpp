@@ -0,0 +1,213 @@
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <fcntl.h>
+#include <unistd.h>
+#include <zlib.h>
+#include "battleship/common/replay_file.hpp"
+#include "battleship/common/util/crc32c.hpp"
+
+namespace battleship {
+	namespace {
+		constexpr std::string_view MAGIC = "BSREPLAY";
+		constexpr std::string_view INDEX_MAGIC = "BSRINDEX";
+		constexpr size_t INDEX_ENTRY_SIZE = 16;
+		constexpr size_t FOOTER_SIZE = 16 + INDEX_MAGIC.size();
+		// Bigger blocks aren't written, so such a size means a corrupted header
+		constexpr u32 MAX_RAW_SIZE = 64 * 1024 * 1024;
+
+		[[noreturn]] void throw_errno(const std::string& what) {
+			throw std::runtime_error(what + ": " + std::strerror(errno));
+		}
+
+		void put(std::vector<u8>& out, u64 value, size_t size) {
+			for (size_t byte = 0; byte < size; ++byte) {
+				out.push_back(static_cast<u8>(value >> (8 * byte)));
+			}
+		}
+
+		u64 get(std::span<const u8> bytes, size_t offset, size_t size) {
+			u64 value = 0;
+			for (size_t byte = 0; byte < size; ++byte) {
+				value |= static_cast<u64>(bytes[offset + byte]) << (8 * byte);
+			}
+			return value;
+		}
+
+		bool has_magic(std::span<const u8> bytes, size_t offset, std::string_view magic) {
+			return bytes.size() >= offset + magic.size()
+				&& std::equal(magic.begin(), magic.end(), bytes.begin() + static_cast<ptrdiff_t>(offset));
+		}
+	} // namespace
+
+	ReplayFile::ReplayFile(const std::filesystem::path& path): file_{path, MappedFile::Access::Random} {
+		std::span<const u8> bytes = file_.bytes();
+		constexpr size_t FIXED = MAGIC.size() + 4;
+		if (bytes.size() < FIXED || !has_magic(bytes, 0, MAGIC)) {
+			throw std::runtime_error(path.string() + " isn't a replay file");
+		}
+		if (bytes[MAGIC.size()] != VERSION) {
+			throw std::runtime_error(path.string() + " has unknown version " + std::to_string(bytes[MAGIC.size()]));
+		}
+		format_.rows = bytes[MAGIC.size() + 1];
+		format_.cols = bytes[MAGIC.size() + 2];
+		size_t type_count = bytes[MAGIC.size() + 3];
+		if (bytes.size() < FIXED + type_count) {
+			throw std::runtime_error(path.string() + " is cut short");
+		}
+		format_.rules.assign(bytes.begin() + FIXED, bytes.begin() + static_cast<ptrdiff_t>(FIXED + type_count));
+		data_offset_ = FIXED + type_count;
+		is_complete_ = load_index();
+		if (!is_complete_) {
+			scan_blocks();
+		}
+	}
+
+	bool ReplayFile::load_index() {
+		std::span<const u8> bytes = file_.bytes();
+		if (bytes.size() < data_offset_ + FOOTER_SIZE
+		 || !has_magic(bytes, bytes.size() - INDEX_MAGIC.size(), INDEX_MAGIC)) {
+			return false;
+		}
+		size_t footer = bytes.size() - FOOTER_SIZE;
+		u64 index = get(bytes, footer, 8);
+		if (index < data_offset_ || index > footer || (footer - index) % INDEX_ENTRY_SIZE != 0) {
+			return false;
+		}
+		blocks_.reserve((footer - index) / INDEX_ENTRY_SIZE);
+		for (u64 entry = index; entry < footer; entry += INDEX_ENTRY_SIZE) {
+			blocks_.push_back({get(bytes, entry, 8), get(bytes, entry + 8, 8)});
+		}
+		games_ = get(bytes, footer + 8, 8);
+		return true;
+	}
+
+	void ReplayFile::scan_blocks() {
+		std::span<const u8> bytes = file_.bytes();
+		u64 offset = data_offset_;
+		while (auto compressed = payload(offset)) {
+			blocks_.push_back({offset, games_});
+			games_ += get(bytes, offset + 8, 4);
+			offset += BLOCK_HEADER_SIZE + compressed->size();
+		}
+	}
+
+	std::optional<std::span<const u8>> ReplayFile::payload(u64 offset) const {
+		std::span<const u8> bytes = file_.bytes();
+		if (offset + BLOCK_HEADER_SIZE > bytes.size()) { return {}; }
+		u64 size = get(bytes, offset, 4);
+		u64 raw_size = get(bytes, offset + 4, 4);
+		if (raw_size > MAX_RAW_SIZE || offset + BLOCK_HEADER_SIZE + size > bytes.size()) { return {}; }
+		auto compressed = bytes.subspan(offset + BLOCK_HEADER_SIZE, size);
+		if (Crc32c::of(compressed) != get(bytes, offset + 12, 4)) { return {}; }
+		return compressed;
+	}
+
+	size_t ReplayFile::find_block(u64 game) const {
+		if (game >= games_) { return blocks_.size(); }
+		auto next = std::upper_bound(blocks_.begin(), blocks_.end(), game, [](u64 g, const Block& block) {
+			return g < block.first_game;
+		});
+		return static_cast<size_t>(next - blocks_.begin()) - 1;
+	}
+
+	u32 ReplayFile::read_block(size_t block, std::vector<u8>& out) const {
+		u64 offset = blocks_[block].offset;
+		auto compressed = payload(offset);
+		if (!compressed.has_value()) {
+			throw std::runtime_error("corrupted replay block at " + std::to_string(offset));
+		}
+		std::span<const u8> bytes = file_.bytes();
+		out.resize(get(bytes, offset + 4, 4));
+		uLongf raw_size = out.size();
+		int result = ::uncompress(out.data(), &raw_size, compressed->data(), compressed->size());
+		if (result != Z_OK || raw_size != out.size()) {
+			throw std::runtime_error("can't decompress replay block at " + std::to_string(offset));
+		}
+		return static_cast<u32>(get(bytes, offset + 8, 4));
+	}
+
+	ReplayFileWriter::ReplayFileWriter(const std::filesystem::path& path, const ReplayFormat& format, int level):
+		level_{level},
+		fd_{::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)}
+	{
+		if (fd_ < 0) {
+			throw_errno("can't create " + path.string());
+		}
+		std::vector<u8> header {MAGIC.begin(), MAGIC.end()};
+		header.push_back(ReplayFile::VERSION);
+		header.push_back(format.rows);
+		header.push_back(format.cols);
+		header.push_back(static_cast<u8>(format.rules.size()));
+		header.insert(header.end(), format.rules.begin(), format.rules.end());
+		write_all(header);
+	}
+
+	ReplayFileWriter::~ReplayFileWriter() {
+		try {
+			close();
+		} catch (const std::exception&) {
+			// The blocks written so far are still found without the index
+		}
+	}
+
+	void ReplayFileWriter::write_all(std::span<const u8> bytes) {
+		bytes_written_.fetch_add(bytes.size(), std::memory_order_relaxed);
+		while (!bytes.empty()) {
+			ssize_t written = ::write(fd_, bytes.data(), bytes.size());
+			if (written < 0) {
+				if (errno == EINTR) { continue; }
+				throw_errno("replay write failed");
+			}
+			bytes = bytes.subspan(static_cast<size_t>(written));
+		}
+	}
+
+	void ReplayFileWriter::write(const ReplayBlock& block) {
+		if (block.games == 0) { return; }
+		std::vector<u8> out(ReplayFile::BLOCK_HEADER_SIZE + ::compressBound(block.bytes.size()));
+		uLongf size = out.size() - ReplayFile::BLOCK_HEADER_SIZE;
+		int result = ::compress2(
+			out.data() + ReplayFile::BLOCK_HEADER_SIZE, &size,
+			block.bytes.data(), block.bytes.size(), level_
+		);
+		if (result != Z_OK) {
+			throw std::runtime_error("can't compress replay block");
+		}
+		out.resize(ReplayFile::BLOCK_HEADER_SIZE + size);
+		std::vector<u8> header;
+		put(header, size, 4);
+		put(header, block.bytes.size(), 4);
+		put(header, block.games, 4);
+		put(header, Crc32c::of(std::span{out}.subspan(ReplayFile::BLOCK_HEADER_SIZE)), 4);
+		std::copy(header.begin(), header.end(), out.begin());
+
+		std::scoped_lock lock{mutex_};
+		if (fd_ < 0) {
+			throw std::runtime_error("replay file is closed");
+		}
+		put(index_, bytes_written(), 8);
+		put(index_, games(), 8);
+		write_all(out);
+		games_.fetch_add(block.games, std::memory_order_relaxed);
+	}
+
+	void ReplayFileWriter::close() {
+		std::scoped_lock lock{mutex_};
+		if (fd_ < 0) { return; }
+		u64 index = bytes_written();
+		put(index_, index, 8);
+		put(index_, games(), 8);
+		index_.insert(index_.end(), INDEX_MAGIC.begin(), INDEX_MAGIC.end());
+		write_all(index_);
+		int synced = ::fdatasync(fd_);
+		::close(fd_);
+		fd_ = -1;
+		if (synced != 0) {
+			throw_errno("replay sync failed");
+		}
+	}
+} // namespace battleship
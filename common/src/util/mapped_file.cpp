@@ -0,0 +1,44 @@
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "battleship/common/util/mapped_file.hpp"
+
+namespace battleship {
+	[[noreturn]] static void throw_errno(const std::string& what) {
+		throw std::runtime_error(what + ": " + std::strerror(errno));
+	}
+
+	MappedFile::MappedFile(const std::filesystem::path& path, Access access) {
+		int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (fd < 0) {
+			throw_errno("can't open " + path.string());
+		}
+		struct stat st {};
+		if (::fstat(fd, &st) != 0) {
+			::close(fd);
+			throw_errno("can't stat " + path.string());
+		}
+		size_ = static_cast<size_t>(st.st_size);
+		if (size_ > 0) {
+			data_ = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (data_ != MAP_FAILED) {
+				::madvise(data_, size_, (access == Access::Sequential) ? MADV_SEQUENTIAL : MADV_RANDOM);
+			}
+		}
+		::close(fd);
+		if (data_ == MAP_FAILED) {
+			throw_errno("can't map " + path.string());
+		}
+	}
+
+	MappedFile::~MappedFile() {
+		if (size_ > 0) {
+			::munmap(data_, size_);
+		}
+	}
+} // namespace battleship
@@ -0,0 +1,143 @@
+#include <array>
+#include <cmath>
+#include <gtest/gtest.h>
+#include "battleship/common/fleet_generator.hpp"
+
+namespace battleship::test {
+	namespace {
+		// Rules small enough to enumerate every layout: a 3-ship, a 2-ship & two 1-ships on 6x6
+		constexpr u8 ROWS = 6;
+		constexpr u8 COLS = 6;
+		constexpr Rules<3> SMALL_RULES {2, 1, 1};
+		constexpr std::array<u8, 4> LENGTHS {3, 2, 1, 1};
+
+		using SmallGrid = Grid<ROWS, COLS>;
+		using SmallFleetGen = FleetGenerator<ROWS, COLS, SMALL_RULES.size(), SMALL_RULES>;
+
+		// Share of layouts with a ship on every cell,
+		// & share of horizontal ships among the ships of every length
+		struct Frequencies {
+			std::array<double, SmallGrid::SIZE> cells {};
+			std::array<double, SMALL_RULES.size()> horizontal {};
+		};
+
+		struct Counts {
+			std::array<u64, SmallGrid::SIZE> cells {};
+			std::array<u64, SMALL_RULES.size()> horizontal {};
+			u64 layouts {0};
+
+			[[nodiscard]] Frequencies frequencies() const {
+				Frequencies result;
+				for (size_t i = 0; i < cells.size(); ++i) {
+					result.cells[i] = static_cast<double>(cells[i]) / static_cast<double>(layouts);
+				}
+				for (size_t len = 1; len <= horizontal.size(); ++len) {
+					auto ships = static_cast<double>(layouts * SMALL_RULES[len - 1]);
+					result.horizontal[len - 1] = static_cast<double>(horizontal[len - 1]) / ships;
+				}
+				return result;
+			}
+		};
+
+		// Every layout, ship by ship in the order of LENGTHS. Ships of the same length are
+		// ordered both ways, so every layout is counted the same number of times.
+		// Written without ShipMasks, so it doesn't share the generator's mistakes.
+		void enumerate(
+			size_t ship, const SmallGrid::Cells& blocked, const SmallGrid::Cells& occupied,
+			std::array<u8, SMALL_RULES.size()> horizontal, Counts& counts
+		) {
+			if (ship == LENGTHS.size()) {
+				for (size_t i = 0; i < SmallGrid::SIZE; ++i) {
+					counts.cells[i] += occupied.test(i) ? 1U : 0U;
+				}
+				for (size_t len = 0; len < horizontal.size(); ++len) {
+					counts.horizontal[len] += horizontal[len];
+				}
+				++counts.layouts;
+				return;
+			}
+			u8 len = LENGTHS[ship];
+			for (bool is_horizontal: {true, false}) {
+				// A 1-ship is the same in both orientations, it's counted as vertical
+				if (len == 1 && is_horizontal) { continue; }
+				for (u8 row = 0; row < ROWS; ++row) {
+					for (u8 col = 0; col < COLS; ++col) {
+						Rectangle zone {
+							{row, col},
+							{static_cast<u8>(row + (is_horizontal ? 0 : len - 1)),
+							 static_cast<u8>(col + (is_horizontal ? len - 1 : 0))}
+						};
+						if (zone.last.row >= ROWS || zone.last.col >= COLS) { continue; }
+						SmallGrid::Cells footprint = SmallGrid::mask(zone);
+						if (blocked.intersects(footprint)) { continue; }
+						SmallGrid::Cells next_blocked = blocked;
+						next_blocked |= SmallGrid::halo_mask(zone);
+						SmallGrid::Cells next_occupied = occupied;
+						next_occupied |= footprint;
+						auto next_horizontal = horizontal;
+						next_horizontal[len - 1] = static_cast<u8>(next_horizontal[len - 1] + (is_horizontal ? 1 : 0));
+						enumerate(ship + 1, next_blocked, next_occupied, next_horizontal, counts);
+					}
+				}
+			}
+		}
+
+		Frequencies exact() {
+			Counts counts;
+			enumerate(0, {}, {}, {}, counts);
+			return counts.frequencies();
+		}
+
+		Frequencies sample(u8 sweeps, size_t layouts) {
+			SmallFleetGen generate {42, sweeps};
+			Counts counts;
+			for (size_t n = 0; n < layouts; ++n) {
+				auto field = generate();
+				for (size_t i = 0; i < SmallGrid::SIZE; ++i) {
+					counts.cells[i] += field.grid.ship_cells().test(i) ? 1U : 0U;
+				}
+				for (const Ship& ship: field.ships.ships) {
+					if (ship.length() > 1 && ship.zone.height() == 1) {
+						++counts.horizontal[ship.length() - 1];
+					}
+				}
+				++counts.layouts;
+			}
+			return counts.frequencies();
+		}
+
+		// Largest deviation from the exact share, in standard errors of a share of `layouts` samples
+		double max_z_score(const Frequencies& sampled, const Frequencies& expected, size_t layouts) {
+			auto z = [&](double observed, double p, double trials) {
+				return std::abs(observed - p) / std::sqrt(p * (1 - p) / trials);
+			};
+			double result = 0;
+			for (size_t i = 0; i < SmallGrid::SIZE; ++i) {
+				result = std::max(result, z(sampled.cells[i], expected.cells[i], static_cast<double>(layouts)));
+			}
+			for (size_t len = 2; len <= SMALL_RULES.size(); ++len) {
+				double ships = static_cast<double>(layouts * SMALL_RULES[len - 1]);
+				result = std::max(result, z(sampled.horizontal[len - 1], expected.horizontal[len - 1], ships));
+			}
+			return result;
+		}
+
+		constexpr size_t LAYOUTS = 200'000;
+		// Of about 40 shares, which are all within 4.5 standard errors for an exact sampler
+		// (a false alarm is less likely than 1 in 1000), the seed is fixed anyway
+		constexpr double MAX_Z_SCORE = 4.5;
+
+		TEST(FleetGenerator, MatchesExhaustiveDistribution) {
+			Frequencies expected = exact();
+			Frequencies sampled = sample(SmallFleetGen::DEFAULT_SWEEPS, LAYOUTS);
+			EXPECT_LT(max_z_score(sampled, expected, LAYOUTS), MAX_Z_SCORE);
+		}
+
+		// The test can tell a biased generator: ships placed one by one, without sweeps
+		TEST(FleetGenerator, SequentialPlacementIsBiased) {
+			Frequencies expected = exact();
+			Frequencies sampled = sample(0, LAYOUTS);
+			EXPECT_GT(max_z_score(sampled, expected, LAYOUTS), 4 * MAX_Z_SCORE);
+		}
+	} // namespace
+} // namespace battleship::test
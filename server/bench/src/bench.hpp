@@ -0,0 +1,101 @@
+#ifndef BATTLESHIP_SERVER_BENCH_HPP
+#define BATTLESHIP_SERVER_BENCH_HPP
+
+#include <algorithm>
+#include <array>
+#include <thread>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include "game_store.hpp"
+
+namespace battleship::bench {
+	// Runs the benchmark on 1 to all hardware threads, as the server's I/O threads
+	inline void thread_range(benchmark::internal::Benchmark* bench) {
+		bench->ThreadRange(1, static_cast<int>(std::max(std::thread::hardware_concurrency(), 1U)))
+			->UseRealTime();
+	}
+
+	// Game played by shooting at every cell in order, so it ends in at most 200 shots
+	struct Game {
+		std::array<UUID, 2> players;
+		std::array<u8, 2> next_cell {0, 0};
+		u8 mover {0};
+	};
+
+	inline UUID make_uuid(u64 i) {
+		UUID uuid {};
+		for (size_t byte = 0; byte < sizeof(i); ++byte) {
+			uuid.data[byte] = static_cast<u8>(i >> (8 * byte));
+		}
+		uuid.data[15] = 0x42;
+		return uuid;
+	}
+
+	// Games in progress, new ones replace the finished.
+	// UUIDs are counted from `first_uuid`, so sets of games may share a store.
+	class Games {
+	public:
+		Games(GameStore& store, size_t count, u64 first_uuid = 1, u64 seed = 42)
+			: store_{store}, fleet_{seed}, next_uuid_{first_uuid}
+		{
+			games_.reserve(count);
+			for (size_t i = 0; i < count; ++i) {
+				games_.push_back(start());
+			}
+		}
+
+		Games(const Games&) = delete;
+		Games& operator=(const Games&) = delete;
+
+		// Makes one shot in the next game, returns false if the game is over
+		bool shoot() {
+			Game& game = games_[current_];
+			current_ = (current_ + 1) % games_.size();
+			u8& cell = game.next_cell[game.mover];
+			if (cell == PostSovietGame::GameGrid::SIZE) {
+				return false;
+			}
+			Position pos = PostSovietGame::GameGrid::position(cell);
+			++cell;
+			auto result = store_.shoot(game.players[game.mover], pos);
+			if (is_err(result)) {
+				return false;
+			}
+			if (!std::get<bool>(result)) {
+				game.mover ^= 1U;
+			}
+			return true;
+		}
+
+		// Replaces the game which has just refused a shot
+		void restart_previous() {
+			size_t previous = (current_ + games_.size() - 1) % games_.size();
+			for (const UUID& uuid: games_[previous].players) {
+				store_.remove_player(uuid);
+			}
+			games_[previous] = start();
+		}
+
+		[[nodiscard]] const std::vector<Game>& games() const {
+			return games_;
+		}
+
+	private:
+		GameStore& store_;
+		PostSovietGame::FleetGen fleet_;
+		std::vector<Game> games_;
+		size_t current_ {0};
+		u64 next_uuid_;
+
+		Game start() {
+			Game game {{make_uuid(next_uuid_), make_uuid(next_uuid_ + 1)}};
+			next_uuid_ += 2;
+			store_.add_player(game.players[0], fleet_());
+			store_.add_player(game.players[1], fleet_());
+			store_.create_room(game.players[0], game.players[1]);
+			return game;
+		}
+	};
+} // namespace battleship::bench
+
+#endif // BATTLESHIP_SERVER_BENCH_HPP
@@ -0,0 +1,88 @@
+#include <vector>
+#include <benchmark/benchmark.h>
+#include "bench.hpp"
+#include "game_store.hpp"
+
+namespace battleship::bench {
+	namespace {
+		// One store for every thread of a benchmark, as the server's I/O threads share it.
+		// Threads play their own games, so they meet only on the shard mutexes.
+		GameStore& shared_store() {
+			static GameStore store;
+			return store;
+		}
+
+		// Games of the thread have UUIDs of their own
+		u64 first_uuid(const benchmark::State& state) {
+			return (static_cast<u64>(state.thread_index()) << 32U) + 1;
+		}
+
+		void remove_games(GameStore& store, const Games& games) {
+			for (const Game& game: games.games()) {
+				for (const UUID& uuid: game.players) {
+					store.remove_player(uuid);
+				}
+			}
+		}
+
+		// A new player, who replaces the one added WINDOW players ago
+		void store_add_player(benchmark::State& state) {
+			constexpr size_t WINDOW = 1024;
+			GameStore& store = shared_store();
+			PostSovietGame::FleetGen fleet {42 + static_cast<u64>(state.thread_index())};
+			std::vector<Player> fields;
+			fields.reserve(WINDOW);
+			for (size_t i = 0; i < WINDOW; ++i) {
+				fields.emplace_back(fleet());
+			}
+			const u64 first = first_uuid(state);
+			u64 next = 0;
+			for (auto _: state) {
+				if (next >= WINDOW) {
+					store.remove_player(make_uuid(first + next - WINDOW));
+				}
+				store.add_player(make_uuid(first + next), Player{fields[next % WINDOW]});
+				++next;
+			}
+			for (u64 i = next - std::min<u64>(next, WINDOW); i < next; ++i) {
+				store.remove_player(make_uuid(first + i));
+			}
+			state.SetItemsProcessed(state.iterations());
+		}
+		BENCHMARK(store_add_player)->Apply(thread_range);
+
+		// A shot in one of the thread's games, a finished game is replaced within the timing
+		void store_shoot(benchmark::State& state) {
+			GameStore& store = shared_store();
+			Games games {store, 1024, first_uuid(state), 42 + static_cast<u64>(state.thread_index())};
+			for (auto _: state) {
+				if (!games.shoot()) {
+					games.restart_previous();
+				}
+			}
+			remove_games(store, games);
+			state.SetItemsProcessed(state.iterations());
+		}
+		BENCHMARK(store_shoot)->Apply(thread_range);
+
+		// The whole field of a player in one of the thread's half played games
+		void store_field(benchmark::State& state) {
+			GameStore& store = shared_store();
+			Games games {store, 1024, first_uuid(state), 42 + static_cast<u64>(state.thread_index())};
+			for (size_t i = 0; i < games.games().size() * 50; ++i) {
+				games.shoot();
+			}
+			const std::vector<Game>& played = games.games();
+			size_t next = 0;
+			for (auto _: state) {
+				const Game& game = played[next % played.size()];
+				auto update = store.field(game.players[next % 2]);
+				benchmark::DoNotOptimize(update);
+				++next;
+			}
+			remove_games(store, games);
+			state.SetItemsProcessed(state.iterations());
+		}
+		BENCHMARK(store_field)->Apply(thread_range);
+	} // namespace
+} // namespace battleship::bench
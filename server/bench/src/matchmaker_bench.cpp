@@ -0,0 +1,53 @@
+#include <algorithm>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include "bench.hpp"
+#include "game_store.hpp"
+#include "matchmaker.hpp"
+
+namespace battleship::bench {
+	namespace {
+		// Arrivals of /start: the player is added to the store & queued.
+		// Every thread is an I/O thread of its own, all of them share the matchmaker,
+		// & a player is removed WINDOW arrivals later, so the store doesn't grow.
+		void matchmaker_arrivals(benchmark::State& state) {
+			constexpr size_t WINDOW = 4096;
+			static GameStore store;
+			static Matchmaker matchmaker {store};
+
+			PostSovietGame::FleetGen fleet {42 + static_cast<u64>(state.thread_index())};
+			std::vector<Player> fields;
+			fields.reserve(WINDOW);
+			for (size_t i = 0; i < WINDOW; ++i) {
+				fields.emplace_back(fleet());
+			}
+			const u64 first = (static_cast<u64>(state.thread_index()) << 32U) + 1;
+			const u64 pairings = matchmaker.pairings();
+			u64 next = 0;
+			i64 full = 0;
+			for (auto _: state) {
+				if (next >= WINDOW) {
+					store.remove_player(make_uuid(first + next - WINDOW));
+				}
+				UUID uuid = make_uuid(first + next);
+				store.add_player(uuid, Player{fields[next % WINDOW]});
+				if (!matchmaker.enqueue(uuid, PostSovietGame{})) {
+					++full;
+				}
+				++next;
+			}
+			for (u64 i = next - std::min<u64>(next, WINDOW); i < next; ++i) {
+				store.remove_player(make_uuid(first + i));
+			}
+			state.SetItemsProcessed(state.iterations());
+			// Counters are summed over the threads, the first one counts for all of them
+			if (state.thread_index() == 0) {
+				state.counters["pairings"] = benchmark::Counter(
+					static_cast<double>(matchmaker.pairings() - pairings), benchmark::Counter::kIsRate
+				);
+			}
+			state.counters["queue_full"] = benchmark::Counter(static_cast<double>(full));
+		}
+		BENCHMARK(matchmaker_arrivals)->Apply(thread_range);
+	} // namespace
+} // namespace battleship::bench
@@ -0,0 +1,104 @@
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <vector>
+#include <unistd.h>
+#include <benchmark/benchmark.h>
+#include "bench.hpp"
+#include "game_store.hpp"
+#include "persistence.hpp"
+
+namespace battleship::bench {
+	namespace {
+		namespace fs = std::filesystem;
+
+		// Empty directory for the files of one benchmark, removed afterwards
+		class TempDir {
+		public:
+			TempDir(): path_{fs::temp_directory_path() / ("battleship-bench-" + std::to_string(::getpid()))} {
+				fs::remove_all(path_);
+				fs::create_directories(path_);
+			}
+
+			TempDir(const TempDir&) = delete;
+			TempDir& operator=(const TempDir&) = delete;
+
+			~TempDir() {
+				std::error_code ec;
+				fs::remove_all(path_, ec);
+			}
+
+			[[nodiscard]] const fs::path& path() const {
+				return path_;
+			}
+
+		private:
+			fs::path path_;
+		};
+
+		// Cost of a shot with the journal (Arg 1) & without it (Arg 0).
+		// Shots are appended to memory only, the writer thread syncs them every 10 ms.
+		void shoot_journal(benchmark::State& state) {
+			TempDir dir;
+			GameStore store;
+			std::optional<Persistence> persistence;
+			if (state.range(0) != 0) {
+				persistence.emplace(store, PersistenceConfig{dir.path(), std::chrono::milliseconds{10}, std::chrono::hours{1}});
+			}
+			Games games {store, 1024};
+			for (auto _: state) {
+				if (!games.shoot()) {
+					state.PauseTiming();
+					games.restart_previous();
+					state.ResumeTiming();
+				}
+			}
+			state.SetItemsProcessed(state.iterations());
+			if (persistence.has_value()) {
+				const Journal& journal = persistence->journal();
+				state.counters["bytes_per_record"] = benchmark::Counter(
+					static_cast<double>(journal.bytes_written()) / static_cast<double>(std::max<u64>(journal.records(), 1))
+				);
+				state.counters["records_per_sync"] = benchmark::Counter(
+					static_cast<double>(journal.records()) / static_cast<double>(std::max<u64>(journal.syncs(), 1))
+				);
+			}
+		}
+		BENCHMARK(shoot_journal)->Arg(0)->Arg(1)->UseRealTime();
+
+		// Recovery of Arg(0) games which are half played,
+		// from the journal alone (Arg(1) == 0) or from a snapshot (Arg(1) == 1)
+		void recovery(benchmark::State& state) {
+			TempDir dir;
+			const auto game_count = static_cast<size_t>(state.range(0));
+			{
+				GameStore store;
+				Persistence persistence {store, {dir.path(), std::chrono::milliseconds{10}, std::chrono::hours{1}}};
+				Games games {store, game_count};
+				for (size_t i = 0; i < game_count * 50; ++i) {
+					games.shoot();
+				}
+				if (state.range(1) != 0) {
+					persistence.snapshot();
+				}
+			}
+			Recovery last;
+			for (auto _: state) {
+				state.PauseTiming();
+				auto store = std::make_unique<GameStore>();
+				state.ResumeTiming();
+				last = recover(*store, dir.path());
+				benchmark::DoNotOptimize(last);
+				state.PauseTiming();
+				store.reset();
+				state.ResumeTiming();
+			}
+			state.SetItemsProcessed(state.iterations() * static_cast<i64>(last.snapshot_records + last.journal_records));
+			state.SetBytesProcessed(state.iterations() * static_cast<i64>(last.bytes));
+		}
+		BENCHMARK(recovery)
+			->ArgsProduct({{1000, 10000}, {0, 1}})
+			->ArgNames({"games", "snapshot"})
+			->Unit(benchmark::kMillisecond);
+	} // namespace
+} // namespace battleship::bench
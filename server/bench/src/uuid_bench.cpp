@@ -0,0 +1,42 @@
+#include <boost/uuid/random_generator.hpp>
+#include <openssl/rand.h>
+#include <benchmark/benchmark.h>
+#include "uuid_generator.hpp"
+
+namespace battleship::bench {
+	namespace {
+		// Session tokens as /start mints them now: copied out of a per-thread RAND_bytes() batch
+		void uuid_batched(benchmark::State& state) {
+			UuidGenerator& generate = UuidGenerator::local();
+			for (auto _: state) {
+				benchmark::DoNotOptimize(generate());
+			}
+			state.SetItemsProcessed(state.iterations());
+		}
+		BENCHMARK(uuid_batched);
+
+		// One RAND_bytes() call per token, i.e. without the batch
+		void uuid_rand_bytes(benchmark::State& state) {
+			for (auto _: state) {
+				UUID uuid {};
+				if (RAND_bytes(uuid.data, static_cast<int>(uuid.size())) != 1) {
+					state.SkipWithError("RAND_bytes() failed");
+					break;
+				}
+				benchmark::DoNotOptimize(uuid);
+			}
+			state.SetItemsProcessed(state.iterations());
+		}
+		BENCHMARK(uuid_rand_bytes);
+
+		// As /start used to mint them: a new MT19937, seeded from the OS, per request
+		void uuid_mt19937_per_request(benchmark::State& state) {
+			for (auto _: state) {
+				boost::uuids::random_generator_mt19937 generate;
+				benchmark::DoNotOptimize(generate());
+			}
+			state.SetItemsProcessed(state.iterations());
+		}
+		BENCHMARK(uuid_mt19937_per_request);
+	} // namespace
+} // namespace battleship::bench
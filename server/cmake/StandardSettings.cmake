@@ -15,6 +15,10 @@ option(${PROJECT_NAME}_USE_GOOGLE_MOCK "Use the GoogleMock project for extending
 
 option(${PROJECT_NAME}_USE_CATCH2 "Use the Catch2 project for creating unit tests." OFF)
 
+# Benchmarks
+# Currently supporting: Google Benchmark.
+option(${PROJECT_NAME}_ENABLE_BENCHMARKS "Build benchmarks of the game store & its persistence (from the `bench` subfolder)." OFF)
+
 # Static analyzers
 # Currently supporting: Clang-Tidy, Cppcheck.
 option(${PROJECT_NAME}_ENABLE_CLANG_TIDY "Enable static analysis with Clang-Tidy." ON)
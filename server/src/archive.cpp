@@ -0,0 +1,135 @@
+#include <algorithm>
+#include <charconv>
+#include <string>
+#include "archive.hpp"
+#include "battleship/common/util/log.hpp"
+
+namespace battleship {
+	namespace {
+		constexpr std::string_view FILE_PREFIX = "games-";
+		constexpr std::string_view FILE_SUFFIX = ".bsr";
+
+		// One past the highest N of "games-KIND-N.bsr" in the directory
+		u64 next_file_number(const std::filesystem::path& dir, std::string_view kind) {
+			std::string prefix = std::string{FILE_PREFIX} + std::string{kind} + "-";
+			u64 next = 0;
+			for (const auto& entry: std::filesystem::directory_iterator{dir}) {
+				std::string name = entry.path().filename().string();
+				if (!name.starts_with(prefix) || !name.ends_with(FILE_SUFFIX)) { continue; }
+				u64 number = 0;
+				const char* first = name.data() + prefix.size();
+				const char* last = name.data() + name.size() - FILE_SUFFIX.size();
+				auto [end, error] = std::from_chars(first, last, number);
+				if (error == std::errc{} && end == last) {
+					next = std::max(next, number + 1);
+				}
+			}
+			return next;
+		}
+	} // namespace
+
+	GameArchive::GameArchive(ArchiveConfig config): config_{std::move(config)} {
+		std::filesystem::create_directories(config_.dir);
+		for (size_t i = 0; i < series_.size(); ++i) {
+			Series& series = series_[i];
+			std::visit([&series]<typename Game>(Game /*kind*/) {
+				series.format = ReplayFormat::of<Game::ROWS, Game::COLS, Game::SHIP_TYPE_COUNT, Game::RULES>();
+			}, *game_kind(i));
+			series.kind = GAME_KIND_NAMES[i];
+			series.next_file = next_file_number(config_.dir, series.kind);
+		}
+		writer_ = std::thread{[this] { run(); }};
+	}
+
+	GameArchive::~GameArchive() {
+		{
+			std::scoped_lock lock{mutex_};
+			stopping_ = true;
+		}
+		wake_.notify_one();
+		writer_.join();
+	}
+
+	std::filesystem::path GameArchive::file_path(const std::filesystem::path& dir, std::string_view kind, u64 number) {
+		return dir / (std::string{FILE_PREFIX} + std::string{kind} + "-" + std::to_string(number) + std::string{FILE_SUFFIX});
+	}
+
+	bool GameArchive::count_game(Series& series) {
+		++series.block.games;
+		if (!series.block.is_full()) {
+			return false;
+		}
+		series.full.push_back(std::move(series.block));
+		series.block = {};
+		series.block.bytes.reserve(ReplayBlock::TARGET_SIZE + 256);
+		has_full_ = true;
+		return true;
+	}
+
+	void GameArchive::run() {
+		std::array<std::vector<ReplayBlock>, std::tuple_size_v<decltype(series_)>> blocks;
+		for (;;) {
+			bool stopping = false;
+			{
+				std::unique_lock lock{mutex_};
+				bool woken = wake_.wait_for(lock, config_.flush_interval, [this] {
+					return stopping_ || has_full_;
+				});
+				stopping = stopping_;
+				has_full_ = false;
+				for (size_t i = 0; i < series_.size(); ++i) {
+					blocks[i].swap(series_[i].full);
+					// On a timeout the block goes as it is, so games don't wait for traffic
+					if (!woken || stopping) {
+						blocks[i].push_back(std::move(series_[i].block));
+						series_[i].block = {};
+					}
+				}
+			}
+			auto now = std::chrono::steady_clock::now();
+			for (size_t i = 0; i < series_.size(); ++i) {
+				Series& series = series_[i];
+				for (const ReplayBlock& block: blocks[i]) {
+					write(series, block);
+				}
+				blocks[i].clear();
+				if (series.file.has_value() && (stopping || now - series.opened >= config_.rotate_interval)) {
+					close_file(series);
+				}
+			}
+			if (stopping) { return; }
+		}
+	}
+
+	void GameArchive::write(Series& series, const ReplayBlock& block) {
+		if (block.games == 0) { return; }
+		try {
+			if (!series.file.has_value()) {
+				series.file.emplace(file_path(config_.dir, series.kind, series.next_file++), series.format);
+				series.opened = std::chrono::steady_clock::now();
+			}
+			u64 before = series.file->bytes_written();
+			series.file->write(block);
+			games_.fetch_add(block.games, std::memory_order_relaxed);
+			bytes_written_.fetch_add(series.file->bytes_written() - before, std::memory_order_relaxed);
+		} catch (const std::exception& e) {
+			BATTLESHIP_LOG(Error, "archive write failed",
+				log::kv("kind", series.kind), log::kv("games", block.games),
+				log::kv("error", std::string_view{e.what()})
+			);
+			// The next block starts a fresh file
+			series.file.reset();
+		}
+	}
+
+	void GameArchive::close_file(Series& series) {
+		try {
+			series.file->close();
+		} catch (const std::exception& e) {
+			BATTLESHIP_LOG(Error, "archive close failed",
+				log::kv("kind", series.kind), log::kv("error", std::string_view{e.what()})
+			);
+		}
+		series.file.reset();
+	}
+} // namespace battleship
@@ -0,0 +1,108 @@
+#ifndef BATTLESHIP_SERVER_ARCHIVE_HPP
+#define BATTLESHIP_SERVER_ARCHIVE_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "battleship/common/replay_file.hpp"
+#include "game.hpp"
+
+namespace battleship {
+	// Where & how finished games are archived
+	struct ArchiveConfig {
+		std::filesystem::path dir;
+		// Games of a block which isn't full are written that often,
+		// at most that much is lost in a crash
+		std::chrono::seconds flush_interval {5};
+		// A new file is started that often, the finished one gets its index
+		std::chrono::seconds rotate_interval {3600};
+	};
+
+	// Writes finished games to replay files "games-KIND-N.bsr" of the directory, see `ReplayFile`.
+	// A file holds games of one board & rules, so every kind of game has its own series of files.
+	// Games are encoded into a block under a short lock, compression & I/O are done
+	// by the writer thread, so archiving a game costs the request thread about a microsecond.
+	// Archiving is best effort: write errors are logged & the games are dropped.
+	class GameArchive {
+	public:
+		// Continues the numbering of the files of every kind already in the directory
+		explicit GameArchive(ArchiveConfig config);
+		GameArchive(const GameArchive&) = delete;
+		GameArchive& operator=(const GameArchive&) = delete;
+		// Writes the remaining games & closes the file
+		~GameArchive();
+
+		// Thread safe
+		template<typename Game>
+		void add(const typename Game::Replay& game) {
+			bool is_full = false;
+			{
+				std::scoped_lock lock{mutex_};
+				Series& series = series_[GameKind{Game{}}.index()];
+				game.encode(series.block.bytes);
+				is_full = count_game(series);
+			}
+			if (is_full) {
+				wake_.notify_one();
+			}
+		}
+
+		[[nodiscard]] inline u64 games() const {
+			return games_.load(std::memory_order_relaxed);
+		}
+
+		[[nodiscard]] inline u64 bytes_written() const {
+			return bytes_written_.load(std::memory_order_relaxed);
+		}
+
+		[[nodiscard]] static std::filesystem::path file_path(
+			const std::filesystem::path& dir,
+			std::string_view kind,
+			u64 number
+		);
+
+	private:
+		// Files of one kind of game
+		struct Series {
+			std::string_view kind;
+			ReplayFormat format;
+			// Under the lock
+			ReplayBlock block;
+			// Full blocks waiting for the writer, under the lock
+			std::vector<ReplayBlock> full;
+			// Only the writer thread touches these
+			std::optional<ReplayFileWriter> file;
+			u64 next_file {0};
+			std::chrono::steady_clock::time_point opened;
+		};
+
+		const ArchiveConfig config_;
+		std::atomic<u64> games_ {0};
+		std::atomic<u64> bytes_written_ {0};
+
+		std::mutex mutex_;
+		std::condition_variable wake_;
+		std::array<Series, std::variant_size_v<GameKind>> series_;
+		bool has_full_ {false};
+		bool stopping_ {false};
+
+		std::thread writer_;
+
+		// Counts the game just encoded into the block, returns true if the block is full.
+		// Must be called under the lock.
+		bool count_game(Series& series);
+		void run();
+		void write(Series& series, const ReplayBlock& block);
+		// Closes the current file of the series, the next block starts a new one
+		static void close_file(Series& series);
+	};
+} // namespace battleship
+
+#endif // BATTLESHIP_SERVER_ARCHIVE_HPP
@@ -0,0 +1,92 @@
+#ifndef BATTLESHIP_SERVER_CBOR_WRITER_HPP
+#define BATTLESHIP_SERVER_CBOR_WRITER_HPP
+
+#include <span>
+#include <string_view>
+#include <vector>
+#include "battleship/common/util/num_types.hpp"
+
+namespace battleship {
+	// Appends CBOR items to a buffer, for responses too simple to build a json tree for.
+	// Heads are the shortest ones, the same as `json::to_cbor()` writes.
+	// Containers have a fixed size, the caller writes exactly that many items into them.
+	class CborWriter {
+	public:
+		explicit CborWriter(std::vector<u8>& out): out_{out} {}
+
+		void map(size_t size) {
+			head(MAP, size);
+		}
+
+		void array(size_t size) {
+			head(ARRAY, size);
+		}
+
+		void text(std::string_view text) {
+			head(TEXT, text.size());
+			out_.insert(out_.end(), text.begin(), text.end());
+		}
+
+		void bytes(std::span<const u8> bytes) {
+			head(BYTES, bytes.size());
+			out_.insert(out_.end(), bytes.begin(), bytes.end());
+		}
+
+		void integer(i64 value) {
+			if (value < 0) {
+				return head(NEGATIVE, static_cast<u64>(-1 - value));
+			}
+			head(UNSIGNED, static_cast<u64>(value));
+		}
+
+		void boolean(bool value) {
+			out_.push_back(value ? TRUE : FALSE);
+		}
+
+		void null() {
+			out_.push_back(NULL_VALUE);
+		}
+
+	private:
+		// Major types
+		static constexpr u8 UNSIGNED = 0;
+		static constexpr u8 NEGATIVE = 1;
+		static constexpr u8 BYTES = 2;
+		static constexpr u8 TEXT = 3;
+		static constexpr u8 ARRAY = 4;
+		static constexpr u8 MAP = 5;
+		// Simple values
+		static constexpr u8 FALSE = 0xF4;
+		static constexpr u8 TRUE = 0xF5;
+		static constexpr u8 NULL_VALUE = 0xF6;
+
+		std::vector<u8>& out_;
+
+		void head(u8 major, u64 value) {
+			u8 type = static_cast<u8>(major << 5);
+			if (value < 24) {
+				out_.push_back(static_cast<u8>(type | value));
+				return;
+			}
+			// 24, 25, 26, 27: 1, 2, 4, 8 bytes of big-endian value follow
+			if (value <= UINT8_MAX) {
+				put(type | 24U, value, 1);
+			} else if (value <= UINT16_MAX) {
+				put(type | 25U, value, 2);
+			} else if (value <= UINT32_MAX) {
+				put(type | 26U, value, 4);
+			} else {
+				put(type | 27U, value, 8);
+			}
+		}
+
+		void put(unsigned head, u64 value, size_t size) {
+			out_.push_back(static_cast<u8>(head));
+			for (size_t i = size; i > 0; --i) {
+				out_.push_back(static_cast<u8>(value >> ((i - 1) * 8)));
+			}
+		}
+	};
+} // namespace battleship
+
+#endif // BATTLESHIP_SERVER_CBOR_WRITER_HPP
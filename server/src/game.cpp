@@ -1,4 +1,19 @@
 #include <game.hpp>
 
 namespace battleship {
+	std::optional<GameKind> game_kind(size_t index) {
+		// Every kind by its index, the alternatives hold nothing to construct
+		static constexpr auto KINDS = []<size_t... I>(std::index_sequence<I...>) {
+			return std::array<GameKind, sizeof...(I)>{GameKind{std::in_place_index<I>}...};
+		}(std::make_index_sequence<std::variant_size_v<GameKind>>{});
+		if (index >= KINDS.size()) {
+			return {};
+		}
+		return KINDS[index];
+	}
+
+	std::optional<GameKind> game_kind(std::string_view name) {
+		auto found = std::find(GAME_KIND_NAMES.begin(), GAME_KIND_NAMES.end(), name);
+		return game_kind(static_cast<size_t>(found - GAME_KIND_NAMES.begin()));
+	}
 }
@@ -1,35 +1,141 @@
 #ifndef BATTLESHIP_SERVER_GAME_HPP
 #define BATTLESHIP_SERVER_GAME_HPP
 
+#include <algorithm>
 #include <unordered_map>
-#include <queue>
 #include <span>
 #include <optional>
+#include <string_view>
+#include <variant>
+#include <vector>
+#include <boost/container/static_vector.hpp>
 #include <boost/uuid/random_generator.hpp>
 #include <boost/uuid/uuid.hpp>
 #include <boost/container_hash/hash.hpp>
+#include "battleship/common/bot.hpp"
 #include "battleship/common/common.hpp"
+#include "battleship/common/fleet_generator.hpp"
+#include "battleship/common/replay.hpp"
+#include "mpmc_queue.hpp"
+#include "timer_wheel.hpp"
 
 namespace battleship {
-	constexpr u8 ROWS = 10;
-	constexpr u8 COLS = 10;
-
 	using UUID        = boost::uuids::uuid;
 	using UUIDArray   = std::array<UUID::value_type, UUID::static_size()>;
 	using UUIDVec     = std::vector<UUID::value_type>;
 	using UUIDSpan    = std::span<UUID::value_type, UUID::static_size()>;
 	using ShotCoords  = std::vector<u8>;
-	using StdShips    = Ships<ROWS, COLS, POST_SOVIET_RULES.size(), POST_SOVIET_RULES>;
-	using Player      = PlayerField<ROWS, COLS, POST_SOVIET_RULES.size(), POST_SOVIET_RULES>;
+
+	// Board & rules of a kind of game. Every kind has its own engine, instantiated
+	// with the sizes & the rules as constants, so hosting several kinds at once
+	// costs the hot path one dispatch per operation instead of runtime sizes everywhere.
+	// Cell indices of the board must fit 7 bits, see `GameReplay`.
+	template<u8 ROWS_, u8 COLS_, u8 SHIP_TYPE_COUNT_, const std::array<u8, SHIP_TYPE_COUNT_>& RULES_>
+	struct GameVariant {
+		static constexpr u8 ROWS = ROWS_;
+		static constexpr u8 COLS = COLS_;
+		static constexpr u8 SHIP_TYPE_COUNT = SHIP_TYPE_COUNT_;
+		static constexpr const std::array<u8, SHIP_TYPE_COUNT_>& RULES = RULES_;
+
+		using GameGrid = Grid<ROWS_, COLS_>;
+		using Fleet    = Ships<ROWS_, COLS_, SHIP_TYPE_COUNT_, RULES_>;
+		using Field    = PlayerField<ROWS_, COLS_, SHIP_TYPE_COUNT_, RULES_>;
+		using FleetGen = FleetGenerator<ROWS_, COLS_, SHIP_TYPE_COUNT_, RULES_>;
+		using Bot      = battleship::Bot<ROWS_, COLS_, SHIP_TYPE_COUNT_, RULES_>;
+		using Replay   = GameReplay<ROWS_, COLS_, SHIP_TYPE_COUNT_, RULES_>;
+	};
+
+	using PostSovietGame = GameVariant<10, 10, POST_SOVIET_RULES.size(), POST_SOVIET_RULES>;
+	using AmericanGame   = GameVariant<10, 10, AMERICAN_RULES.size(), AMERICAN_RULES>;
+
+	// Kind of game a player plays. It holds nothing but the index of the kind,
+	// so visiting it calls the engine of the kind. The index is saved to the journal,
+	// new kinds go to the end.
+	using GameKind = std::variant<PostSovietGame, AmericanGame>;
+
+	// Names of the kinds for ?rules=, in the order of `GameKind`
+	inline constexpr std::array<std::string_view, std::variant_size_v<GameKind>> GAME_KIND_NAMES {
+		"post-soviet", "american"
+	};
+
+	// Kind by its index or its name, nothing if there is no such kind
+	[[nodiscard]] std::optional<GameKind> game_kind(size_t index);
+	[[nodiscard]] std::optional<GameKind> game_kind(std::string_view name);
+
+	[[nodiscard]] inline std::string_view game_kind_name(const GameKind& kind) {
+		return GAME_KIND_NAMES[kind.index()];
+	}
+
+	// Engines of every kind, alternatives are in the order of `GameKind`
+	template<typename Kinds>
+	struct GameEngines;
+
+	template<typename... Games>
+	struct GameEngines<std::variant<Games...>> {
+		using Fleet = std::variant<typename Games::Fleet...>;
+		using Field = std::variant<typename Games::Field...>;
+		using Bot   = std::variant<typename Games::Bot...>;
+
+		// Of the largest board & the largest fleet
+		static constexpr size_t MAX_CELLS = std::max({static_cast<size_t>(Games::ROWS * Games::COLS)...});
+		static constexpr size_t MAX_SHIPS = std::max({Games::Fleet::SHIP_COUNT...});
+	};
+
+	using PlayerShips = GameEngines<GameKind>::Fleet;
+	using Player      = GameEngines<GameKind>::Field;
+	using PlayerBot   = GameEngines<GameKind>::Bot;
+
+	// Shots at one field, which can't outnumber its cells, so they are kept without the heap
+	using ShotList    = boost::container::static_vector<Position, GameEngines<GameKind>::MAX_CELLS>;
+
+	[[nodiscard]] inline GameKind kind_of(const Player& player) {
+		return *game_kind(player.index());
+	}
+
+	// Bot for the kind of game
+	[[nodiscard]] inline PlayerBot make_bot(const GameKind& kind, BotLevel level, u64 seed) {
+		return std::visit([&]<typename Game>(Game /*kind*/) -> PlayerBot {
+			return typename Game::Bot{level, seed};
+		}, kind);
+	}
+
+	[[nodiscard]] inline BotLevel level_of(const PlayerBot& bot) {
+		return std::visit([](const auto& engine) { return engine.level(); }, bot);
+	}
+
 	using PlayerList  = std::unordered_map<UUID, Player, boost::hash<UUID>>;
-	using PlayerQueue = std::queue<UUID>;
-	using RoomMap     = std::unordered_map<UUID, size_t, boost::hash<UUID>>;
+	using PlayerQueue = MpmcQueue<UUID>;
+	// player UUID -> UUID of the room owner (the first player of the room)
+	using RoomMap     = std::unordered_map<UUID, UUID, boost::hash<UUID>>;
 	
+	// Shot of a room's history
+	struct RoomShot {
+		// Index of the cell in the grid
+		u8 cell;
+		// The shot was at the second player of the room
+		bool at_second;
+	};
+
 	struct Room {
 		UUID uuid_player1, uuid_player2, move;
+		// Both players play the same kind of game
+		GameKind kind;
+		// Public id of the room, spectators know it by this one instead of the players' UUIDs
+		u64 id {0};
+		// Shots of the last turn & who made them, the enemy sees them as their move
+		ShotList turn_shots;
+		UUID turn_owner {};
+		// Every shot of the game in order, for the archive & for deltas of the fields
+		boost::container::static_vector<RoomShot, 2 * GameEngines<GameKind>::MAX_CELLS> history;
+		std::optional<UUID> winner;
+		// Deadline of the player who has the move, in the wheel of the room's shard
+		TimerHandle turn_timer;
+		// Number of changes (shots & forfeits), so that replaying the journal
+		// over a newer snapshot of the room skips them
+		u32 version {0};
 		
-		Room(UUID uuid1, UUID uuid2):
-			uuid_player1{uuid1}, uuid_player2{uuid2}, move{uuid1} {};
+		Room(UUID uuid1, UUID uuid2, GameKind kind = {}):
+			uuid_player1{uuid1}, uuid_player2{uuid2}, move{uuid1}, kind{kind} {};
 
 		[[nodiscard]] bool is_my_move(const UUID& uuid) const {
 			return uuid == move;
@@ -45,6 +151,9 @@ namespace battleship {
 			return {};
 		}
 	};
+
+	// room owner UUID -> room
+	using RoomList = std::unordered_map<UUID, Room, boost::hash<UUID>>;
 } // namespace battleship
 
 #endif // BATTLESHIP_SERVER_GAME_HPP
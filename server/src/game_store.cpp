@@ -0,0 +1,1170 @@
+#include <algorithm>
+#include <bit>
+#include <optional>
+#include <tuple>
+#include <thread>
+#include "game_store.hpp"
+
+namespace battleship {
+	// Whole ticks in the duration, at least one
+	static u64 ticks(std::chrono::seconds timeout) {
+		return std::max<u64>(static_cast<u64>(timeout / GameStore::TICK), 1);
+	}
+
+	GameStore::GameStore(size_t shard_count, GameTimeouts timeouts):
+		shards_{std::make_unique<Shard[]>(std::bit_ceil(std::max<size_t>(shard_count, 1)))}, // NOLINT
+		shard_mask_{std::bit_ceil(std::max<size_t>(shard_count, 1)) - 1},
+		epoch_{std::chrono::steady_clock::now()},
+		idle_ticks_{ticks(timeouts.idle)},
+		turn_ticks_{ticks(timeouts.turn)} {}
+
+	size_t GameStore::default_shard_count() {
+		size_t threads = std::max(std::thread::hardware_concurrency(), 1U);
+		return std::bit_ceil(std::max<size_t>(threads * 4, 16));
+	}
+
+	size_t GameStore::shard_index(const UUID& uuid) const {
+		// UUIDs are random, but mix the hash anyway, so that shard selection
+		// doesn't correlate with bucket selection inside the shard's maps
+		constexpr u64 GOLDEN_RATIO = 0x9E3779B97F4A7C15ULL;
+		u64 hash = boost::hash<UUID>{}(uuid) * GOLDEN_RATIO;
+		return (hash >> 32) & shard_mask_;
+	}
+
+	void GameStore::add_player(const UUID& uuid, Player&& player) {
+		Shard& s = shard(uuid);
+		std::scoped_lock lock{s.mutex};
+		auto [added, _] = s.players.insert_or_assign(uuid, std::move(player));
+		record_player(uuid, added->second, NO_BOT);
+		TimerHandle& timer = s.idle_timers[uuid];
+		s.timers.cancel(timer);
+		timer = s.timers.schedule(idle_ticks_, {Expiry::Kind::Idle, uuid});
+	}
+
+	void GameStore::remove_player(const UUID& uuid) {
+		Shard& s = shard(uuid);
+		std::scoped_lock lock{s.mutex};
+		if (auto room = s.rooms.find(uuid); room != s.rooms.end()) {
+			erase_room(s, room);
+		}
+		forget(s, uuid);
+	}
+
+	void GameStore::forget(Shard& s, const UUID& uuid) const {
+		if (auto timer = s.idle_timers.find(uuid); timer != s.idle_timers.end()) {
+			s.timers.cancel(timer->second);
+			s.idle_timers.erase(timer);
+		}
+		if (s.players.erase(uuid) > 0) {
+			record(RecordType::PlayerRemoved, [&](RecordWriter& writer) {
+				writer.uuid(uuid);
+			});
+		}
+		s.room_map.erase(uuid);
+		s.watchers.erase(uuid);
+		s.bots.erase(uuid);
+	}
+
+	void GameStore::erase_room(Shard& s, RoomList::iterator room) const {
+		s.timers.cancel(room->second.turn_timer);
+		record(RecordType::RoomRemoved, [&](RecordWriter& writer) {
+			writer.uuid(room->first);
+		});
+		s.room_ids.erase(room->second.id);
+		if (spectators_ != nullptr) {
+			spectators_->close(room->second.id);
+		}
+		s.rooms.erase(room);
+	}
+
+	void GameStore::record_player(const UUID& uuid, const Player& player, u8 bot_level) const {
+		record(RecordType::PlayerAdded, [&](RecordWriter& writer) {
+			writer.uuid(uuid);
+			writer.player(player);
+			writer.byte(bot_level);
+		});
+	}
+
+	void GameStore::touch(Shard& s, const UUID& uuid) const {
+		auto timer = s.idle_timers.find(uuid);
+		if (timer == s.idle_timers.end()) { return; }
+		// The timer may have just fired, then the pending expiry sees a new one & gives up
+		if (!s.timers.reschedule(timer->second, idle_ticks_)) {
+			timer->second = s.timers.schedule(idle_ticks_, {Expiry::Kind::Idle, uuid});
+		}
+	}
+
+	bool GameStore::is_expired(const Shard& s, const UUID& uuid) {
+		if (!s.players.contains(uuid)) { return false; }
+		auto timer = s.idle_timers.find(uuid);
+		return timer == s.idle_timers.end() || !s.timers.pending(timer->second);
+	}
+
+	size_t GameStore::expire(std::chrono::steady_clock::time_point now) {
+		auto tick = static_cast<u64>(std::max(now - epoch_, std::chrono::steady_clock::duration{0}) / TICK);
+		std::vector<Expiry> expired;
+		for (size_t i = 0; i < shard_count(); ++i) {
+			std::scoped_lock lock{shards_[i].mutex};
+			shards_[i].timers.advance(tick, expired);
+		}
+		// Handled after the wheels are unlocked, as both players of a room need to be locked
+		for (const Expiry& expiry: expired) {
+			switch (expiry.kind) {
+			case Expiry::Kind::Idle:
+				expire_player(expiry.uuid);
+				break;
+			case Expiry::Kind::Turn:
+				expire_turn(expiry.uuid);
+				break;
+			}
+		}
+		return expired.size();
+	}
+
+	void GameStore::expire_player(const UUID& uuid) {
+		Shard& mine = shard(uuid);
+		for (;;) {
+			auto member = membership(uuid);
+			if (is_ok(member)) {
+				auto [owner, enemy_uuid] = std::get<Membership>(member);
+				Shard& theirs = shard(enemy_uuid);
+				Shard& room_shard = (owner == uuid) ? mine : theirs;
+				Watcher enemy_watcher;
+				with_both(mine, theirs, [&] {
+					if (!is_expired(mine, uuid)) { return; }
+					if (auto room = room_shard.rooms.find(owner); room != room_shard.rooms.end()) {
+						if (!room->second.winner.has_value()) {
+							forfeit(room->second, enemy_uuid);
+							room_shard.timers.cancel(room->second.turn_timer);
+						}
+						// The enemy is a bot or is gone too, so nobody will see the room again
+						if (!theirs.idle_timers.contains(enemy_uuid)) {
+							erase_room(room_shard, room);
+							forget(theirs, enemy_uuid);
+						}
+					}
+					forget(mine, uuid);
+					expired_players_.fetch_add(1, std::memory_order_relaxed);
+					enemy_watcher = take_watcher(theirs, enemy_uuid);
+				});
+				notify(enemy_watcher);
+				return;
+			}
+			if (std::get<GameError>(member) != GameError::NoRoom) {
+				return;
+			}
+			std::scoped_lock lock{mine.mutex};
+			// The room could have been formed after the membership check
+			if (mine.room_map.contains(uuid)) {
+				continue;
+			}
+			if (is_expired(mine, uuid)) {
+				forget(mine, uuid);
+				expired_players_.fetch_add(1, std::memory_order_relaxed);
+			}
+			return;
+		}
+	}
+
+	void GameStore::expire_turn(const UUID& owner) {
+		Shard& s1 = shard(owner);
+		UUID uuid2;
+		{
+			std::scoped_lock lock{s1.mutex};
+			auto room = s1.rooms.find(owner);
+			if (room == s1.rooms.end()) { return; }
+			uuid2 = room->second.uuid_player2;
+		}
+		Shard& s2 = shard(uuid2);
+		Watcher watcher1, watcher2;
+		with_both(s1, s2, [&] {
+			auto room = s1.rooms.find(owner);
+			// The game has ended or the deadline has been moved by a shot since
+			if (room == s1.rooms.end()
+			 || room->second.winner.has_value()
+			 || s1.timers.pending(room->second.turn_timer)) {
+				return;
+			}
+			forfeit(room->second, *room->second.my_enemy(room->second.move));
+			// Bot is always the second player
+			s2.bots.erase(uuid2);
+			watcher1 = take_watcher(s1, owner);
+			watcher2 = take_watcher(s2, uuid2);
+		});
+		notify(watcher1);
+		notify(watcher2);
+	}
+
+	bool GameStore::contains(const UUID& uuid) const {
+		Shard& s = shard(uuid);
+		std::scoped_lock lock{s.mutex};
+		return s.players.contains(uuid);
+	}
+
+	bool GameStore::is_waiting(const UUID& uuid) const {
+		Shard& s = shard(uuid);
+		std::scoped_lock lock{s.mutex};
+		return s.players.contains(uuid) && !s.room_map.contains(uuid);
+	}
+
+	size_t GameStore::player_count() const {
+		size_t count = 0;
+		for (size_t i = 0; i < shard_count(); ++i) {
+			std::scoped_lock lock{shards_[i].mutex};
+			count += shards_[i].players.size();
+		}
+		return count;
+	}
+
+	size_t GameStore::room_count() const {
+		size_t count = 0;
+		for (size_t i = 0; i < shard_count(); ++i) {
+			std::scoped_lock lock{shards_[i].mutex};
+			count += shards_[i].rooms.size();
+		}
+		return count;
+	}
+
+	bool GameStore::create_room(const UUID& uuid1, const UUID& uuid2) {
+		if (uuid1 == uuid2) { return false; }
+		Shard& s1 = shard(uuid1);
+		Shard& s2 = shard(uuid2);
+		Watcher watcher1, watcher2;
+		bool created = with_both(s1, s2, [&] {
+			auto player1 = s1.players.find(uuid1);
+			auto player2 = s2.players.find(uuid2);
+			if (player1 == s1.players.end() || player2 == s2.players.end()) {
+				return false;
+			}
+			if (s1.room_map.contains(uuid1) || s2.room_map.contains(uuid2)) {
+				return false;
+			}
+			if (player1->second.index() != player2->second.index()) {
+				return false;
+			}
+			Room room {uuid1, uuid2, kind_of(player1->second)};
+			room.id = next_room_id_.fetch_add(1, std::memory_order_relaxed);
+			room.turn_timer = s1.timers.schedule(turn_ticks_, {Expiry::Kind::Turn, uuid1});
+			s1.room_ids.insert_or_assign(room.id, uuid1);
+			record(RecordType::RoomCreated, [&](RecordWriter& writer) {
+				writer.uuid(uuid1);
+				writer.uuid(uuid2);
+				writer.long_number(room.id);
+				writer.byte(static_cast<u8>(room.kind.index()));
+			});
+			s1.rooms.insert_or_assign(uuid1, std::move(room));
+			s1.room_map.insert_or_assign(uuid1, uuid1);
+			s2.room_map.insert_or_assign(uuid2, uuid1);
+			watcher1 = take_watcher(s1, uuid1);
+			watcher2 = take_watcher(s2, uuid2);
+			return true;
+		});
+		notify(watcher1);
+		notify(watcher2);
+		return created;
+	}
+
+	bool GameStore::create_bot_room(
+		const UUID& uuid,
+		const UUID& bot_uuid,
+		Player&& bot_field,
+		PlayerBot&& bot
+	) {
+		Shard& s = shard(bot_uuid);
+		{
+			std::scoped_lock lock{s.mutex};
+			auto [added, _] = s.players.insert_or_assign(bot_uuid, std::move(bot_field));
+			record_player(bot_uuid, added->second, static_cast<u8>(level_of(bot)));
+			s.bots.insert_or_assign(bot_uuid, std::move(bot));
+		}
+		if (!create_room(uuid, bot_uuid)) {
+			remove_player(bot_uuid);
+			return false;
+		}
+		return true;
+	}
+
+	GameStore::Watcher GameStore::take_watcher(Shard& s, const UUID& uuid) {
+		auto node = s.watchers.extract(uuid);
+		return node.empty() ? Watcher{} : std::move(node.mapped());
+	}
+
+	Result<GameStore::Membership, GameError> GameStore::membership(const UUID& uuid) const {
+		Shard& s = shard(uuid);
+		std::scoped_lock lock{s.mutex};
+		return membership_locked(s, uuid);
+	}
+
+	Result<GameStore::Membership, GameError> GameStore::membership_locked(const Shard& s, const UUID& uuid) {
+		if (!s.players.contains(uuid)) {
+			return GameError::NoSuchPlayer;
+		}
+		auto owner = s.room_map.find(uuid);
+		if (owner == s.room_map.end()) {
+			return GameError::NoRoom;
+		}
+		// If the player isn't the owner, then the owner is their enemy,
+		// otherwise the room is in this shard
+		if (owner->second != uuid) {
+			return Membership{owner->second, owner->second};
+		}
+		auto room = s.rooms.find(uuid);
+		if (room == s.rooms.end()) {
+			return GameError::NoRoom;
+		}
+		return Membership{uuid, room->second.uuid_player2};
+	}
+
+	Result<bool, GameError> GameStore::shoot(const UUID& uuid, const Position& pos) {
+		auto member = membership(uuid);
+		if (is_err(member)) {
+			return std::get<GameError>(member);
+		}
+		const auto& m = std::get<Membership>(member);
+		Shard& mine = shard(uuid);
+		Shard& theirs = shard(m.enemy);
+		Watcher my_watcher, enemy_watcher;
+		bool is_bot_move = false;
+		auto result = with_both(mine, theirs, [&] {
+			return shoot_locked(mine, theirs, uuid, m, pos, my_watcher, enemy_watcher, is_bot_move);
+		});
+		notify(my_watcher);
+		notify(enemy_watcher);
+		// The bot answers before the shot is reported, as it did under the same locks before
+		if (is_bot_move) {
+			play_bot(m.room_owner);
+		}
+		return result;
+	}
+
+	Result<bool, GameError> GameStore::shoot_locked(
+		Shard& mine,
+		Shard& theirs,
+		const UUID& uuid,
+		const Membership& member,
+		const Position& pos,
+		Watcher& my_watcher,
+		Watcher& enemy_watcher,
+		bool& is_bot_move
+	) {
+		const auto& [owner, enemy_uuid] = member;
+		Shard& room_shard = (owner == uuid) ? mine : theirs;
+		touch(mine, uuid);
+		auto room_it = room_shard.rooms.find(owner);
+		auto enemy = theirs.players.find(enemy_uuid);
+		if (room_it == room_shard.rooms.end() || enemy == theirs.players.end()) {
+			return GameError::NoRoom;
+		}
+		Room& room = room_it->second;
+		if (room.winner.has_value()) {
+			return GameError::GameOver;
+		}
+		if (!room.is_my_move(uuid)) {
+			return GameError::NotYourMove;
+		}
+		size_t first_shot = room.history.size();
+		auto shot = std::visit([&](auto& enemy_field) -> Result<bool, GameError> {
+			auto& grid = enemy_field.grid;
+			if (!grid.contains(pos)) {
+				return GameError::OutOfBounds;
+			}
+			if (grid.has_shot(pos)) {
+				return GameError::AlreadyShot;
+			}
+			return apply_shot(room, grid, uuid, enemy_uuid, pos);
+		}, enemy->second);
+		if (is_err(shot)) {
+			return shot;
+		}
+		if (room.winner.has_value()) {
+			// Bot has lost
+			theirs.bots.erase(enemy_uuid);
+			room_shard.timers.cancel(room.turn_timer);
+			archive(room, false);
+		} else {
+			room_shard.timers.reschedule(room.turn_timer, turn_ticks_);
+			is_bot_move = room.is_my_move(enemy_uuid) && theirs.bots.contains(enemy_uuid);
+		}
+		broadcast(room, first_shot);
+		my_watcher = take_watcher(mine, uuid);
+		enemy_watcher = take_watcher(theirs, enemy_uuid);
+		return shot;
+	}
+
+	template<typename GameGrid>
+	bool GameStore::apply_shot(
+		Room& room,
+		GameGrid& grid,
+		const UUID& shooter,
+		const UUID& target,
+		const Position& pos
+	) const {
+		bool hit = place_shot(room, grid, shooter, target, pos);
+		++room.version;
+		record(RecordType::ShotPlaced, [&](RecordWriter& writer) {
+			writer.uuid(room.uuid_player1);
+			writer.uuid(shooter);
+			writer.uuid(target);
+			writer.position(pos);
+			writer.number(room.version);
+		});
+		return hit;
+	}
+
+	template<typename GameGrid>
+	bool GameStore::place_shot(
+		Room& room,
+		GameGrid& grid,
+		const UUID& shooter,
+		const UUID& target,
+		const Position& pos
+	) {
+		grid.place_shot(pos);
+		bool hit = grid.has_ship(pos);
+		if (room.turn_owner != shooter) {
+			room.turn_shots.clear();
+			room.turn_owner = shooter;
+		}
+		room.turn_shots.push_back(pos);
+		room.move = hit ? shooter : target;
+		room.history.push_back({static_cast<u8>(GameGrid::index(pos)), target == room.uuid_player2});
+		if (hit && grid.all_ships_shot()) {
+			room.winner = shooter;
+		}
+		return hit;
+	}
+
+	void GameStore::forfeit(Room& room, const UUID& winner) {
+		room.winner = winner;
+		++room.version;
+		forfeits_.fetch_add(1, std::memory_order_relaxed);
+		record(RecordType::RoomForfeited, [&](RecordWriter& writer) {
+			writer.uuid(room.uuid_player1);
+			writer.uuid(winner);
+			writer.number(room.version);
+		});
+		archive(room, true);
+		broadcast(room, room.history.size());
+	}
+
+	void GameStore::archive(const Room& room, bool is_forfeit) const {
+		if (archive_ == nullptr || !room.winner.has_value()) { return; }
+		const Shard& s1 = shard(room.uuid_player1);
+		const Shard& s2 = shard(room.uuid_player2);
+		auto player1 = s1.players.find(room.uuid_player1);
+		auto player2 = s2.players.find(room.uuid_player2);
+		if (player1 == s1.players.end() || player2 == s2.players.end()) { return; }
+		std::visit([&]<typename Game>(Game /*kind*/) {
+			const auto* field1 = std::get_if<typename Game::Field>(&player1->second);
+			const auto* field2 = std::get_if<typename Game::Field>(&player2->second);
+			if (field1 == nullptr || field2 == nullptr) { return; }
+			typename Game::Replay game;
+			std::copy(room.uuid_player1.begin(), room.uuid_player1.end(), game.id.begin());
+			game.finished_at = static_cast<u64>(std::chrono::duration_cast<std::chrono::milliseconds>(
+				std::chrono::system_clock::now().time_since_epoch()
+			).count());
+			if (is_forfeit) {
+				game.forfeit_winner = (*room.winner == room.uuid_player1) ? 0 : 1;
+			}
+			game.ships = {field1->ships, field2->ships};
+			game.shots.reserve(room.history.size());
+			for (const RoomShot& shot: room.history) {
+				game.shots.push_back(shot.cell);
+			}
+			archive_->add<Game>(game);
+		}, room.kind);
+	}
+
+	RoomView GameStore::view(const Room& room, size_t from) const {
+		const Shard& s1 = shard(room.uuid_player1);
+		const Shard& s2 = shard(room.uuid_player2);
+		auto player1 = s1.players.find(room.uuid_player1);
+		auto player2 = s2.players.find(room.uuid_player2);
+		RoomView view {room.id, {}, static_cast<u8>(room.is_my_move(room.uuid_player2) ? 1 : 0), {}, false};
+		std::visit([&]<typename Game>(Game /*kind*/) {
+			using Field = typename Game::Field;
+			using GameGrid = typename Game::GameGrid;
+			// A player who has left can't be shot anymore, their shots are shown as misses
+			const std::array<const Field*, 2> fields {
+				(player1 != s1.players.end()) ? std::get_if<Field>(&player1->second) : nullptr,
+				(player2 != s2.players.end()) ? std::get_if<Field>(&player2->second) : nullptr
+			};
+			if (room.winner.has_value()) {
+				u8 winner = (*room.winner == room.uuid_player2) ? 1 : 0;
+				const Field* loser = fields[1 - winner];
+				view.winner = winner;
+				view.is_forfeit = loser == nullptr || !loser->grid.all_ships_shot();
+			}
+			view.shots.reserve(room.history.size() - std::min(from, room.history.size()));
+			// A hit sinks a ship if all of its cells are shot by then, not by now
+			std::array<typename GameGrid::Cells, 2> shot;
+			for (size_t i = 0; i < room.history.size(); ++i) {
+				const RoomShot& entry = room.history[i];
+				u8 field = entry.at_second ? 1 : 0;
+				shot[field].set(entry.cell);
+				if (i < from) { continue; }
+				Position pos = GameGrid::position(entry.cell);
+				auto result = SpectatorShot::Result::Miss;
+				if (fields[field] != nullptr && fields[field]->grid.has_ship(pos)) {
+					result = SpectatorShot::Result::Hit;
+					for (const Ship& ship: fields[field]->ships.ships) {
+						auto cells = GameGrid::mask(ship.zone);
+						if (cells.test(entry.cell)) {
+							if (shot[field].contains(cells)) {
+								result = SpectatorShot::Result::Sunk;
+							}
+							break;
+						}
+					}
+				}
+				view.shots.push_back({field, pos, result});
+			}
+		}, room.kind);
+		return view;
+	}
+
+	void GameStore::broadcast(const Room& room, size_t from) const {
+		// Nobody can subscribe in between, as that takes the locks of the room
+		if (spectators_ == nullptr || !spectators_->is_watched(room.id)) { return; }
+		spectators_->publish(room.id, SpectatorHub::encode(view(room, from)));
+		if (room.winner.has_value()) {
+			spectators_->close(room.id);
+		}
+	}
+
+	bool GameStore::watch(u64 room_id, std::shared_ptr<Spectator> spectator) {
+		if (spectators_ == nullptr) { return false; }
+		// The id doesn't tell the shard of the room, so look for it in all of them
+		std::optional<UUID> owner;
+		for (size_t i = 0; i < shard_count() && !owner.has_value(); ++i) {
+			std::scoped_lock lock{shards_[i].mutex};
+			if (auto found = shards_[i].room_ids.find(room_id); found != shards_[i].room_ids.end()) {
+				owner = found->second;
+			}
+		}
+		if (!owner.has_value()) { return false; }
+		Shard& s1 = shard(*owner);
+		UUID uuid2;
+		{
+			std::scoped_lock lock{s1.mutex};
+			auto room = s1.rooms.find(*owner);
+			if (room == s1.rooms.end() || room->second.id != room_id) { return false; }
+			uuid2 = room->second.uuid_player2;
+		}
+		Shard& s2 = shard(uuid2);
+		return with_both(s1, s2, [&] {
+			auto room = s1.rooms.find(*owner);
+			if (room == s1.rooms.end() || room->second.id != room_id) { return false; }
+			RoomView first = view(room->second, 0);
+			first.rules = game_kind_name(room->second.kind);
+			Frame state = SpectatorHub::encode(first);
+			if (room->second.winner.has_value()) {
+				if (spectator->push(state)) {
+					spectator->push(nullptr);
+				}
+			} else {
+				spectators_->subscribe(room_id, std::move(spectator), state);
+			}
+			return true;
+		});
+	}
+
+	std::vector<u64> GameStore::live_rooms(size_t limit) const {
+		std::vector<u64> ids;
+		for (size_t i = 0; i < shard_count() && ids.size() < limit; ++i) {
+			std::scoped_lock lock{shards_[i].mutex};
+			for (const auto& [owner, room]: shards_[i].rooms) {
+				if (ids.size() == limit) { break; }
+				if (!room.winner.has_value()) {
+					ids.push_back(room.id);
+				}
+			}
+		}
+		return ids;
+	}
+
+	void GameStore::play_bot(const UUID& owner) {
+		Shard& s1 = shard(owner);
+		UUID bot_uuid;
+		{
+			std::scoped_lock lock{s1.mutex};
+			auto room = s1.rooms.find(owner);
+			if (room == s1.rooms.end()) { return; }
+			// Bot is always the second player
+			bot_uuid = room->second.uuid_player2;
+		}
+		Shard& s2 = shard(bot_uuid);
+		// The bot's engine & its view of the enemy's grid as of the room's version.
+		// Hard level samples layouts for every shot, so the shots are chosen without the locks.
+		std::optional<PlayerBot> engine;
+		std::optional<Player> target;
+		u32 version = 0;
+		with_both(s1, s2, [&] {
+			auto room = s1.rooms.find(owner);
+			auto bot = s2.bots.find(bot_uuid);
+			auto player = s1.players.find(owner);
+			if (room == s1.rooms.end()
+			 || room->second.winner.has_value()
+			 || !room->second.is_my_move(bot_uuid)
+			 || bot == s2.bots.end()
+			 || player == s1.players.end()) {
+				return;
+			}
+			engine = bot->second;
+			target = player->second;
+			version = room->second.version;
+		});
+		if (!engine.has_value()) { return; }
+
+		ShotList shots;
+		// Both players of a room play the same kind of game, so only matching engines meet here
+		std::visit([&](auto& bot, auto& field) {
+			auto& grid = field.grid;
+			for (;;) {
+				Position pos = bot.next_shot();
+				// Bot only ever shoots new cells, but don't let it hang the game
+				if (grid.has_shot(pos)) { break; }
+				grid.place_shot(pos);
+				bool hit = grid.has_ship(pos);
+				bot.observe(pos, hit);
+				shots.push_back(pos);
+				if (!hit || grid.all_ships_shot()) { break; }
+			}
+		}, *engine, *target);
+
+		Watcher watcher;
+		with_both(s1, s2, [&] {
+			auto room_it = s1.rooms.find(owner);
+			auto bot = s2.bots.find(bot_uuid);
+			auto player = s1.players.find(owner);
+			// Anything but the bot's shots changes the version: the room has been forfeited
+			// or another thread has played the turn already
+			if (room_it == s1.rooms.end()
+			 || room_it->second.version != version
+			 || bot == s2.bots.end()
+			 || player == s1.players.end()) {
+				return;
+			}
+			Room& room = room_it->second;
+			size_t first_shot = room.history.size();
+			std::visit([&](auto& field) {
+				for (const Position& pos: shots) {
+					apply_shot(room, field.grid, bot_uuid, owner, pos);
+				}
+			}, player->second);
+			if (room.winner.has_value()) {
+				s2.bots.erase(bot);
+				s1.timers.cancel(room.turn_timer);
+				archive(room, false);
+			} else {
+				bot->second = std::move(*engine);
+				room.move = owner;
+				s1.timers.reschedule(room.turn_timer, turn_ticks_);
+			}
+			broadcast(room, first_shot);
+			watcher = take_watcher(s1, owner);
+		});
+		notify(watcher);
+	}
+
+	Status GameStore::status_of(const Room& room, const UUID& uuid) {
+		if (room.winner.has_value()) {
+			return {(*room.winner == uuid) ? Status::State::Won : Status::State::Lost, {}};
+		}
+		if (!room.is_my_move(uuid)) {
+			return {Status::State::EnemyMove, {}};
+		}
+		if (room.turn_owner != uuid) {
+			return {Status::State::YourMove, room.turn_shots};
+		}
+		return {Status::State::YourMove, {}};
+	}
+
+	Result<Status, GameError> GameStore::status(const UUID& uuid, Watcher&& watcher) {
+		Shard& mine = shard(uuid);
+		for (;;) {
+			auto member = membership(uuid);
+			if (is_ok(member)) {
+				const auto& m = std::get<Membership>(member);
+				Shard& room_shard = (m.room_owner == uuid) ? mine : shard(m.enemy);
+				return with_both(mine, room_shard, [&] {
+					return status_locked(mine, room_shard, uuid, m, std::move(watcher));
+				});
+			}
+			if (std::get<GameError>(member) != GameError::NoRoom) {
+				return std::get<GameError>(member);
+			}
+			std::scoped_lock lock{mine.mutex};
+			// The room could have been formed after the membership check
+			if (mine.room_map.contains(uuid)) {
+				continue;
+			}
+			return status_waiting(mine, uuid, std::move(watcher));
+		}
+	}
+
+	Result<Status, GameError> GameStore::status_locked(
+		Shard& mine,
+		Shard& room_shard,
+		const UUID& uuid,
+		const Membership& member,
+		Watcher&& watcher
+	) {
+		touch(mine, uuid);
+		auto room = room_shard.rooms.find(member.room_owner);
+		if (room == room_shard.rooms.end()) {
+			return GameError::NoRoom;
+		}
+		Status status = status_of(room->second, uuid);
+		if (status.is_waiting() && watcher) {
+			mine.watchers.insert_or_assign(uuid, std::move(watcher));
+		}
+		return status;
+	}
+
+	Result<Status, GameError> GameStore::status_waiting(Shard& mine, const UUID& uuid, Watcher&& watcher) {
+		if (!mine.players.contains(uuid)) {
+			return GameError::NoSuchPlayer;
+		}
+		touch(mine, uuid);
+		if (watcher) {
+			mine.watchers.insert_or_assign(uuid, std::move(watcher));
+		}
+		return Status{Status::State::WaitingForEnemy, {}};
+	}
+
+	Result<FieldUpdate, GameError> GameStore::field(const UUID& uuid, std::optional<u32> since) {
+		auto member = membership(uuid);
+		if (is_err(member) && std::get<GameError>(member) != GameError::NoRoom) {
+			return std::get<GameError>(member);
+		}
+		Shard& mine = shard(uuid);
+		if (is_err(member)) {
+			// Still waiting for an enemy, the field can't change
+			std::scoped_lock lock{mine.mutex};
+			return field_waiting(mine, uuid, since);
+		}
+		const auto& m = std::get<Membership>(member);
+		Shard& room_shard = (m.room_owner == uuid) ? mine : shard(m.enemy);
+		return with_both(mine, room_shard, [&] {
+			return field_locked(mine, room_shard, uuid, m, since);
+		});
+	}
+
+	Result<FieldUpdate, GameError> GameStore::field_locked(
+		Shard& mine,
+		Shard& room_shard,
+		const UUID& uuid,
+		const Membership& member,
+		std::optional<u32> since
+	) {
+		touch(mine, uuid);
+		auto player = mine.players.find(uuid);
+		auto room = room_shard.rooms.find(member.room_owner);
+		if (player == mine.players.end()) {
+			return GameError::NoSuchPlayer;
+		}
+		if (room == room_shard.rooms.end()) {
+			return GameError::NoRoom;
+		}
+		if (!room->second.is_my_move(uuid)) {
+			return GameError::NotYourMove;
+		}
+		return field_update(player->second, &room->second, uuid, since);
+	}
+
+	Result<FieldUpdate, GameError> GameStore::field_waiting(Shard& mine, const UUID& uuid, std::optional<u32> since) {
+		auto player = mine.players.find(uuid);
+		if (player == mine.players.end()) {
+			return GameError::NoSuchPlayer;
+		}
+		touch(mine, uuid);
+		return field_update(player->second, nullptr, uuid, since);
+	}
+
+	FieldUpdate GameStore::field_update(
+		const Player& player,
+		const Room* room,
+		const UUID& uuid,
+		std::optional<u32> since
+	) {
+		FieldUpdate update;
+		update.kind = kind_of(player);
+		std::visit([&]<typename Field>(const Field& field) {
+			using GameGrid = std::remove_cvref_t<decltype(field.grid)>;
+			const auto& shots = field.grid.shot_cells();
+			update.revision = static_cast<u32>(shots.count());
+			if (!since.has_value() || *since > update.revision) {
+				update.field = player;
+				return;
+			}
+			size_t missing = update.revision - *since;
+			if (missing == 0) {
+				return;
+			}
+			// Newest first, until all shots since the client's revision are found
+			if (room != nullptr) {
+				bool at_second = room->uuid_player2 == uuid;
+				update.shots.reserve(missing);
+				for (auto shot = room->history.rbegin(); shot != room->history.rend(); ++shot) {
+					if (update.shots.size() == missing) { break; }
+					if (shot->at_second == at_second) {
+						update.shots.push_back(GameGrid::position(shot->cell));
+					}
+				}
+			}
+			if (update.shots.size() < missing) {
+				update.shots.clear();
+				update.field = player;
+				return;
+			}
+			std::reverse(update.shots.begin(), update.shots.end());
+			typename GameGrid::Cells fresh;
+			for (const Position& pos: update.shots) {
+				fresh.set(GameGrid::index(pos));
+			}
+			const auto& ships = field.ships.ships;
+			for (size_t i = 0; i < ships.size(); ++i) {
+				auto cells = GameGrid::mask(ships[i].zone);
+				if (cells.intersects(fresh) && shots.contains(cells)) {
+					update.sunk.push_back(static_cast<u8>(i));
+				}
+			}
+		}, player);
+		return update;
+	}
+
+	// Widens the result of one operation to the result of a batch
+	template<typename T>
+	static GameStore::BatchResult batch_result(Result<T, GameError>&& result) {
+		return std::visit([](auto&& value) -> GameStore::BatchResult {
+			return std::forward<decltype(value)>(value);
+		}, std::move(result));
+	}
+
+	std::vector<GameStore::BatchResult> GameStore::batch(std::span<const BatchOp> ops) {
+		struct Step {
+			size_t op;
+			// Shards to lock, lo <= hi
+			size_t lo;
+			size_t hi;
+			bool known {false};
+			// Nothing if the player is in no room
+			std::optional<Membership> member;
+		};
+		std::vector<BatchResult> results(ops.size(), GameError::NoSuchPlayer);
+		std::vector<Step> steps;
+		steps.reserve(ops.size());
+		for (size_t i = 0; i < ops.size(); ++i) {
+			size_t index = shard_index(ops[i].uuid);
+			steps.push_back({i, index, index, false, {}});
+		}
+		const auto by_shards = [](const Step& a, const Step& b) {
+			return std::tie(a.lo, a.hi, a.op) < std::tie(b.lo, b.hi, b.op);
+		};
+		// Calls `f` with every run of steps, which lock the same shards
+		const auto for_each_run = [&steps](auto&& f) {
+			for (auto first = steps.begin(); first != steps.end();) {
+				auto last = std::find_if(first, steps.end(), [&first](const Step& step) {
+					return step.lo != first->lo || step.hi != first->hi;
+				});
+				f(std::span<Step>{first, last});
+				first = last;
+			}
+		};
+		// One operation on its own, when the batch's view of the player is stale
+		const auto run_alone = [this](const BatchOp& op) -> BatchResult {
+			switch (op.kind) {
+			case BatchOp::Kind::Shoot:
+				return batch_result(shoot(op.uuid, op.shot));
+			case BatchOp::Kind::Status:
+				return batch_result(status(op.uuid));
+			case BatchOp::Kind::Field:
+				return batch_result(field(op.uuid, op.since));
+			}
+			return GameError::NoSuchPlayer;
+		};
+
+		// Rooms of the players, every shard of the players is locked once
+		std::sort(steps.begin(), steps.end(), by_shards);
+		for_each_run([&](std::span<Step> run) {
+			Shard& s = shards_[run.front().lo];
+			std::scoped_lock lock{s.mutex};
+			for (Step& step: run) {
+				auto member = membership_locked(s, ops[step.op].uuid);
+				step.known = is_ok(member) || std::get<GameError>(member) == GameError::NoRoom;
+				if (is_ok(member)) {
+					step.member = std::get<Membership>(member);
+					step.hi = shard_index(step.member->enemy);
+					if (step.hi < step.lo) {
+						std::swap(step.lo, step.hi);
+					}
+				}
+			}
+		});
+		std::erase_if(steps, [](const Step& step) { return !step.known; });
+
+		// Both players of a room lock the same pair of shards, so operations
+		// on the room are in one run & keep their order
+		std::sort(steps.begin(), steps.end(), by_shards);
+		std::vector<Watcher> woken;
+		std::vector<size_t> stale;
+		for_each_run([&](std::span<Step> run) {
+			while (!run.empty()) {
+				// A run is cut after a shot which hands the move to a bot, so the bot answers
+				// before the next operations, just as it does before a single /shoot returns
+				std::optional<UUID> bot_room;
+				size_t done = with_both(shards_[run.front().lo], shards_[run.front().hi], [&] {
+					for (size_t i = 0; i < run.size(); ++i) {
+						const Step& step = run[i];
+						const BatchOp& op = ops[step.op];
+						Shard& mine = shard(op.uuid);
+						if (!step.member.has_value()) {
+							// The room could have been formed after the membership check
+							if (mine.room_map.contains(op.uuid)) {
+								stale.push_back(step.op);
+							} else if (op.kind == BatchOp::Kind::Shoot) {
+								results[step.op] = GameError::NoRoom;
+							} else if (op.kind == BatchOp::Kind::Status) {
+								results[step.op] = batch_result(status_waiting(mine, op.uuid, {}));
+							} else {
+								results[step.op] = batch_result(field_waiting(mine, op.uuid, op.since));
+							}
+							continue;
+						}
+						const Membership& member = *step.member;
+						Shard& theirs = shard(member.enemy);
+						Shard& room_shard = (member.room_owner == op.uuid) ? mine : theirs;
+						switch (op.kind) {
+						case BatchOp::Kind::Shoot: {
+							Watcher my_watcher, enemy_watcher;
+							bool is_bot_move = false;
+							results[step.op] = batch_result(shoot_locked(
+								mine, theirs, op.uuid, member, op.shot, my_watcher, enemy_watcher, is_bot_move
+							));
+							woken.push_back(std::move(my_watcher));
+							woken.push_back(std::move(enemy_watcher));
+							if (is_bot_move) {
+								bot_room = member.room_owner;
+								return i + 1;
+							}
+							break;
+						}
+						case BatchOp::Kind::Status:
+							results[step.op] = batch_result(status_locked(mine, room_shard, op.uuid, member, {}));
+							break;
+						case BatchOp::Kind::Field:
+							results[step.op] = batch_result(field_locked(mine, room_shard, op.uuid, member, op.since));
+							break;
+						}
+					}
+					return run.size();
+				});
+				for (Watcher& watcher: woken) {
+					notify(watcher);
+				}
+				woken.clear();
+				if (bot_room.has_value()) {
+					play_bot(*bot_room);
+				}
+				for (size_t i: stale) {
+					results[i] = run_alone(ops[i]);
+				}
+				stale.clear();
+				run = run.subspan(done);
+			}
+		});
+		return results;
+	}
+	void GameStore::snapshot(size_t index, std::vector<u8>& out) const {
+		const Shard& s = shards_[index];
+		std::scoped_lock lock{s.mutex};
+		for (const auto& [uuid, player]: s.players) {
+			u8 bot_level = NO_BOT;
+			if (auto bot = s.bots.find(uuid); bot != s.bots.end()) {
+				bot_level = static_cast<u8>(level_of(bot->second));
+			} else if (!s.idle_timers.contains(uuid)) {
+				bot_level = FINISHED_BOT;
+			}
+			RecordWriter writer {out, RecordType::PlayerAdded};
+			writer.uuid(uuid);
+			writer.player(player);
+			writer.byte(bot_level);
+		}
+		for (const auto& [owner, room]: s.rooms) {
+			RecordWriter writer {out, RecordType::RoomState};
+			writer.uuid(owner);
+			writer.room(room);
+		}
+	}
+
+	bool GameStore::replay(RecordType type, RecordReader& reader) {
+		switch (type) {
+		case RecordType::PlayerAdded: {
+			UUID uuid = reader.uuid();
+			Player player = reader.player();
+			u8 bot_level = reader.byte();
+			if (reader.failed()) { return false; }
+			Shard& s = shard(uuid);
+			GameKind kind = kind_of(player);
+			if (!s.players.try_emplace(uuid, std::move(player)).second) { return true; }
+			if (bot_level == NO_BOT) {
+				// Timers are scheduled once everything is replayed
+				s.idle_timers.try_emplace(uuid);
+			} else if (bot_level <= static_cast<u8>(BotLevel::Hard)) {
+				// The bot learns its past shots in `finish_recovery()`
+				s.bots.try_emplace(uuid, make_bot(kind, static_cast<BotLevel>(bot_level), boost::hash<UUID>{}(uuid)));
+			}
+			return true;
+		}
+		case RecordType::RoomCreated: {
+			UUID owner = reader.uuid();
+			UUID uuid2 = reader.uuid();
+			u64 id = reader.long_number();
+			GameKind kind = reader.kind();
+			if (reader.failed()) { return false; }
+			if (auto [room, added] = shard(owner).rooms.try_emplace(owner, owner, uuid2, kind); added) {
+				room->second.id = id;
+				shard(owner).room_ids.insert_or_assign(id, owner);
+			}
+			shard(owner).room_map.insert_or_assign(owner, owner);
+			shard(uuid2).room_map.insert_or_assign(uuid2, owner);
+			// Rooms created from now on get new ids
+			if (id >= next_room_id_.load(std::memory_order_relaxed)) {
+				next_room_id_.store(id + 1, std::memory_order_relaxed);
+			}
+			return true;
+		}
+		case RecordType::RoomState: {
+			UUID owner = reader.uuid();
+			Room room = reader.room(owner);
+			if (reader.failed()) { return false; }
+			shard(owner).room_map.insert_or_assign(owner, owner);
+			shard(room.uuid_player2).room_map.insert_or_assign(room.uuid_player2, owner);
+			shard(owner).room_ids.insert_or_assign(room.id, owner);
+			if (room.id >= next_room_id_.load(std::memory_order_relaxed)) {
+				next_room_id_.store(room.id + 1, std::memory_order_relaxed);
+			}
+			shard(owner).rooms.insert_or_assign(owner, std::move(room));
+			return true;
+		}
+		case RecordType::ShotPlaced: {
+			UUID owner = reader.uuid();
+			UUID shooter = reader.uuid();
+			UUID target = reader.uuid();
+			Position pos = reader.position();
+			u32 version = reader.number();
+			if (reader.failed()) { return false; }
+			auto player = shard(target).players.find(target);
+			// The target has left since, & so has the game
+			if (player == shard(target).players.end()) { return true; }
+			return std::visit([&](auto& field) {
+				auto& grid = field.grid;
+				if (!grid.contains(pos)) { return false; }
+				// Snapshots of the room & of the target's grid may be taken at different moments,
+				// so the shot always lands on the grid, but changes the room only if it's newer
+				auto room = shard(owner).rooms.find(owner);
+				if (room != shard(owner).rooms.end() && version > room->second.version) {
+					place_shot(room->second, grid, shooter, target, pos);
+					room->second.version = version;
+				} else {
+					grid.place_shot(pos);
+				}
+				return true;
+			}, player->second);
+		}
+		case RecordType::RoomForfeited: {
+			UUID owner = reader.uuid();
+			UUID winner = reader.uuid();
+			u32 version = reader.number();
+			if (reader.failed()) { return false; }
+			auto room = shard(owner).rooms.find(owner);
+			if (room != shard(owner).rooms.end() && version > room->second.version) {
+				room->second.winner = winner;
+				room->second.version = version;
+			}
+			return true;
+		}
+		case RecordType::PlayerRemoved: {
+			UUID uuid = reader.uuid();
+			if (reader.failed()) { return false; }
+			forget(shard(uuid), uuid);
+			return true;
+		}
+		case RecordType::RoomRemoved: {
+			UUID owner = reader.uuid();
+			if (reader.failed()) { return false; }
+			if (auto room = shard(owner).rooms.find(owner); room != shard(owner).rooms.end()) {
+				shard(owner).room_ids.erase(room->second.id);
+				shard(owner).rooms.erase(room);
+			}
+			return true;
+		}
+		}
+		return false;
+	}
+
+	std::vector<std::pair<UUID, GameKind>> GameStore::finish_recovery() {
+		std::vector<std::pair<UUID, GameKind>> waiting;
+		for (size_t i = 0; i < shard_count(); ++i) {
+			Shard& s = shards_[i];
+			for (auto& [uuid, timer]: s.idle_timers) {
+				timer = s.timers.schedule(idle_ticks_, {Expiry::Kind::Idle, uuid});
+				auto player = s.players.find(uuid);
+				if (player != s.players.end() && !s.room_map.contains(uuid)) {
+					waiting.emplace_back(uuid, kind_of(player->second));
+				}
+			}
+			for (auto& [owner, room]: s.rooms) {
+				if (!room.winner.has_value()) {
+					room.turn_timer = s.timers.schedule(turn_ticks_, {Expiry::Kind::Turn, owner});
+				}
+			}
+			for (auto bot = s.bots.begin(); bot != s.bots.end();) {
+				bot = restore_bot(s, bot->first, bot->second) ? std::next(bot) : s.bots.erase(bot);
+			}
+		}
+		return waiting;
+	}
+
+	void GameStore::resume_bots() {
+		std::vector<UUID> owners;
+		for (size_t i = 0; i < shard_count(); ++i) {
+			std::scoped_lock lock{shards_[i].mutex};
+			for (const auto& [owner, room]: shards_[i].rooms) {
+				if (!room.winner.has_value() && room.is_my_move(room.uuid_player2)) {
+					owners.push_back(owner);
+				}
+			}
+		}
+		// Rooms of two humans are skipped by `play_bot()`
+		for (const UUID& owner: owners) {
+			play_bot(owner);
+		}
+	}
+
+	bool GameStore::restore_bot(const Shard& s, const UUID& bot_uuid, PlayerBot& bot) const {
+		// Bot is always the second player, its target is the owner of the room
+		auto owner = s.room_map.find(bot_uuid);
+		if (owner == s.room_map.end()) { return false; }
+		const Shard& room_shard = shard(owner->second);
+		auto room = room_shard.rooms.find(owner->second);
+		auto target = room_shard.players.find(owner->second);
+		if (room == room_shard.rooms.end()
+		 || room->second.winner.has_value()
+		 || target == room_shard.players.end()) {
+			return false;
+		}
+		// Both play the same kind of game, so only matching engines meet here
+		std::visit([](auto& engine, const auto& field) {
+			using GameGrid = std::remove_cvref_t<decltype(field.grid)>;
+			for (size_t cell = 0; cell < GameGrid::SIZE; ++cell) {
+				Position pos = GameGrid::position(cell);
+				if (field.grid.has_shot(pos)) {
+					engine.observe(pos, field.grid.has_ship(pos));
+				}
+			}
+		}, bot, target->second);
+		return true;
+	}
+} // namespace battleship
@@ -0,0 +1,387 @@
+#ifndef BATTLESHIP_SERVER_GAME_STORE_HPP
+#define BATTLESHIP_SERVER_GAME_STORE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <utility>
+#include <variant>
+#include <vector>
+#include "archive.hpp"
+#include "game.hpp"
+#include "journal.hpp"
+#include "spectators.hpp"
+
+namespace battleship {
+	enum class GameError {
+		NoSuchPlayer,
+		NoRoom,
+		NotYourMove,
+		OutOfBounds,
+		AlreadyShot,
+		GameOver
+	};
+
+	struct Status {
+		enum class State {
+			WaitingForEnemy,
+			EnemyMove,
+			YourMove,
+			Won,
+			Lost
+		};
+
+		State state;
+		// Enemy's shots since the player's last move
+		ShotList enemy_move;
+
+		[[nodiscard]] inline bool is_waiting() const {
+			return state == State::WaitingForEnemy || state == State::EnemyMove;
+		}
+	};
+
+	// Player's field, or only what has changed in it since the revision the client has.
+	// The revision is the number of shots at the field, a new field (of /start) is revision 0.
+	struct FieldUpdate {
+		// Of the player's game, it tells the board the shots are on
+		GameKind kind;
+		u32 revision {0};
+		// The whole field, if the client has no revision or one the server doesn't know
+		std::optional<Player> field;
+		// Otherwise the shots at the field since the client's revision, in order,
+		// & the ships sunk by them, as indices into the field's ships
+		ShotList shots;
+		boost::container::static_vector<u8, GameEngines<GameKind>::MAX_SHIPS> sunk;
+	};
+
+	// Operation of a batch, see `GameStore::batch()`
+	struct BatchOp {
+		enum class Kind : u8 {
+			Shoot,
+			Status,
+			Field
+		};
+
+		Kind kind;
+		UUID uuid;
+		// Target of a shot
+		Position shot {};
+		// Revision of the field the client has, see `FieldUpdate`
+		std::optional<u32> since;
+	};
+
+	// How long the server waits for players before giving up on them
+	struct GameTimeouts {
+		// A player without requests for that long is forgotten & forfeits their game
+		std::chrono::seconds idle {300};
+		// The player who has the move loses if they don't shoot in time
+		std::chrono::seconds turn {60};
+	};
+
+	// Game state shared by all I/O threads.
+	// Players are spread over shards by UUID hash & every shard has its own lock,
+	// so requests of different players almost never contend with each other.
+	// A room lives in the shard of its owner (the first player), and operations
+	// touching both players of a room lock both shards in a deadlock-free way.
+	// Every shard has a timer wheel for idle players & move deadlines of its rooms,
+	// `expire()` turns all of them, so there is no OS timer per player.
+	// With a journal attached, every change is appended to it under the locks of the shards
+	// it touches, so the journal orders changes of a room the same way the store does.
+	// With an archive attached, every game is archived as soon as it has a winner.
+	// With spectators attached, every change of a watched room is published to them
+	// under the locks of the room.
+	class GameStore {
+	public:
+		// One-shot callback, may be called from any thread
+		using Watcher = std::function<void()>;
+
+		// Resolution of the timeouts
+		static constexpr std::chrono::milliseconds TICK {100};
+
+		explicit GameStore(size_t shard_count = default_shard_count(), GameTimeouts timeouts = {});
+
+		// Registers a new player, who isn't in any room yet
+		void add_player(const UUID& uuid, Player&& player);
+
+		// Forgets the player & their membership in a room
+		void remove_player(const UUID& uuid);
+
+		// Fires the timeouts due by `now`: idle players are forgotten, their enemies win,
+		// & players who haven't moved in time lose. A room is forgotten with the last of
+		// its players. Any request of a player postpones their expiry.
+		// Returns the number of fired timers.
+		size_t expire(std::chrono::steady_clock::time_point now);
+
+		[[nodiscard]] bool contains(const UUID& uuid) const;
+
+		// Player is known, but isn't in any room yet
+		[[nodiscard]] bool is_waiting(const UUID& uuid) const;
+
+		// Puts both players in a new room, the first one moves first.
+		// Returns false if any of them is unknown or already plays,
+		// or if they play different kinds of game.
+		bool create_room(const UUID& uuid1, const UUID& uuid2);
+
+		// Registers a bot with the given field & puts it in a new room with the player,
+		// who moves first. The bot makes its moves right in `shoot()` of the player.
+		// The field & the bot must be of the player's kind of game.
+		// Returns false if the player is unknown or already plays.
+		bool create_bot_room(const UUID& uuid, const UUID& bot_uuid, Player&& bot_field, PlayerBot&& bot);
+
+		// Shoots at the enemy of the player, returns true if a ship was hit.
+		// The player keeps the move after a hit, otherwise the move passes to the enemy.
+		Result<bool, GameError> shoot(const UUID& uuid, const Position& pos);
+
+		// Returns status of the player's game. If the player has to wait & `watcher`
+		// is given, it's called once the game changes (a room is formed or a shot is made).
+		// Only the latest watcher of a player is kept.
+		Result<Status, GameError> status(const UUID& uuid, Watcher&& watcher = {});
+
+		// Returns a copy of the player's field, or only the shots at it since the revision
+		// `since`, if given & known. Deltas come from the room's history, so they cost
+		// nothing to keep & are available for any revision of the game.
+		[[nodiscard]] Result<FieldUpdate, GameError> field(const UUID& uuid, std::optional<u32> since = {});
+
+		// Error or the result of `shoot()`, `status()` or `field()`
+		using BatchResult = std::variant<GameError, bool, Status, FieldUpdate>;
+
+		// Runs the operations, grouped by the shards they touch: every shard (or pair
+		// of shards, for players in a room) is locked once for all of its operations.
+		// Operations of one room (of either player) run in the order given, as do
+		// operations of one player; operations of different rooms may interleave
+		// with other requests. Results are in the order of the operations.
+		// A bot answers a shot before the next operation, as it does in `shoot()`.
+		[[nodiscard]] std::vector<BatchResult> batch(std::span<const BatchOp> ops);
+
+		// Sends the game so far to the spectator & subscribes it to the room with the public id,
+		// or ends its stream right away if the game is over.
+		// Returns false if there is no such room.
+		bool watch(u64 room_id, std::shared_ptr<Spectator> spectator);
+
+		// Public ids of at most `limit` rooms where the game goes on, shard by shard
+		[[nodiscard]] std::vector<u64> live_rooms(size_t limit) const;
+
+		// Totals over all shards, each shard is locked in turn, so they are approximate
+		[[nodiscard]] size_t player_count() const;
+		[[nodiscard]] size_t room_count() const;
+
+		[[nodiscard]] inline u64 expired_players() const {
+			return expired_players_.load(std::memory_order_relaxed);
+		}
+
+		// Games lost by timeout, either of a move or of the whole player
+		[[nodiscard]] inline u64 forfeits() const {
+			return forfeits_.load(std::memory_order_relaxed);
+		}
+
+		[[nodiscard]] inline size_t shard_count() const {
+			return shard_mask_ + 1;
+		}
+
+		// Enough shards to keep contention low on all hardware threads
+		static size_t default_shard_count();
+
+		// Logs all changes to the journal from now on, nullptr stops logging.
+		// Not thread safe, must be set while there are no requests.
+		inline void set_journal(Journal* journal) {
+			journal_ = journal;
+		}
+
+		// Archives finished games from now on, nullptr stops archiving.
+		// Not thread safe, must be set while there are no requests.
+		inline void set_archive(GameArchive* archive) {
+			archive_ = archive;
+		}
+
+		// Publishes changes of the watched rooms from now on, nullptr stops publishing.
+		// Not thread safe, must be set while there are no requests.
+		inline void set_spectators(SpectatorHub* spectators) {
+			spectators_ = spectators;
+		}
+
+		// Appends records of everything in the shard to `out`, under the shard's lock.
+		// Shards are snapshotted one at a time, so a snapshot doesn't stop the world,
+		// & journal records since the start of the snapshot bring it up to date.
+		void snapshot(size_t shard_index, std::vector<u8>& out) const;
+
+		// Applies a record of a snapshot or of the journal, before any requests.
+		// Records of the journal may be already reflected in the snapshot, replaying them
+		// again changes nothing. Returns false if the record is malformed.
+		bool replay(RecordType type, RecordReader& reader);
+
+		// Restarts timeouts & bots of the replayed games,
+		// returns the players who still wait for an enemy & the kinds of their games
+		std::vector<std::pair<UUID, GameKind>> finish_recovery();
+		// Bots which had the move when the server stopped play it, once the journal is set
+		void resume_bots();
+
+	private:
+		struct Expiry {
+			enum class Kind : u8 {
+				// of the player
+				Idle,
+				// of the room owned by the player
+				Turn
+			};
+
+			Kind kind {Kind::Idle};
+			UUID uuid {};
+		};
+
+		struct alignas(64) Shard {
+			mutable std::mutex mutex;
+			PlayerList players;
+			RoomMap room_map;
+			RoomList rooms;
+			// public id -> owner of the rooms in this shard
+			std::unordered_map<u64, UUID> room_ids;
+			std::unordered_map<UUID, Watcher, boost::hash<UUID>> watchers;
+			// bots playing at the moment, by their player UUID
+			std::unordered_map<UUID, PlayerBot, boost::hash<UUID>> bots;
+			TimerWheel<Expiry> timers;
+			// Bots have none, they are forgotten with their enemy
+			std::unordered_map<UUID, TimerHandle, boost::hash<UUID>> idle_timers;
+		};
+
+		// Player & their room (if any) as seen under the player's shard lock
+		struct Membership {
+			UUID room_owner;
+			UUID enemy;
+		};
+
+		std::unique_ptr<Shard[]> shards_; // NOLINT
+		size_t shard_mask_;
+		const std::chrono::steady_clock::time_point epoch_;
+		const u64 idle_ticks_;
+		const u64 turn_ticks_;
+		std::atomic<u64> expired_players_ {0};
+		std::atomic<u64> forfeits_ {0};
+		std::atomic<u64> next_room_id_ {1};
+		Journal* journal_ {nullptr};
+		GameArchive* archive_ {nullptr};
+		SpectatorHub* spectators_ {nullptr};
+
+		[[nodiscard]] size_t shard_index(const UUID& uuid) const;
+		[[nodiscard]] inline Shard& shard(const UUID& uuid) const {
+			return shards_[shard_index(uuid)];
+		}
+		[[nodiscard]] Result<Membership, GameError> membership(const UUID& uuid) const;
+
+		// The operations on a player in a room, under the locks of both shards
+		Result<bool, GameError> shoot_locked(
+			Shard& mine,
+			Shard& theirs,
+			const UUID& uuid,
+			const Membership& member,
+			const Position& pos,
+			Watcher& my_watcher,
+			Watcher& enemy_watcher,
+			// set if the enemy is a bot & has got the move, see `play_bot()`
+			bool& is_bot_move
+		);
+		Result<Status, GameError> status_locked(
+			Shard& mine,
+			Shard& room_shard,
+			const UUID& uuid,
+			const Membership& member,
+			Watcher&& watcher
+		);
+		Result<FieldUpdate, GameError> field_locked(
+			Shard& mine,
+			Shard& room_shard,
+			const UUID& uuid,
+			const Membership& member,
+			std::optional<u32> since
+		);
+		// The same, but for a player without a room, under the lock of their shard
+		Result<Status, GameError> status_waiting(Shard& mine, const UUID& uuid, Watcher&& watcher);
+		Result<FieldUpdate, GameError> field_waiting(Shard& mine, const UUID& uuid, std::optional<u32> since);
+
+		// Replays the bot's shots at its enemy, returns false if the bot doesn't play anymore
+		bool restore_bot(const Shard& shard, const UUID& bot_uuid, PlayerBot& bot) const;
+
+		void expire_player(const UUID& uuid);
+		void expire_turn(const UUID& owner);
+
+		// Must be called under the shard's lock
+		static Watcher take_watcher(Shard& shard, const UUID& uuid);
+		static Result<Membership, GameError> membership_locked(const Shard& shard, const UUID& uuid);
+		// Postpones expiry of the player
+		void touch(Shard& shard, const UUID& uuid) const;
+		// Player is known & hasn't been touched since their idle timer fired
+		static bool is_expired(const Shard& shard, const UUID& uuid);
+		// Erases everything of the player, but not their room
+		void forget(Shard& shard, const UUID& uuid) const;
+		void erase_room(Shard& shard, RoomList::iterator room) const;
+		static Status status_of(const Room& room, const UUID& uuid);
+		// The field or its delta since the revision, `room` is nullptr for a player without one
+		static FieldUpdate field_update(
+			const Player& player,
+			const Room* room,
+			const UUID& uuid,
+			std::optional<u32> since
+		);
+		// Shot at a cell which isn't shot yet, returns true on a hit. Logged to the journal.
+		// Grid operations are templates on the engine's grid, instantiated for every kind of game.
+		template<typename GameGrid>
+		bool apply_shot(
+			Room& room,
+			GameGrid& grid,
+			const UUID& shooter,
+			const UUID& target,
+			const Position& pos
+		) const;
+		// Changes of the room & the grid by the shot, shared with the replay of the journal
+		template<typename GameGrid>
+		static bool place_shot(
+			Room& room,
+			GameGrid& grid,
+			const UUID& shooter,
+			const UUID& target,
+			const Position& pos
+		);
+		// Ends the game by a timeout
+		void forfeit(Room& room, const UUID& winner);
+		// Bot of the room shoots while it has the move. Its shots are chosen on copies
+		// of its engine & the enemy's grid without the locks, & are placed only if the room
+		// hasn't changed since. Must be called without the locks.
+		void play_bot(const UUID& owner);
+		// Appends a record to the journal, if there is one
+		template<typename F>
+		void record(RecordType type, F&& write) const {
+			if (journal_ != nullptr) {
+				journal_->append(type, std::forward<F>(write));
+			}
+		}
+		void record_player(const UUID& uuid, const Player& player, u8 bot_level) const;
+		// Hands the game which has just got its winner to the archive, if there is one.
+		// Must be called under the locks of both players' shards.
+		void archive(const Room& room, bool is_forfeit) const;
+		// What spectators see of the room: shots since the `from`-th one with their results.
+		// Must be called under the locks of both players' shards.
+		[[nodiscard]] RoomView view(const Room& room, size_t from) const;
+		// Publishes the shots since the `from`-th one & the end of the game, if the room
+		// is watched. Must be called under the locks of both players' shards.
+		void broadcast(const Room& room, size_t from) const;
+
+		static inline void notify(Watcher& watcher) {
+			if (watcher) { watcher(); }
+		}
+
+		// Runs `f` holding locks of both shards (which may be the same one)
+		template<typename F>
+		static auto with_both(Shard& a, Shard& b, F&& f) {
+			if (&a == &b) {
+				std::scoped_lock lock{a.mutex};
+				return f();
+			}
+			std::scoped_lock lock{a.mutex, b.mutex};
+			return f();
+		}
+	};
+} // namespace battleship
+
+#endif // BATTLESHIP_SERVER_GAME_STORE_HPP
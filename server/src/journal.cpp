@@ -0,0 +1,128 @@
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include "journal.hpp"
+
+namespace battleship {
+	[[noreturn]] static void throw_errno(const std::string& what) {
+		throw std::runtime_error(what + ": " + std::strerror(errno));
+	}
+
+	AppendFile::AppendFile(const std::filesystem::path& path, bool truncate):
+		fd_{::open(path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC | (truncate ? O_TRUNC : O_APPEND), 0644)}
+	{
+		if (fd_ < 0) {
+			throw_errno("can't open " + path.string());
+		}
+	}
+
+	AppendFile::~AppendFile() {
+		::close(fd_);
+	}
+
+	void AppendFile::write(std::span<const u8> bytes) {
+		while (!bytes.empty()) {
+			ssize_t written = ::write(fd_, bytes.data(), bytes.size());
+			if (written < 0) {
+				if (errno == EINTR) { continue; }
+				throw_errno("write failed");
+			}
+			bytes = bytes.subspan(static_cast<size_t>(written));
+		}
+	}
+
+	void AppendFile::sync() {
+		if (::fdatasync(fd_) != 0) {
+			throw_errno("fdatasync failed");
+		}
+	}
+
+	Journal::Journal(std::filesystem::path dir, u64 segment, std::chrono::milliseconds flush_interval):
+		dir_{std::move(dir)},
+		flush_interval_{flush_interval},
+		segment_{segment}
+	{
+		std::filesystem::create_directories(dir_);
+		file_.emplace(segment_path(dir_, segment_));
+		writer_ = std::thread{[this] { run(); }};
+	}
+
+	Journal::~Journal() {
+		{
+			std::scoped_lock lock{mutex_};
+			stopping_ = true;
+		}
+		wake_.notify_one();
+		writer_.join();
+	}
+
+	std::filesystem::path Journal::segment_path(const std::filesystem::path& dir, u64 segment) {
+		return dir / ("wal-" + std::to_string(segment) + ".log");
+	}
+
+	u64 Journal::records() const {
+		std::scoped_lock lock{mutex_};
+		return records_;
+	}
+
+	void Journal::write_pending(std::vector<u8>& spare) {
+		{
+			std::scoped_lock lock{mutex_};
+			pending_.swap(spare);
+		}
+		if (spare.empty()) { return; }
+		file_->write(spare);
+		file_->sync();
+		bytes_written_.fetch_add(spare.size(), std::memory_order_relaxed);
+		syncs_.fetch_add(1, std::memory_order_relaxed);
+		spare.clear();
+	}
+
+	void Journal::flush() {
+		std::scoped_lock lock{file_mutex_};
+		std::vector<u8> spare;
+		write_pending(spare);
+	}
+
+	u64 Journal::rotate() {
+		// The writer waits for the next segment to be open, so the records appended
+		// after the swap go only there. Appends wait just for the swap, not for the disk.
+		std::scoped_lock file_lock{file_mutex_};
+		std::vector<u8> old;
+		{
+			std::scoped_lock lock{mutex_};
+			pending_.swap(old);
+			++segment_;
+		}
+		if (!old.empty()) {
+			file_->write(old);
+			file_->sync();
+			bytes_written_.fetch_add(old.size(), std::memory_order_relaxed);
+			syncs_.fetch_add(1, std::memory_order_relaxed);
+		}
+		file_.reset();
+		file_.emplace(segment_path(dir_, segment_));
+		return segment_;
+	}
+
+	void Journal::run() {
+		// Swapped with `pending_`, so both buffers keep their capacity
+		std::vector<u8> spare;
+		for (;;) {
+			bool stopping = false;
+			{
+				std::unique_lock lock{mutex_};
+				wake_.wait_for(lock, flush_interval_, [this] { return stopping_; });
+				stopping = stopping_;
+			}
+			{
+				std::scoped_lock lock{file_mutex_};
+				write_pending(spare);
+			}
+			if (stopping) { return; }
+		}
+	}
+} // namespace battleship
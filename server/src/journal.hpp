@@ -0,0 +1,380 @@
+#ifndef BATTLESHIP_SERVER_JOURNAL_HPP
+#define BATTLESHIP_SERVER_JOURNAL_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <thread>
+#include <variant>
+#include <vector>
+#include "game.hpp"
+#include "battleship/common/util/crc32c.hpp"
+
+namespace battleship {
+	// Change of the game state in the journal, or a piece of the state in a snapshot
+	enum class RecordType : u8 {
+		// uuid, player, bot level (or NO_BOT, FINISHED_BOT)
+		PlayerAdded = 1,
+		// owner, second player, room id, kind of the game
+		RoomCreated = 2,
+		// owner, shooter, target, position, room version after the shot
+		ShotPlaced = 3,
+		// owner, winner, room version after the forfeit
+		RoomForfeited = 4,
+		// uuid
+		PlayerRemoved = 5,
+		// owner
+		RoomRemoved = 6,
+		// Only in snapshots: owner & the whole room
+		RoomState = 7
+	};
+
+	// Bot level of a human player in PlayerAdded
+	inline constexpr u8 NO_BOT = 0xFF;
+	// Bot level of a bot whose game is over, it doesn't shoot anymore
+	inline constexpr u8 FINISHED_BOT = 0xFE;
+
+	// Appends a framed record to a buffer: [size: u32][crc: u32][type: u8][payload],
+	// where size & crc cover the type & the payload. Integers are little-endian.
+	class RecordWriter {
+	public:
+		RecordWriter(std::vector<u8>& out, RecordType type): out_{out}, start_{out.size()} {
+			out_.resize(start_ + HEADER_SIZE);
+			byte(static_cast<u8>(type));
+		}
+
+		RecordWriter(const RecordWriter&) = delete;
+		RecordWriter& operator=(const RecordWriter&) = delete;
+
+		// Fills in the header
+		~RecordWriter() {
+			std::span<const u8> body {out_.data() + start_ + HEADER_SIZE, out_.size() - start_ - HEADER_SIZE};
+			store(start_, static_cast<u32>(body.size()));
+			store(start_ + sizeof(u32), Crc32c::of(body));
+		}
+
+		void byte(u8 value) {
+			out_.push_back(value);
+		}
+
+		void number(u32 value) {
+			for (size_t i = 0; i < sizeof(value); ++i) {
+				out_.push_back(static_cast<u8>(value >> (8 * i)));
+			}
+		}
+
+		void long_number(u64 value) {
+			number(static_cast<u32>(value));
+			number(static_cast<u32>(value >> 32));
+		}
+
+		void uuid(const UUID& uuid) {
+			out_.insert(out_.end(), uuid.begin(), uuid.end());
+		}
+
+		void position(const Position& pos) {
+			byte(pos.row);
+			byte(pos.col);
+		}
+
+		template<size_t N>
+		void bits(const Bitboard<N>& bits) {
+			auto bytes = bits.to_bytes();
+			out_.insert(out_.end(), bytes.begin(), bytes.end());
+		}
+
+		// Kind of the game, then ships with their cells,
+		// so that reading doesn't validate the placement again
+		void player(const Player& player) {
+			byte(static_cast<u8>(player.index()));
+			std::visit([this](const auto& field) {
+				bits(field.grid.ship_cells());
+				bits(field.grid.shot_cells());
+				byte(static_cast<u8>(field.ships.ships.size()));
+				for (const Ship& ship: field.ships.ships) {
+					position(ship.zone.first);
+					position(ship.zone.last);
+				}
+			}, player);
+		}
+
+		void room(const Room& room) {
+			uuid(room.uuid_player2);
+			long_number(room.id);
+			byte(static_cast<u8>(room.kind.index()));
+			uuid(room.move);
+			uuid(room.turn_owner);
+			byte(room.winner.has_value() ? 1 : 0);
+			uuid(room.winner.value_or(UUID{}));
+			number(room.version);
+			byte(static_cast<u8>(room.turn_shots.size()));
+			for (const Position& pos: room.turn_shots) {
+				position(pos);
+			}
+			byte(static_cast<u8>(room.history.size()));
+			// A cell index is below 128, the high bit tells the field
+			for (const RoomShot& shot: room.history) {
+				byte(static_cast<u8>(shot.cell | (shot.at_second ? 0x80U : 0U)));
+			}
+		}
+
+		static constexpr size_t HEADER_SIZE = 2 * sizeof(u32);
+
+	private:
+		std::vector<u8>& out_;
+		size_t start_;
+
+		void store(size_t at, u32 value) {
+			for (size_t i = 0; i < sizeof(value); ++i) {
+				out_[at + i] = static_cast<u8>(value >> (8 * i));
+			}
+		}
+	};
+
+	// Reads fields of a record written by `RecordWriter`.
+	// Reading past the end yields zeros & makes the reader `failed()`.
+	class RecordReader {
+	public:
+		explicit RecordReader(std::span<const u8> payload): in_{payload} {}
+
+		[[nodiscard]] bool failed() const {
+			return failed_;
+		}
+
+		u8 byte() {
+			auto bytes = take(1);
+			return bytes.empty() ? 0 : bytes[0];
+		}
+
+		u32 number() {
+			auto bytes = take(sizeof(u32));
+			u32 value = 0;
+			for (size_t i = 0; i < bytes.size(); ++i) {
+				value |= static_cast<u32>(bytes[i]) << (8 * i);
+			}
+			return value;
+		}
+
+		u64 long_number() {
+			u64 low = number();
+			return low | (static_cast<u64>(number()) << 32);
+		}
+
+		UUID uuid() {
+			UUID uuid {};
+			auto bytes = take(UUID::static_size());
+			std::copy(bytes.begin(), bytes.end(), uuid.begin());
+			return uuid;
+		}
+
+		Position position() {
+			u8 row = byte();
+			return {row, byte()};
+		}
+
+		template<size_t N>
+		Bitboard<N> bits() {
+			return Bitboard<N>::from_bytes(take(Bitboard<N>::BYTES));
+		}
+
+		Player player() {
+			auto kind = game_kind(byte());
+			if (!kind.has_value()) {
+				failed_ = true;
+				return {};
+			}
+			return std::visit([this]<typename Game>(Game /*kind*/) -> Player {
+				using Field = typename Game::Field;
+				Field field;
+				field.grid.place_ships(bits<Game::GameGrid::SIZE>());
+				field.grid.place_shots(bits<Game::GameGrid::SIZE>());
+				u8 count = byte();
+				if (count > Field::PlayerShips::SHIP_COUNT) {
+					failed_ = true;
+					return field;
+				}
+				for (u8 i = 0; i < count; ++i) {
+					// Elements of a braced list are evaluated in order
+					Ship ship {Rectangle{position(), position()}};
+					if (ship.length() == 0 || ship.length() > field.ships.count.size()) {
+						failed_ = true;
+						return field;
+					}
+					field.ships.push(std::move(ship));
+				}
+				return field;
+			}, *kind);
+		}
+
+		// Kind of the game, a room of an unknown one fails the reader
+		GameKind kind() {
+			auto kind = game_kind(byte());
+			failed_ = failed_ || !kind.has_value();
+			return kind.value_or(GameKind{});
+		}
+
+		Room room(const UUID& owner) {
+			Room room {owner, uuid()};
+			room.id = long_number();
+			room.kind = kind();
+			room.move = uuid();
+			room.turn_owner = uuid();
+			bool has_winner = byte() != 0;
+			UUID winner = uuid();
+			if (has_winner) {
+				room.winner = winner;
+			}
+			room.version = number();
+			u8 shots = byte();
+			if (shots > room.turn_shots.capacity()) {
+				failed_ = true;
+				return room;
+			}
+			for (u8 i = 0; i < shots; ++i) {
+				room.turn_shots.push_back(position());
+			}
+			u8 history = byte();
+			if (history > room.history.capacity()) {
+				failed_ = true;
+				return room;
+			}
+			for (u8 i = 0; i < history; ++i) {
+				u8 shot = byte();
+				room.history.push_back({static_cast<u8>(shot & 0x7FU), (shot & 0x80U) != 0});
+			}
+			return room;
+		}
+
+	private:
+		std::span<const u8> in_;
+		bool failed_ {false};
+
+		std::span<const u8> take(size_t size) {
+			if (in_.size() < size) {
+				failed_ = true;
+				in_ = {};
+				return {};
+			}
+			auto bytes = in_.first(size);
+			in_ = in_.subspan(size);
+			return bytes;
+		}
+	};
+
+	// Calls `f(type, reader)` with every record of `bytes` in order.
+	// Stops at the end or at the first torn or corrupted record (the tail of a crash),
+	// returns the size of the valid prefix.
+	template<typename F>
+	size_t read_records(std::span<const u8> bytes, F&& f) {
+		size_t pos = 0;
+		while (bytes.size() - pos >= RecordWriter::HEADER_SIZE) {
+			RecordReader header {bytes.subspan(pos, RecordWriter::HEADER_SIZE)};
+			u32 size = header.number();
+			u32 crc = header.number();
+			if (size == 0 || size > bytes.size() - pos - RecordWriter::HEADER_SIZE) {
+				break;
+			}
+			auto body = bytes.subspan(pos + RecordWriter::HEADER_SIZE, size);
+			if (Crc32c::of(body) != crc) {
+				break;
+			}
+			RecordReader reader {body.subspan(1)};
+			f(static_cast<RecordType>(body[0]), reader);
+			pos += RecordWriter::HEADER_SIZE + size;
+		}
+		return pos;
+	}
+
+	// File written strictly sequentially, closed on destruction. Errors are thrown.
+	class AppendFile {
+	public:
+		// Opens the file for appending, creates it if needed or truncates it if asked to
+		explicit AppendFile(const std::filesystem::path& path, bool truncate = false);
+		AppendFile(const AppendFile&) = delete;
+		AppendFile& operator=(const AppendFile&) = delete;
+		~AppendFile();
+
+		void write(std::span<const u8> bytes);
+		// Waits until the written data is on the disk
+		void sync();
+
+	private:
+		int fd_;
+	};
+
+	// Append-only log of game state changes, split into numbered segments.
+	// Records are appended into a memory buffer under a short lock, & a background thread
+	// writes whatever has accumulated with a single write & fdatasync every `flush_interval`
+	// (group commit), so appending never waits for the disk. The price is that a crash loses
+	// up to `flush_interval` of acknowledged changes; destruction flushes everything.
+	// I/O errors are thrown from the writer thread & terminate the server,
+	// as it can't keep its promise of durability anymore.
+	class Journal {
+	public:
+		// Appends to the segment `segment` in `dir`, which is created if needed
+		Journal(std::filesystem::path dir, u64 segment, std::chrono::milliseconds flush_interval);
+		Journal(const Journal&) = delete;
+		Journal& operator=(const Journal&) = delete;
+		~Journal();
+
+		// Appends a record, `write(RecordWriter&)` writes its payload. Thread safe.
+		// Records of one room must be appended under the room's locks, so that they keep their order.
+		template<typename F>
+		void append(RecordType type, F&& write) {
+			std::scoped_lock lock{mutex_};
+			{
+				RecordWriter writer {pending_, type};
+				write(writer);
+			}
+			++records_;
+		}
+
+		// Flushes the current segment & starts the next one, returns its number.
+		// Everything appended before is in the previous segments.
+		u64 rotate();
+
+		// Writes & syncs everything appended so far
+		void flush();
+
+		[[nodiscard]] static std::filesystem::path segment_path(const std::filesystem::path& dir, u64 segment);
+
+		// Totals for metrics
+		[[nodiscard]] u64 records() const;
+		[[nodiscard]] inline u64 bytes_written() const {
+			return bytes_written_.load(std::memory_order_relaxed);
+		}
+		[[nodiscard]] inline u64 syncs() const {
+			return syncs_.load(std::memory_order_relaxed);
+		}
+
+	private:
+		const std::filesystem::path dir_;
+		const std::chrono::milliseconds flush_interval_;
+
+		// Held while writing to the file or switching to the next one, taken before `mutex_`
+		std::mutex file_mutex_;
+		std::optional<AppendFile> file_;
+		u64 segment_;
+
+		mutable std::mutex mutex_;
+		std::condition_variable wake_;
+		std::vector<u8> pending_;
+		u64 records_ {0};
+		bool stopping_ {false};
+
+		std::atomic<u64> bytes_written_ {0};
+		std::atomic<u64> syncs_ {0};
+
+		std::thread writer_;
+
+		// Moves the pending records to the file, must be called under `file_mutex_`
+		void write_pending(std::vector<u8>& spare);
+		void run();
+	};
+} // namespace battleship
+
+#endif // BATTLESHIP_SERVER_JOURNAL_HPP
@@ -0,0 +1,127 @@
+#include "matchmaker.hpp"
+
+namespace battleship {
+	Matchmaker::Matchmaker(GameStore& store, size_t capacity): store_{store} {
+		queues_.reserve(std::variant_size_v<GameKind>);
+		for (size_t i = 0; i < std::variant_size_v<GameKind>; ++i) {
+			queues_.push_back(std::make_unique<KindQueue>(capacity));
+		}
+	}
+
+	bool Matchmaker::enqueue(const UUID& uuid, const GameKind& kind) {
+		KindQueue& q = *queues_[kind.index()];
+		if (!q.queue.try_push(uuid)) {
+			return false;
+		}
+		q.size.fetch_add(1);
+		drain(q);
+		return true;
+	}
+
+	bool Matchmaker::pair_with_bot(
+		const UUID& uuid,
+		const UUID& bot_uuid,
+		Player&& bot_field,
+		PlayerBot&& bot
+	) {
+		if (!store_.create_bot_room(uuid, bot_uuid, std::move(bot_field), std::move(bot))) {
+			return false;
+		}
+		pairings_.fetch_add(1, std::memory_order_relaxed);
+		bot_pairings_.fetch_add(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	void Matchmaker::set_bot_fallback(std::chrono::steady_clock::duration delay, BotFactory factory) {
+		bot_delay_ = delay;
+		bot_factory_ = std::move(factory);
+	}
+
+	size_t Matchmaker::pair_stale_with_bots(std::chrono::steady_clock::time_point now) {
+		if (!bot_factory_) { return 0; }
+		size_t paired = 0;
+		for (size_t i = 0; i < queues_.size(); ++i) {
+			KindQueue& q = *queues_[i];
+			// Whoever drains now has just paired the players, there is nobody stale to look for
+			if (q.draining.exchange(true)) { continue; }
+			if (!q.pending.has_value()) {
+				// A lone player stays in the queue, the wait is counted from now on
+				q.pending = q.queue.try_pop();
+				q.pending_since = now;
+			}
+			if (pair_pending_with_bot(q, *game_kind(i), now)) {
+				++paired;
+			}
+			q.draining.store(false);
+			// Others could have arrived while the flag was taken
+			drain(q);
+		}
+		return paired;
+	}
+
+	bool Matchmaker::pair_pending_with_bot(
+		KindQueue& q,
+		const GameKind& kind,
+		std::chrono::steady_clock::time_point now
+	) {
+		if (!q.pending.has_value() || now - q.pending_since < bot_delay_) {
+			return false;
+		}
+		BotOpponent opponent = bot_factory_(kind);
+		bool is_paired = pair_with_bot(*q.pending, opponent.uuid, std::move(opponent.field), std::move(opponent.bot));
+		if (is_paired || !store_.is_waiting(*q.pending)) {
+			q.pending.reset();
+			q.size.fetch_sub(1);
+		}
+		return is_paired;
+	}
+
+	size_t Matchmaker::waiting() const {
+		size_t sum = 0;
+		for (const auto& q: queues_) {
+			sum += q->size.load(std::memory_order_relaxed);
+		}
+		return sum;
+	}
+
+	void Matchmaker::drain(KindQueue& q) {
+		// If another thread is draining, it will see our UUID:
+		// it re-checks the size after dropping the flag.
+		// All operations on `size` & `draining` are sequentially consistent for that.
+		while (q.size.load() >= 2 && !q.draining.exchange(true)) {
+			while (auto uuid = q.queue.try_pop()) {
+				if (!q.pending.has_value()) {
+					q.pending = uuid;
+					q.pending_since = std::chrono::steady_clock::now();
+					continue;
+				}
+				if (store_.create_room(*q.pending, *uuid)) {
+					q.pending.reset();
+					q.size.fetch_sub(2);
+					pairings_.fetch_add(1, std::memory_order_relaxed);
+					continue;
+				}
+				// Someone of them has left, is already playing or queued twice,
+				// keep waiting with whoever is still free
+				size_t dropped = 0;
+				if (!store_.is_waiting(*q.pending)) {
+					q.pending.reset();
+					++dropped;
+				}
+				if (*uuid == q.pending || !store_.is_waiting(*uuid)) {
+					++dropped;
+				} else if (!q.pending.has_value()) {
+					q.pending = uuid;
+					q.pending_since = std::chrono::steady_clock::now();
+				} else if (!q.queue.try_push(*uuid)) {
+					// Both are free (the pair has just been broken by a race),
+					// but the queue is full, so the newcomer can't wait anymore
+					++dropped;
+				}
+				q.size.fetch_sub(dropped);
+				if (dropped == 0) { break; }
+			}
+			q.draining.store(false);
+		}
+	}
+} // namespace battleship
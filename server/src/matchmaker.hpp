@@ -0,0 +1,95 @@
+#ifndef BATTLESHIP_SERVER_MATCHMAKER_HPP
+#define BATTLESHIP_SERVER_MATCHMAKER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <vector>
+#include "game.hpp"
+#include "game_store.hpp"
+
+namespace battleship {
+	// Pairs waiting players into rooms.
+	// Players are queued in lock-free MPMC queues, one per kind of game,
+	// so arrivals on different I/O threads never block each other,
+	// & players of different kinds never meet.
+	// Pairing is done by whichever thread wins the queue's drain flag,
+	// the others just leave their UUIDs in the queue & go on.
+	// A player left without a human enemy for too long gets a bot, see `pair_stale_with_bots()`.
+	class Matchmaker {
+	public:
+		static constexpr size_t DEFAULT_CAPACITY = 1 << 16;
+
+		// Bot to pair with a player who is tired of waiting
+		struct BotOpponent {
+			UUID uuid;
+			Player field;
+			PlayerBot bot;
+		};
+		using BotFactory = std::function<BotOpponent(const GameKind&)>;
+
+		explicit Matchmaker(GameStore& store, size_t capacity = DEFAULT_CAPACITY);
+
+		// Queues the player of the kind of game & pairs everybody who waits for the same kind.
+		// Returns false if the queue is full.
+		bool enqueue(const UUID& uuid, const GameKind& kind);
+
+		// Pairs the player with a bot right away instead of a human.
+		// Returns false if the player is unknown or already plays.
+		bool pair_with_bot(const UUID& uuid, const UUID& bot_uuid, Player&& bot_field, PlayerBot&& bot);
+
+		// Players who wait for a human longer than `delay` are paired with bots made by `factory`.
+		// Must be set before other threads use the matchmaker.
+		void set_bot_fallback(std::chrono::steady_clock::duration delay, BotFactory factory);
+
+		// Pairs the players who have waited for the fallback delay with bots,
+		// returns the number of such pairings. Called periodically, does nothing without a fallback.
+		size_t pair_stale_with_bots(std::chrono::steady_clock::time_point now);
+
+		// Players waiting for an enemy (approximately, while others arrive)
+		[[nodiscard]] size_t waiting() const;
+
+		[[nodiscard]] inline u64 pairings() const {
+			return pairings_.load(std::memory_order_relaxed);
+		}
+
+		// Pairings with bots, they are counted in `pairings()` too
+		[[nodiscard]] inline u64 bot_pairings() const {
+			return bot_pairings_.load(std::memory_order_relaxed);
+		}
+
+	private:
+		struct alignas(64) KindQueue {
+			PlayerQueue queue;
+			std::atomic<bool> draining {false};
+			// queued players + pending one
+			std::atomic<size_t> size {0};
+			// Player without a pair yet & since when they are the one, only touched by the draining thread
+			std::optional<UUID> pending;
+			std::chrono::steady_clock::time_point pending_since;
+
+			explicit KindQueue(size_t capacity): queue{capacity} {}
+		};
+
+		GameStore& store_;
+		// By the index of the kind
+		std::vector<std::unique_ptr<KindQueue>> queues_;
+		std::atomic<u64> pairings_ {0};
+		std::atomic<u64> bot_pairings_ {0};
+		std::chrono::steady_clock::duration bot_delay_ {};
+		BotFactory bot_factory_;
+
+		void drain(KindQueue& kind_queue);
+		// Pairs the pending player of the queue with a bot, if they have waited long enough.
+		// Must be called by the draining thread.
+		bool pair_pending_with_bot(
+			KindQueue& kind_queue,
+			const GameKind& kind,
+			std::chrono::steady_clock::time_point now
+		);
+	};
+} // namespace battleship
+
+#endif // BATTLESHIP_SERVER_MATCHMAKER_HPP
@@ -0,0 +1,153 @@
+#include <charconv>
+#include "metrics.hpp"
+
+namespace battleship {
+	namespace {
+		using Buckets = LocalHistogram::Buckets;
+
+		// Upper bounds of Prometheus buckets are 2^k microseconds, 16 us .. ~16.8 s.
+		// They are bucket boundaries of `Histogram<>` as well, so the counts are exact.
+		constexpr size_t FIRST_BOUND_LOG = 4;
+		constexpr size_t LAST_BOUND_LOG = 24;
+
+		struct HistogramSum {
+			std::array<u64, Buckets::BUCKETS> counts {};
+			u64 sum {0};
+
+			void add(const LocalHistogram& histogram) {
+				for (size_t i = 0; i < counts.size(); ++i) {
+					counts[i] += histogram.count(i);
+				}
+				sum += histogram.sum();
+			}
+		};
+
+		template<typename T>
+		void append_number(std::string& out, T value) {
+			std::array<char, 32> buf {};
+			auto [end, ec] = std::to_chars(buf.data(), buf.data() + buf.size(), value);
+			out.append(buf.data(), end);
+		}
+
+		void append_header(std::string& out, std::string_view name, std::string_view type, std::string_view help) {
+			out.append("# HELP ").append(name).append(" ").append(help).append("\n");
+			out.append("# TYPE ").append(name).append(" ").append(type).append("\n");
+		}
+
+		void append_sample(std::string& out, std::string_view name, std::string_view labels, double value) {
+			out.append(name);
+			if (!labels.empty()) {
+				out.append("{").append(labels).append("}");
+			}
+			out.append(" ");
+			append_number(out, value);
+			out.append("\n");
+		}
+
+		// Series of one histogram, `labels` are put before "le"
+		void append_histogram(std::string& out, std::string_view name, const std::string& labels, const HistogramSum& histogram) {
+			std::string bucket_name = std::string{name} + "_bucket";
+			std::string bucket_labels = labels.empty() ? labels : labels + ",";
+			u64 cumulative = 0;
+			size_t i = 0;
+			for (size_t bound_log = FIRST_BOUND_LOG; bound_log <= LAST_BOUND_LOG; ++bound_log) {
+				// Counts of values below 2^bound_log microseconds
+				for (size_t end = Buckets::bucket(u64{1} << bound_log); i < end; ++i) {
+					cumulative += histogram.counts[i];
+				}
+				std::string le = bucket_labels + "le=\"";
+				append_number(le, static_cast<double>(u64{1} << bound_log) / 1e6);
+				append_sample(out, bucket_name, le + "\"", static_cast<double>(cumulative));
+			}
+			for (; i < histogram.counts.size(); ++i) {
+				cumulative += histogram.counts[i];
+			}
+			append_sample(out, bucket_name, bucket_labels + "le=\"+Inf\"", static_cast<double>(cumulative));
+			append_sample(out, std::string{name} + "_sum", labels, static_cast<double>(histogram.sum) / 1e6);
+			append_sample(out, std::string{name} + "_count", labels, static_cast<double>(cumulative));
+		}
+	} // namespace
+
+	ThreadMetrics& Metrics::local() {
+		// A server has a single instance, so the cache almost never misses.
+		// It's keyed on the id, as a new instance may take the address of a destroyed one.
+		struct Cache {
+			u64 owner {0};
+			ThreadMetrics* metrics {nullptr};
+		};
+		thread_local Cache cache;
+		if (cache.owner != id_) {
+			std::scoped_lock lock{mutex_};
+			cache.metrics = threads_.emplace_back(std::make_unique<ThreadMetrics>()).get();
+			cache.owner = id_;
+		}
+		return *cache.metrics;
+	}
+
+	u64 Metrics::next_id() {
+		static std::atomic<u64> next {1};
+		return next.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	std::string Metrics::prometheus(std::span<const SampledMetric> sampled) const {
+		std::array<HistogramSum, ROUTE_LABELS.size()> routes;
+		HistogramSum handshake;
+		u64 handshake_failures = 0;
+		u64 handshakes_resumed = 0;
+		u64 io_errors = 0;
+		u64 sessions_opened = 0;
+		u64 sessions_closed = 0;
+		u64 bytes_in = 0;
+		u64 bytes_out = 0;
+		{
+			std::scoped_lock lock{mutex_};
+			for (const auto& thread: threads_) {
+				for (size_t i = 0; i < routes.size(); ++i) {
+					routes[i].add(thread->routes[i]);
+				}
+				handshake.add(thread->handshake);
+				handshake_failures += thread->handshake_failures.get();
+				handshakes_resumed += thread->handshakes_resumed.get();
+				io_errors += thread->io_errors.get();
+				sessions_opened += thread->sessions_opened.get();
+				sessions_closed += thread->sessions_closed.get();
+				bytes_in += thread->bytes_in.get();
+				bytes_out += thread->bytes_out.get();
+			}
+		}
+
+		std::string out;
+		out.reserve(16 * 1024);
+
+		constexpr std::string_view REQUEST_DURATION = "battleship_request_duration_seconds";
+		append_header(out, REQUEST_DURATION, "histogram", "Time from reading a request till sending its response.");
+		for (size_t i = 0; i < routes.size(); ++i) {
+			append_histogram(out, REQUEST_DURATION, "route=\"" + std::string{ROUTE_LABELS[i]} + "\"", routes[i]);
+		}
+
+		constexpr std::string_view HANDSHAKE_DURATION = "battleship_tls_handshake_duration_seconds";
+		append_header(out, HANDSHAKE_DURATION, "histogram", "Time of successful TLS handshakes.");
+		append_histogram(out, HANDSHAKE_DURATION, "", handshake);
+
+		const auto counter = [&out](std::string_view name, std::string_view type, std::string_view help, u64 value) {
+			append_header(out, name, type, help);
+			append_sample(out, name, "", static_cast<double>(value));
+		};
+		counter("battleship_tls_handshake_failures_total", "counter", "Failed TLS handshakes.", handshake_failures);
+		counter("battleship_tls_handshakes_resumed_total", "counter",
+			"TLS handshakes which resumed a session.", handshakes_resumed);
+		counter("battleship_io_errors_total", "counter", "Failed reads, writes & shutdowns.", io_errors);
+		counter("battleship_sessions_opened_total", "counter", "Accepted connections.", sessions_opened);
+		// Threads are read one by one, so a close may be seen without its open
+		counter("battleship_sessions_active", "gauge", "Open connections.",
+			(sessions_opened > sessions_closed) ? sessions_opened - sessions_closed : 0);
+		counter("battleship_received_bytes_total", "counter", "Bytes of HTTP requests read.", bytes_in);
+		counter("battleship_sent_bytes_total", "counter", "Bytes of HTTP responses written.", bytes_out);
+
+		for (const SampledMetric& metric: sampled) {
+			append_header(out, metric.name, metric.type, metric.help);
+			append_sample(out, metric.name, "", metric.value);
+		}
+		return out;
+	}
+} // namespace battleship
@@ -0,0 +1,120 @@
+#ifndef BATTLESHIP_SERVER_METRICS_HPP
+#define BATTLESHIP_SERVER_METRICS_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "battleship/common/util/histogram.hpp"
+#include "battleship/common/util/num_types.hpp"
+
+namespace battleship {
+	enum class Route : u8 {
+		Start,
+		Shoot,
+		Status,
+		// Long-polled /status, its latency includes the time it was parked
+		StatusWait,
+		Field,
+		Batch,
+		// Latency of /watch is the time to the start of the stream
+		Watch,
+		Rooms,
+		Metrics,
+		Other
+	};
+
+	inline constexpr std::array<std::string_view, 10> ROUTE_LABELS {
+		"/start", "/shoot", "/status", "/status?wait", "/field", "/batch", "/watch", "/rooms", "/metrics", "other"
+	};
+
+	// Counter written by one thread & read by any.
+	// A relaxed load & store instead of fetch_add, so there is no locked instruction.
+	class LocalCounter {
+	public:
+		inline void add(u64 n = 1) {
+			value_.store(value_.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+		}
+
+		[[nodiscard]] inline u64 get() const {
+			return value_.load(std::memory_order_relaxed);
+		}
+
+	private:
+		std::atomic<u64> value_ {0};
+	};
+
+	// Latency histogram in microseconds with the buckets of `Histogram<>`, written by one thread
+	class LocalHistogram {
+	public:
+		using Buckets = Histogram<>;
+
+		inline void record(std::chrono::steady_clock::duration latency) {
+			auto us = std::chrono::duration_cast<std::chrono::microseconds>(latency).count();
+			auto value = static_cast<u64>(std::max<decltype(us)>(us, 0));
+			counts_[Buckets::bucket(value)].add();
+			sum_.add(value);
+		}
+
+		[[nodiscard]] inline u64 count(size_t bucket) const {
+			return counts_[bucket].get();
+		}
+
+		[[nodiscard]] inline u64 sum() const {
+			return sum_.get();
+		}
+
+	private:
+		std::array<LocalCounter, Buckets::BUCKETS> counts_;
+		LocalCounter sum_;
+	};
+
+	// Everything recorded by one thread
+	struct ThreadMetrics {
+		std::array<LocalHistogram, ROUTE_LABELS.size()> routes;
+		LocalHistogram handshake;
+		LocalCounter handshake_failures;
+		LocalCounter handshakes_resumed;
+		LocalCounter io_errors;
+		LocalCounter sessions_opened;
+		LocalCounter sessions_closed;
+		LocalCounter bytes_in;
+		LocalCounter bytes_out;
+	};
+
+	// Value sampled from elsewhere at scrape time, e.g. the number of rooms
+	struct SampledMetric {
+		std::string_view name;
+		std::string_view type;
+		std::string_view help;
+		double value;
+	};
+
+	// Server telemetry. Every thread records into its own `ThreadMetrics`,
+	// so recording is a couple of plain stores into memory no one else writes.
+	// Threads are summed up only when metrics are scraped.
+	class Metrics {
+	public:
+		// Metrics of the calling thread, registered on the first call
+		ThreadMetrics& local();
+
+		// All metrics in Prometheus text exposition format (version 0.0.4)
+		[[nodiscard]] std::string prometheus(std::span<const SampledMetric> sampled = {}) const;
+
+	private:
+		// Tells apart instances allocated at the same address
+		const u64 id_ {next_id()};
+		mutable std::mutex mutex_;
+		// Never removed, so references given by `local()` stay valid
+		std::vector<std::unique_ptr<ThreadMetrics>> threads_;
+
+		static u64 next_id();
+	};
+} // namespace battleship
+
+#endif // BATTLESHIP_SERVER_METRICS_HPP
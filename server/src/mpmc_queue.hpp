@@ -0,0 +1,91 @@
+#ifndef BATTLESHIP_SERVER_MPMC_QUEUE_HPP
+#define BATTLESHIP_SERVER_MPMC_QUEUE_HPP
+
+#include <atomic>
+#include <bit>
+#include <memory>
+#include <optional>
+#include "battleship/common/util/num_types.hpp"
+
+namespace battleship {
+	// Bounded lock-free multi-producer multi-consumer queue (Dmitry Vyukov's design).
+	// Every cell carries a sequence number, which tells producers & consumers
+	// whether the cell is free for the current lap, so push & pop are
+	// a single CAS on the corresponding position in the common case.
+	template<typename T>
+	class MpmcQueue {
+	public:
+		// Capacity is rounded up to the power of 2
+		explicit MpmcQueue(size_t capacity):
+			cells_{std::make_unique<Cell[]>(std::bit_ceil(std::max<size_t>(capacity, 2)))}, // NOLINT
+			mask_{std::bit_ceil(std::max<size_t>(capacity, 2)) - 1}
+		{
+			for (size_t i = 0; i <= mask_; ++i) {
+				cells_[i].sequence.store(i, std::memory_order_relaxed);
+			}
+		}
+
+		MpmcQueue(const MpmcQueue&) = delete;
+		MpmcQueue& operator=(const MpmcQueue&) = delete;
+
+		// Returns false if the queue is full
+		bool try_push(const T& value) {
+			size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+			for (;;) {
+				Cell& cell = cells_[pos & mask_];
+				size_t seq = cell.sequence.load(std::memory_order_acquire);
+				auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+				if (diff == 0) {
+					if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+						cell.value = value;
+						cell.sequence.store(pos + 1, std::memory_order_release);
+						return true;
+					}
+				} else if (diff < 0) {
+					return false;
+				} else {
+					pos = enqueue_pos_.load(std::memory_order_relaxed);
+				}
+			}
+		}
+
+		// Returns nothing if the queue is empty
+		std::optional<T> try_pop() {
+			size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+			for (;;) {
+				Cell& cell = cells_[pos & mask_];
+				size_t seq = cell.sequence.load(std::memory_order_acquire);
+				auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+				if (diff == 0) {
+					if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+						T value = std::move(cell.value);
+						cell.sequence.store(pos + mask_ + 1, std::memory_order_release);
+						return value;
+					}
+				} else if (diff < 0) {
+					return {};
+				} else {
+					pos = dequeue_pos_.load(std::memory_order_relaxed);
+				}
+			}
+		}
+
+		[[nodiscard]] inline size_t capacity() const {
+			return mask_ + 1;
+		}
+
+	private:
+		struct Cell {
+			std::atomic<size_t> sequence;
+			T value;
+		};
+
+		std::unique_ptr<Cell[]> cells_; // NOLINT
+		const size_t mask_;
+		// Producers & consumers work on different cache lines
+		alignas(64) std::atomic<size_t> enqueue_pos_ {0};
+		alignas(64) std::atomic<size_t> dequeue_pos_ {0};
+	};
+} // namespace battleship
+
+#endif // BATTLESHIP_SERVER_MPMC_QUEUE_HPP
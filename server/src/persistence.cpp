@@ -0,0 +1,218 @@
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include "persistence.hpp"
+#include "battleship/common/util/log.hpp"
+#include "battleship/common/util/mapped_file.hpp"
+
+namespace battleship {
+	namespace {
+		namespace fs = std::filesystem;
+
+		[[noreturn]] void throw_errno(const std::string& what) {
+			throw std::runtime_error(what + ": " + std::strerror(errno));
+		}
+
+		// Number N of "<prefix>N<suffix>", nothing for other names
+		std::optional<u64> file_number(const fs::path& path, std::string_view prefix, std::string_view suffix) {
+			std::string name = path.filename().string();
+			if (name.size() <= prefix.size() + suffix.size()
+			 || !name.starts_with(prefix)
+			 || !name.ends_with(suffix)) {
+				return {};
+			}
+			u64 number = 0;
+			const char* first = name.data() + prefix.size();
+			const char* last = name.data() + name.size() - suffix.size();
+			auto [end, error] = std::from_chars(first, last, number);
+			if (error != std::errc{} || end != last) {
+				return {};
+			}
+			return number;
+		}
+
+		constexpr std::string_view SNAPSHOT_PREFIX = "snapshot-";
+		constexpr std::string_view SNAPSHOT_SUFFIX = ".bin";
+		constexpr std::string_view SEGMENT_PREFIX = "wal-";
+		constexpr std::string_view SEGMENT_SUFFIX = ".log";
+
+		// Numbers of the snapshots & the journal segments in the directory, ascending
+		struct Files {
+			std::vector<u64> snapshots;
+			std::vector<u64> segments;
+		};
+
+		Files list_files(const fs::path& dir) {
+			Files files;
+			for (const auto& entry: fs::directory_iterator{dir}) {
+				if (auto n = file_number(entry.path(), SNAPSHOT_PREFIX, SNAPSHOT_SUFFIX)) {
+					files.snapshots.push_back(*n);
+				} else if (auto m = file_number(entry.path(), SEGMENT_PREFIX, SEGMENT_SUFFIX)) {
+					files.segments.push_back(*m);
+				}
+			}
+			std::sort(files.snapshots.begin(), files.snapshots.end());
+			std::sort(files.segments.begin(), files.segments.end());
+			return files;
+		}
+
+		// Makes a rename in the directory durable
+		void sync_directory(const fs::path& dir) {
+			int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+			if (fd < 0) {
+				throw_errno("can't open " + dir.string());
+			}
+			int result = ::fsync(fd);
+			::close(fd);
+			if (result != 0) {
+				throw_errno("can't sync " + dir.string());
+			}
+		}
+	} // namespace
+
+	Recovery recover(GameStore& store, const fs::path& dir) {
+		auto start = std::chrono::steady_clock::now();
+		Recovery recovery;
+		fs::create_directories(dir);
+		Files files = list_files(dir);
+
+		const auto replay = [&store](RecordType type, RecordReader& reader) {
+			if (!store.replay(type, reader)) {
+				throw std::runtime_error("malformed record of type " + std::to_string(static_cast<int>(type)));
+			}
+		};
+		u64 first_segment = 0;
+		if (!files.snapshots.empty()) {
+			first_segment = files.snapshots.back();
+			fs::path path = Persistence::snapshot_path(dir, first_segment);
+			MappedFile file {path};
+			// Snapshots are renamed into place only when complete
+			size_t valid = read_records(file.bytes(), [&](RecordType type, RecordReader& reader) {
+				replay(type, reader);
+				++recovery.snapshot_records;
+			});
+			if (valid != file.bytes().size()) {
+				throw std::runtime_error("corrupted snapshot " + path.string());
+			}
+			recovery.bytes += valid;
+		}
+		recovery.next_segment = first_segment;
+		for (u64 segment: files.segments) {
+			recovery.next_segment = std::max(recovery.next_segment, segment + 1);
+			if (segment < first_segment) { continue; }
+			fs::path path = Journal::segment_path(dir, segment);
+			size_t valid = 0;
+			size_t size = 0;
+			{
+				MappedFile file {path};
+				size = file.bytes().size();
+				valid = read_records(file.bytes(), [&](RecordType type, RecordReader& reader) {
+					replay(type, reader);
+					++recovery.journal_records;
+				});
+			}
+			if (valid != size) {
+				// Rotation syncs a segment before the next one gets any records,
+				// so only the last one may be torn, anything else is lost history
+				if (segment != files.segments.back()) {
+					throw std::runtime_error("corrupted journal segment " + path.string());
+				}
+				fs::resize_file(path, valid);
+				recovery.torn_bytes += size - valid;
+			}
+			recovery.bytes += valid;
+			++recovery.segments;
+		}
+		recovery.waiting = store.finish_recovery();
+		recovery.duration = std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::steady_clock::now() - start
+		);
+		return recovery;
+	}
+
+	Persistence::Persistence(GameStore& store, PersistenceConfig config):
+		store_{store},
+		config_{std::move(config)},
+		recovery_{recover(store_, config_.dir)}
+	{
+		journal_.emplace(config_.dir, recovery_.next_segment, config_.flush_interval);
+		store_.set_journal(&*journal_);
+		store_.resume_bots();
+		snapshotter_ = std::thread{[this] { run(); }};
+	}
+
+	Persistence::~Persistence() {
+		{
+			std::scoped_lock lock{mutex_};
+			stopping_ = true;
+		}
+		wake_.notify_one();
+		snapshotter_.join();
+		store_.set_journal(nullptr);
+		journal_->flush();
+	}
+
+	fs::path Persistence::snapshot_path(const fs::path& dir, u64 segment) {
+		return dir / (std::string{SNAPSHOT_PREFIX} + std::to_string(segment) + std::string{SNAPSHOT_SUFFIX});
+	}
+
+	u64 Persistence::snapshot() {
+		std::scoped_lock lock{snapshot_mutex_};
+		auto start = std::chrono::steady_clock::now();
+		u64 segment = journal_->rotate();
+		fs::path path = snapshot_path(config_.dir, segment);
+		fs::path tmp = path;
+		tmp.replace_extension(".tmp");
+		{
+			AppendFile file {tmp, true};
+			// Shard by shard, so only one shard at a time waits for the copy
+			std::vector<u8> buffer;
+			for (size_t i = 0; i < store_.shard_count(); ++i) {
+				buffer.clear();
+				store_.snapshot(i, buffer);
+				file.write(buffer);
+			}
+			file.sync();
+		}
+		fs::rename(tmp, path);
+		sync_directory(config_.dir);
+
+		Files files = list_files(config_.dir);
+		for (u64 old: files.snapshots) {
+			if (old < segment) { fs::remove(snapshot_path(config_.dir, old)); }
+		}
+		for (u64 old: files.segments) {
+			if (old < segment) { fs::remove(Journal::segment_path(config_.dir, old)); }
+		}
+		snapshots_.fetch_add(1, std::memory_order_relaxed);
+		last_snapshot_us_.store(static_cast<u64>(std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::steady_clock::now() - start
+		).count()), std::memory_order_relaxed);
+		return segment;
+	}
+
+	void Persistence::run() {
+		for (;;) {
+			{
+				std::unique_lock lock{mutex_};
+				if (wake_.wait_for(lock, config_.snapshot_interval, [this] { return stopping_; })) {
+					return;
+				}
+			}
+			try {
+				u64 segment = snapshot();
+				BATTLESHIP_LOG(Info, "snapshot written",
+					log::kv("segment", segment), log::kv("us", last_snapshot().count())
+				);
+			} catch (const std::exception& e) {
+				// The journal still has everything, so keep going & retry later
+				BATTLESHIP_LOG(Error, "snapshot failed", log::kv("error", std::string_view{e.what()}));
+			}
+		}
+	}
+} // namespace battleship
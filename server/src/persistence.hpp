@@ -0,0 +1,103 @@
+#ifndef BATTLESHIP_SERVER_PERSISTENCE_HPP
+#define BATTLESHIP_SERVER_PERSISTENCE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+#include "game_store.hpp"
+#include "journal.hpp"
+
+namespace battleship {
+	// Where & how often the game state is saved
+	struct PersistenceConfig {
+		std::filesystem::path dir;
+		// Group commit interval of the journal, at most that much is lost in a crash
+		std::chrono::milliseconds flush_interval {10};
+		// Snapshots bound the journal replayed on recovery
+		std::chrono::seconds snapshot_interval {60};
+	};
+
+	// What `recover()` has found
+	struct Recovery {
+		// Segment to continue the journal with
+		u64 next_segment {0};
+		u64 snapshot_records {0};
+		u64 journal_records {0};
+		u64 bytes {0};
+		// Journal segments replayed
+		size_t segments {0};
+		// Bytes of a record torn by a crash, cut off the journal
+		u64 torn_bytes {0};
+		// Humans who wait for an enemy, to be matched again, with the kinds of their games
+		std::vector<std::pair<UUID, GameKind>> waiting;
+		std::chrono::microseconds duration {0};
+	};
+
+	// Loads the latest snapshot of `dir` into the empty store & replays the journal after it.
+	// Files are mapped into memory & read in place.
+	// Throws if a snapshot or a journal record is corrupted, except for a torn record
+	// at the end of the last segment, which is the trace of a crash & is cut off.
+	Recovery recover(GameStore& store, const std::filesystem::path& dir);
+
+	// Keeps the store on disk as snapshots plus the journal of changes since the latest one.
+	// Snapshot N holds the state as of the start of journal segment N:
+	// the journal is rotated first, then shards are copied one at a time while
+	// requests go on, & changes made meanwhile are replayed from segment N on recovery.
+	// Once a snapshot is complete, older snapshots & segments are deleted.
+	class Persistence {
+	public:
+		// Recovers the store from `config.dir` & logs its changes from now on.
+		// The store must be empty & outlive this.
+		Persistence(GameStore& store, PersistenceConfig config);
+		Persistence(const Persistence&) = delete;
+		Persistence& operator=(const Persistence&) = delete;
+		// Stops logging & flushes the journal
+		~Persistence();
+
+		// Writes a snapshot now, thread safe. Returns its number.
+		u64 snapshot();
+
+		[[nodiscard]] inline const Recovery& recovery() const {
+			return recovery_;
+		}
+
+		[[nodiscard]] inline const Journal& journal() const {
+			return *journal_;
+		}
+
+		[[nodiscard]] inline u64 snapshots() const {
+			return snapshots_.load(std::memory_order_relaxed);
+		}
+
+		// Duration of the latest snapshot
+		[[nodiscard]] inline std::chrono::microseconds last_snapshot() const {
+			return std::chrono::microseconds{last_snapshot_us_.load(std::memory_order_relaxed)};
+		}
+
+		[[nodiscard]] static std::filesystem::path snapshot_path(const std::filesystem::path& dir, u64 segment);
+
+	private:
+		GameStore& store_;
+		const PersistenceConfig config_;
+		Recovery recovery_;
+		std::optional<Journal> journal_;
+		// One snapshot at a time
+		std::mutex snapshot_mutex_;
+		std::atomic<u64> snapshots_ {0};
+		std::atomic<u64> last_snapshot_us_ {0};
+
+		std::mutex mutex_;
+		std::condition_variable wake_;
+		bool stopping_ {false};
+		std::thread snapshotter_;
+
+		void run();
+	};
+} // namespace battleship
+
+#endif // BATTLESHIP_SERVER_PERSISTENCE_HPP
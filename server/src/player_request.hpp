@@ -0,0 +1,272 @@
+#ifndef BATTLESHIP_SERVER_PLAYER_REQUEST_HPP
+#define BATTLESHIP_SERVER_PLAYER_REQUEST_HPP
+
+#include <array>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+#include "game.hpp"
+#include "game_store.hpp"
+#include "pool.hpp"
+
+namespace battleship {
+	// Body of /shoot, /status & /field, or an operation of /batch
+	struct PlayerRequest {
+		std::optional<UUID> uuid;
+		// Exactly [row, col], otherwise nothing
+		std::optional<Position> shot;
+		ProtocolVersion version {ProtocolVersion::V1};
+		// Only in /batch: "shoot", "status" or "field", otherwise nothing
+		std::optional<BatchOp::Kind> op;
+		// Only in /batch: revision of the field the client has, as ?since of /field
+		std::optional<u32> since;
+	};
+
+	// json, whose byte strings come from the thread's BlockPool. The CBOR reader grows
+	// a byte string one byte at a time, e.g. a UUID took 5 allocations from the heap.
+	using PooledBinaryJson = nlohmann::basic_json<
+		std::map, std::vector, std::string, bool, std::int64_t, std::uint64_t, double,
+		std::allocator, nlohmann::adl_serializer, std::vector<u8, PoolAllocator<u8>>
+	>;
+
+	// SAX handler, which reads {"uuid": [bytes] or bytes, "shot": [row, col], "version": N, "since": N}
+	// into `PlayerRequest` without building a json tree, or an array of such objects
+	// (with "op" as well) into a vector of them.
+	// A UUID or a shot of a wrong size is left out, unknown keys are skipped with their values.
+	class PlayerRequestSax {
+	public:
+		explicit PlayerRequestSax(PlayerRequest& request): request_{&request} {}
+
+		explicit PlayerRequestSax(std::vector<PlayerRequest>& batch): batch_{&batch} {}
+
+		[[nodiscard]] inline bool is_complete() const {
+			return place_ == Place::Done;
+		}
+
+		// json_sax interface
+
+		bool null() {
+			return other_value();
+		}
+
+		bool boolean([[maybe_unused]] bool value) {
+			return other_value();
+		}
+
+		bool number_integer(json::number_integer_t value) {
+			if (value < 0) { return other_value(); }
+			return number_unsigned(static_cast<json::number_unsigned_t>(value));
+		}
+
+		bool number_unsigned(json::number_unsigned_t value) {
+			if (skip_depth_ > 0) { return true; }
+			switch (place_) {
+			case Place::Root:
+				if (key_ == Key::Version) {
+					request_->version = (value >= 2) ? ProtocolVersion::V2 : ProtocolVersion::V1;
+				} else if (key_ == Key::Since && value <= UINT32_MAX) {
+					request_->since = static_cast<u32>(value);
+				}
+				return true;
+			case Place::Bytes:
+				if (value > UINT8_MAX || count_ == bytes_.size()) {
+					fits_ = false;
+				} else {
+					bytes_[count_++] = static_cast<u8>(value);
+				}
+				return true;
+			default:
+				return false;
+			}
+		}
+
+		bool number_float(
+			[[maybe_unused]] json::number_float_t value,
+			[[maybe_unused]] const std::string& str
+		) {
+			return other_value();
+		}
+
+		bool string(std::string& value) {
+			if (skip_depth_ == 0 && place_ == Place::Root && key_ == Key::Op) {
+				request_->op = batch_op(value);
+			}
+			return other_value();
+		}
+
+		bool binary(PooledBinaryJson::binary_t& value) {
+			if (skip_depth_ == 0 && place_ == Place::Root
+			 && key_ == Key::Uuid && value.size() == UUID::static_size()) {
+				request_->uuid = uuid(value);
+			}
+			return other_value();
+		}
+
+		bool start_object([[maybe_unused]] std::size_t size) {
+			if (place_ == Place::Top && batch_ == nullptr) {
+				place_ = Place::Root;
+				return true;
+			}
+			if (place_ == Place::Batch) {
+				request_ = &batch_->emplace_back();
+				place_ = Place::Root;
+				return true;
+			}
+			return skip();
+		}
+
+		bool key(std::string& key) {
+			if (skip_depth_ > 0) { return true; }
+			if (place_ != Place::Root) { return false; }
+			if (key == "uuid") {
+				key_ = Key::Uuid;
+			} else if (key == "shot") {
+				key_ = Key::Shot;
+			} else if (key == "version") {
+				key_ = Key::Version;
+			} else if (key == "op") {
+				key_ = Key::Op;
+			} else if (key == "since") {
+				key_ = Key::Since;
+			} else {
+				key_ = Key::Other;
+			}
+			return true;
+		}
+
+		bool end_object() {
+			if (skip_depth_ > 0) {
+				--skip_depth_;
+				return true;
+			}
+			if (place_ != Place::Root) { return false; }
+			place_ = (batch_ != nullptr) ? Place::Batch : Place::Done;
+			return true;
+		}
+
+		bool start_array([[maybe_unused]] std::size_t size) {
+			if (place_ == Place::Top && batch_ != nullptr) {
+				place_ = Place::Batch;
+				return true;
+			}
+			if (skip_depth_ == 0 && place_ == Place::Root
+			 && (key_ == Key::Uuid || key_ == Key::Shot)) {
+				place_ = Place::Bytes;
+				count_ = 0;
+				fits_ = true;
+				return true;
+			}
+			return skip();
+		}
+
+		bool end_array() {
+			if (skip_depth_ > 0) {
+				--skip_depth_;
+				return true;
+			}
+			if (place_ == Place::Batch) {
+				place_ = Place::Done;
+				return true;
+			}
+			if (place_ != Place::Bytes) { return false; }
+			place_ = Place::Root;
+			if (!fits_) { return true; }
+			if (key_ == Key::Uuid && count_ == UUID::static_size()) {
+				request_->uuid = uuid(std::span{bytes_.data(), count_});
+			} else if (key_ == Key::Shot && count_ == 2) {
+				request_->shot = Position{bytes_[0], bytes_[1]};
+			}
+			return true;
+		}
+
+		bool parse_error(
+			[[maybe_unused]] std::size_t position,
+			[[maybe_unused]] const std::string& last_token,
+			[[maybe_unused]] const nlohmann::detail::exception& ex
+		) {
+			return false;
+		}
+
+	private:
+		// Object or array we're in, Batch is the top array of /batch
+		enum class Place { Top, Batch, Root, Bytes, Done };
+		// Key of the current value in the root object
+		enum class Key { Other, Uuid, Shot, Version, Op, Since };
+
+		// Request being read
+		PlayerRequest* request_ {nullptr};
+		std::vector<PlayerRequest>* batch_ {nullptr};
+		Place place_ {Place::Top};
+		Key key_ {Key::Other};
+		size_t skip_depth_ {0};
+		// Elements of the "uuid" or "shot" array
+		std::array<u8, UUID::static_size()> bytes_ {};
+		size_t count_ {0};
+		// All elements so far are bytes & there aren't too many of them
+		bool fits_ {true};
+
+		static std::optional<BatchOp::Kind> batch_op(std::string_view name) {
+			if (name == "shoot") { return BatchOp::Kind::Shoot; }
+			if (name == "status") { return BatchOp::Kind::Status; }
+			if (name == "field") { return BatchOp::Kind::Field; }
+			return {};
+		}
+
+		static UUID uuid(std::span<const u8> bytes) {
+			UUID uuid {};
+			std::copy(bytes.begin(), bytes.end(), uuid.begin());
+			return uuid;
+		}
+
+		// Nested object or array, which is skipped (or spoils the byte array it's in)
+		bool skip() {
+			if (skip_depth_ == 0) {
+				if (place_ == Place::Bytes) {
+					fits_ = false;
+				} else if (place_ != Place::Root) {
+					return false;
+				}
+			}
+			++skip_depth_;
+			return true;
+		}
+
+		bool other_value() {
+			if (skip_depth_ > 0) { return true; }
+			switch (place_) {
+			case Place::Root:
+				return true;
+			case Place::Bytes:
+				fits_ = false;
+				return true;
+			default:
+				return false;
+			}
+		}
+	};
+
+	// Decodes the body straight from CBOR, returns nothing if it's malformed
+	inline std::optional<PlayerRequest> player_request_from_cbor(std::span<const u8> cbor) {
+		PlayerRequest request;
+		PlayerRequestSax sax {request};
+		bool ok = PooledBinaryJson::sax_parse(cbor.begin(), cbor.end(), &sax, json::input_format_t::cbor);
+		if (!ok || !sax.is_complete()) {
+			return {};
+		}
+		return request;
+	}
+
+	// Decodes the body of /batch, returns nothing if it's malformed
+	inline std::optional<std::vector<PlayerRequest>> batch_from_cbor(std::span<const u8> cbor) {
+		std::vector<PlayerRequest> batch;
+		PlayerRequestSax sax {batch};
+		bool ok = PooledBinaryJson::sax_parse(cbor.begin(), cbor.end(), &sax, json::input_format_t::cbor);
+		if (!ok || !sax.is_complete()) {
+			return {};
+		}
+		return batch;
+	}
+} // namespace battleship
+
+#endif // BATTLESHIP_SERVER_PLAYER_REQUEST_HPP
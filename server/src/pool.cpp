@@ -0,0 +1,71 @@
+#include <algorithm>
+#include "pool.hpp"
+
+namespace battleship {
+	BlockPool::~BlockPool() {
+		for (FreeBlock* block: free_) {
+			while (block != nullptr) {
+				FreeBlock* next = block->next;
+				::operator delete(block);
+				block = next;
+			}
+		}
+	}
+
+	BlockPool& BlockPool::local() {
+		thread_local BlockPool pool;
+		return pool;
+	}
+
+	void* BlockPool::allocate(size_t bytes) {
+		if (bytes > MAX_BLOCK) {
+			return ::operator new(bytes);
+		}
+		size_t i = size_class(bytes);
+		FreeBlock* block = free_[i];
+		if (block == nullptr) {
+			return ::operator new((i + 1) * GRANULE);
+		}
+		free_[i] = block->next;
+		--count_[i];
+		return block;
+	}
+
+	void BlockPool::deallocate(void* block, size_t bytes) noexcept {
+		if (block == nullptr) { return; }
+		size_t i = size_class(bytes);
+		if (bytes > MAX_BLOCK || count_[i] == MAX_FREE) {
+			return ::operator delete(block);
+		}
+		free_[i] = new (block) FreeBlock{free_[i]};
+		++count_[i];
+	}
+
+	BufferPool::BufferPool() {
+		buffers_.reserve(MAX_BUFFERS);
+	}
+
+	BufferPool& BufferPool::local() {
+		thread_local BufferPool pool;
+		return pool;
+	}
+
+	std::vector<u8> BufferPool::acquire() {
+		if (buffers_.empty()) {
+			return {};
+		}
+		std::vector<u8> buffer = std::move(buffers_.back());
+		buffers_.pop_back();
+		return buffer;
+	}
+
+	void BufferPool::release(std::vector<u8>&& buffer) {
+		if (buffer.capacity() == 0
+		 || buffer.capacity() > MAX_CAPACITY
+		 || buffers_.size() == MAX_BUFFERS) {
+			return;
+		}
+		buffer.clear();
+		buffers_.push_back(std::move(buffer));
+	}
+} // namespace battleship
@@ -0,0 +1,124 @@
+#ifndef BATTLESHIP_SERVER_POOL_HPP
+#define BATTLESHIP_SERVER_POOL_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+#include "battleship/common/util/num_types.hpp"
+
+namespace battleship {
+	// Free lists of small blocks in size classes of GRANULE bytes, one pool per thread.
+	// A block freed by another thread goes to that thread's pool. Lists are capped,
+	// so blocks don't pile up on a thread which frees more than it allocates.
+	// Bigger blocks go straight to operator new.
+	class BlockPool {
+	public:
+		static constexpr size_t GRANULE = 64;
+		static constexpr size_t CLASSES = 16;
+		static constexpr size_t MAX_BLOCK = GRANULE * CLASSES;
+		// Free blocks kept per size class
+		static constexpr size_t MAX_FREE = 256;
+
+		BlockPool() = default;
+		BlockPool(const BlockPool&) = delete;
+		BlockPool& operator=(const BlockPool&) = delete;
+		~BlockPool();
+
+		[[nodiscard]] void* allocate(size_t bytes);
+		void deallocate(void* block, size_t bytes) noexcept;
+
+		// Pool of the calling thread
+		static BlockPool& local();
+
+	private:
+		struct FreeBlock {
+			FreeBlock* next;
+		};
+
+		std::array<FreeBlock*, CLASSES> free_ {};
+		std::array<size_t, CLASSES> count_ {};
+
+		[[nodiscard]] static inline size_t size_class(size_t bytes) {
+			return (std::max<size_t>(bytes, 1) - 1) / GRANULE;
+		}
+	};
+
+	// Stateless allocator from the calling thread's BlockPool,
+	// e.g. for HTTP header fields & for the state of asynchronous operations
+	template<typename T>
+	struct PoolAllocator {
+		using value_type = T;
+
+		PoolAllocator() = default;
+
+		template<typename U>
+		PoolAllocator(const PoolAllocator<U>& /*other*/) noexcept {} // NOLINT
+
+		[[nodiscard]] T* allocate(size_t n) {
+			static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+			return static_cast<T*>(BlockPool::local().allocate(n * sizeof(T)));
+		}
+
+		void deallocate(T* p, size_t n) noexcept {
+			BlockPool::local().deallocate(p, n * sizeof(T));
+		}
+
+		template<typename U>
+		bool operator==(const PoolAllocator<U>& /*other*/) const noexcept {
+			return true;
+		}
+	};
+
+	// Completion handler, which allocates the state of its operation from the BlockPool
+	// (Asio & Beast use the handler's associated allocator for that)
+	template<typename Handler>
+	class PooledHandler {
+	public:
+		using allocator_type = PoolAllocator<std::byte>;
+
+		explicit PooledHandler(Handler&& handler): handler_{std::move(handler)} {}
+
+		template<typename... Args>
+		void operator()(Args&&... args) {
+			handler_(std::forward<Args>(args)...);
+		}
+
+		[[nodiscard]] allocator_type get_allocator() const noexcept {
+			return {};
+		}
+
+	private:
+		Handler handler_;
+	};
+
+	template<typename Handler>
+	PooledHandler<Handler> pooled(Handler&& handler) {
+		return PooledHandler<Handler>{std::forward<Handler>(handler)};
+	}
+
+	// Byte buffers, which keep their capacity between uses, one pool per thread.
+	// E.g. a response body is taken from the pool & given back once it's written.
+	class BufferPool {
+	public:
+		static constexpr size_t MAX_BUFFERS = 64;
+		// Bigger buffers are freed, so that a rare huge body isn't kept forever
+		static constexpr size_t MAX_CAPACITY = 64 * 1024;
+
+		BufferPool();
+
+		// Empty buffer, probably with some capacity
+		[[nodiscard]] std::vector<u8> acquire();
+		void release(std::vector<u8>&& buffer);
+
+		// Pool of the calling thread
+		static BufferPool& local();
+
+	private:
+		std::vector<std::vector<u8>> buffers_;
+	};
+} // namespace battleship
+
+#endif // BATTLESHIP_SERVER_POOL_HPP
@@ -0,0 +1,113 @@
+#ifndef BATTLESHIP_SERVER_ROUTER_HPP
+#define BATTLESHIP_SERVER_ROUTER_HPP
+
+#include <array>
+#include <bit>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <boost/beast/http/verb.hpp>
+#include "battleship/common/util/num_types.hpp"
+
+namespace battleship {
+	// Routes of the server, matched by (method, path).
+	// `Entry` has at least `boost::beast::http::verb method` & `std::string_view path`,
+	// entries with the same path must be next to each other.
+	// Paths are looked up through a perfect hash, whose seed is found at compile time,
+	// so a match is one hash of the path, one string comparison & a check of the method.
+	template<typename Entry, size_t N>
+	class RouteTable {
+	public:
+		static_assert(N > 0 && N < UINT8_MAX);
+
+		// Empty slots make finding a seed quick
+		static constexpr size_t SLOTS = std::bit_ceil(N) * 4;
+
+		enum class Outcome : u8 {
+			Found,
+			// Path is known, but not with this method
+			MethodNotAllowed,
+			NotFound
+		};
+
+		struct Match {
+			Outcome outcome;
+			// Route if found, otherwise the first route of the path (if any)
+			const Entry* entry;
+		};
+
+		consteval explicit RouteTable(const std::array<Entry, N>& entries):
+			entries_{entries}, seed_{find_seed(entries)}
+		{
+			for (size_t i = N; i > 0; --i) {
+				// The first entry of a path wins
+				slots_[slot(entries_[i - 1].path, seed_)] = static_cast<u8>(i);
+			}
+		}
+
+		[[nodiscard]] constexpr Match find(boost::beast::http::verb method, std::string_view path) const {
+			u8 first = slots_[slot(path, seed_)];
+			if (first == 0 || entries_[first - 1].path != path) {
+				return {Outcome::NotFound, nullptr};
+			}
+			for (size_t i = first - 1; i < N && entries_[i].path == path; ++i) {
+				if (entries_[i].method == method) {
+					return {Outcome::Found, &entries_[i]};
+				}
+			}
+			return {Outcome::MethodNotAllowed, &entries_[first - 1]};
+		}
+
+		// Value of the Allow header for a known path, e.g. "GET, PATCH"
+		[[nodiscard]] std::string allowed(std::string_view path) const {
+			std::string allow;
+			for (const Entry& entry: entries_) {
+				if (entry.path != path) { continue; }
+				if (!allow.empty()) {
+					allow += ", ";
+				}
+				allow += boost::beast::http::to_string(entry.method);
+			}
+			return allow;
+		}
+
+		[[nodiscard]] constexpr const std::array<Entry, N>& entries() const {
+			return entries_;
+		}
+
+	private:
+		std::array<Entry, N> entries_;
+		u32 seed_;
+		// Index of the first entry of the path + 1, or 0
+		std::array<u8, SLOTS> slots_ {};
+
+		// FNV-1a, with the seed mixed into the offset basis
+		[[nodiscard]] static constexpr size_t slot(std::string_view path, u32 seed) {
+			u32 hash = 2166136261U ^ seed;
+			for (char c: path) {
+				hash ^= static_cast<u8>(c);
+				hash *= 16777619U;
+			}
+			return hash & (SLOTS - 1);
+		}
+
+		static consteval u32 find_seed(const std::array<Entry, N>& entries) {
+			for (u32 seed = 0; seed < (1U << 16); ++seed) {
+				std::array<bool, SLOTS> taken {};
+				bool collides = false;
+				for (size_t i = 0; i < N && !collides; ++i) {
+					if (i > 0 && entries[i].path == entries[i - 1].path) { continue; }
+					size_t s = slot(entries[i].path, seed);
+					collides = taken[s];
+					taken[s] = true;
+				}
+				if (!collides) {
+					return seed;
+				}
+			}
+			throw std::logic_error("No perfect hash of the route paths");
+		}
+	};
+} // namespace battleship
+
+#endif // BATTLESHIP_SERVER_ROUTER_HPP
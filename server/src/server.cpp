@@ -16,15 +16,34 @@
 //------------------------------------------------------------------------------
 
 #include <algorithm>
+#include <array>
+#include <bit>
+#include <charconv>
+#include <chrono>
+#include <csignal>
+#include <deque>
+#include <optional>
 #include <span>
 #include <unordered_map>
+#include <boost/asio/signal_set.hpp>
 #include <boost/beast/http/vector_body.hpp>
 #include <boost/container/static_vector.hpp>
-#include <boost/uuid/random_generator.hpp>
 #include <nlohmann/byte_container_with_subtype.hpp>
+#include "archive.hpp"
+#include "cbor_writer.hpp"
 #include "game.hpp"
+#include "persistence.hpp"
+#include "player_request.hpp"
+#include "pool.hpp"
+#include "router.hpp"
+#include "server.hpp"
+#include "server_state.hpp"
+#include "tls.hpp"
+#include "uuid_generator.hpp"
 #include "pch.hpp"
 #include "battleship/common/common.hpp"
+#include "battleship/common/ships_sax.hpp"
+#include "battleship/common/util/async_log.hpp"
 
 namespace battleship {
 	namespace beast = boost::beast; // from <boost/beast.hpp>
@@ -32,6 +51,22 @@ namespace battleship {
 	namespace net   = boost::asio; // from <boost/asio.hpp>
 	namespace ssl   = boost::asio::ssl; // from <boost/asio/ssl.hpp>
 	using tcp = boost::asio::ip::tcp; // from <boost/asio/ip/tcp.hpp>
+
+	// Header fields come from the thread's BlockPool instead of the heap
+	using PooledFields = http::basic_fields<PoolAllocator<char>>;
+	using Request      = http::request<http::vector_body<u8>, PooledFields>;
+	using CborResponse = http::response<http::vector_body<u8>, PooledFields>;
+	using TextResponse = http::response<http::string_body, PooledFields>;
+
+	// Concrete executor types instead of any_io_executor,
+	// which puts a copy of the strand on the heap for every operation
+	using Strand    = net::strand<net::io_context::executor_type>;
+	using TcpSocket = net::basic_stream_socket<tcp, Strand>;
+	using TcpStream = beast::basic_stream<tcp, Strand>;
+	using TlsStream = beast::ssl_stream<TcpStream>;
+	using Timer     = net::basic_waitable_timer<
+		std::chrono::steady_clock, net::wait_traits<std::chrono::steady_clock>, Strand
+	>;
 	
 	UUIDVec vec_from_uuid(const UUID& uuid) {
 		return {uuid.begin(), uuid.end()};
@@ -49,155 +84,797 @@ namespace battleship {
 		return arr;
 	}
 
-	// This function produces an HTTP response for the given
-	// request. The type of the response object depends on the
-	// contents of the request, so the interface requires the
-	// caller to pass a generic lambda for receiving the response.
-	template<class Send>
-	void handle_request(http::request<http::vector_body<u8>>&& req, Send&& send) {
-		using nlohmann::json;
-
-		// Returns cbor response
-		const auto cbor_response = [&req](http::status status, std::vector<u8>&& data) {
-			http::response<http::vector_body<u8>> res {status, req.version()};
-			res.set(http::field::server, BOOST_BEAST_VERSION_STRING);
-			res.set(http::field::content_type, "application/cbor");
-			res.keep_alive(req.keep_alive());
-			res.body() = std::move(data);
-			res.prepare_payload();
-			return res;
-		};
-		const auto cbor_str_response = [&cbor_response](
-			http::status status,
-			std::string_view msg
-		) {
-			json j_string{msg};	
-			return cbor_response(
-				status,
-				std::move(json::to_cbor(j_string))
-			);
-		};
-
-	    // Request path must be absolute and not contain "..".
-	    if (req.target().empty()
-		 || req.target()[0] != '/'
-		 || req.target().find("..") != std::string_view::npos) {
-			return send(cbor_str_response(http::status::bad_request, "Illegal request target"));
-		}
-	
-		boost::uuids::random_generator_mt19937 uuid_generator;
-		PlayerList players;
-		PlayerQueue players_queue;
-		std::vector<Room> rooms;
-		RoomMap room_map;
-	
-	    // Start game
-		if ( (req.target() == "/start") && (req.method() == http::verb::post) ) {
-			// Check ships positions & return the result to player
-			auto ships = json::from_cbor(req.body()).get<StdShips>();
-			std::cout << "ships: " << json::from_cbor(req.body()) << std::endl;
-			auto player_result = Player::try_from_ships(std::move(ships));
-			std::cout << "player_result: " << is_ok(player_result) << '\n';
-			// if player is ok, generate UUID, put player in a queue & return their UUID
-			if (is_ok(player_result)) {
-				auto player = std::get<Player>(player_result);
-				UUID uuid = uuid_generator();
-				players.insert({uuid, player});
-				players_queue.push(uuid);
-				json response_body;
-				response_body["uuid"] = json::binary(vec_from_uuid(uuid));
-				response_body["field"] = player;
-				std::cout << "Body: \n" << response_body << '\n';
-				return send(cbor_response(http::status::ok, json::to_cbor(response_body)));
-			}
-			// else return bad request & reason
-			return send(cbor_str_response(
-				http::status::bad_request, "Bad ships layout"
-			));
+	// Splits request target into path & query string
+	std::pair<std::string_view, std::string_view> split_target(std::string_view target) {
+		size_t question = target.find('?');
+		if (question == std::string_view::npos) {
+			return {target, {}};
 		}
-		// Shoot
-		if ( (req.target() == "/shoot") && (req.method() == http::verb::patch) ) {
-			json req_body = json::from_cbor(req.body());
-			UUIDVec uuid_vec {req_body.value("uuid", UUIDVec{})};
-			UUID uuid = uuid_from_span(UUIDSpan{uuid_vec});
+		return {target.substr(0, question), target.substr(question + 1)};
+	}
 
-			// If player provided wrong or no UUID, then return error
-			if (!players.contains(uuid)) {
-				return send(cbor_str_response(
-					http::status::unauthorized, "No player with such UUID"
-				));
+	// Finds value of the parameter in query string like "a=1&b&c=3",
+	// parameters without a value have an empty one
+	std::optional<std::string_view> query_param(std::string_view query, std::string_view name) {
+		while (!query.empty()) {
+			size_t amp = query.find('&');
+			std::string_view param = query.substr(0, amp);
+			size_t eq = param.find('=');
+			if (param.substr(0, eq) == name) {
+				return (eq == std::string_view::npos) ? std::string_view{} : param.substr(eq + 1);
 			}
-			auto room = rooms[room_map[uuid]];
-			auto enemy_uuid_option = room.my_enemy(uuid);
-			if (!enemy_uuid_option.has_value()) {
-				return send(cbor_str_response(
-					http::status::internal_server_error,
-					"This UUID was mapped to the room, but this room doesn't contain this UUID"
-				));
+			if (amp == std::string_view::npos) { break; }
+			query.remove_prefix(amp + 1);
+		}
+		return {};
+	}
+
+	// Serializes into a buffer of the thread's BufferPool,
+	// the session gives it back once the response is written
+	std::vector<u8> pooled_cbor(const json& j) {
+		std::vector<u8> buffer = BufferPool::local().acquire();
+		json::to_cbor(j, buffer);
+		return buffer;
+	}
+
+	CborResponse make_cbor_response(
+		http::status status,
+		unsigned version,
+		bool keep_alive,
+		std::vector<u8>&& data
+	) {
+		CborResponse res {status, version};
+		res.set(http::field::server, BOOST_BEAST_VERSION_STRING);
+		res.set(http::field::content_type, "application/cbor");
+		res.keep_alive(keep_alive);
+		res.body() = std::move(data);
+		res.prepare_payload();
+		return res;
+	}
+
+	// Seed for non-cryptographic generators
+	u64 random_seed() {
+		std::array<u8, sizeof(u64)> seed {};
+		UuidGenerator::local().fill(seed);
+		return std::bit_cast<u64>(seed);
+	}
+
+	// Random fleet for /start?auto & bots, every thread has its own generator of every kind
+	Player random_player(const GameKind& kind) {
+		return std::visit([]<typename Game>(Game /*kind*/) -> Player {
+			thread_local typename Game::FleetGen generator {random_seed()};
+			return generator();
+		}, kind);
+	}
+
+	// Reason to answer a request with an error instead of calling its handler
+	struct Rejection {
+		http::status status;
+		std::string_view message;
+	};
+
+	// Answer to a failed game operation
+	Rejection game_error(GameError error) {
+		switch (error) {
+		case GameError::NoSuchPlayer:
+			return {http::status::unauthorized, "No player with such UUID"};
+		case GameError::NoRoom:
+			return {http::status::locked, "Wait for an enemy"};
+		case GameError::NotYourMove:
+			return {http::status::locked, "Wait for enemy's move"};
+		case GameError::OutOfBounds:
+			return {http::status::bad_request, "Shot is out of bounds"};
+		case GameError::AlreadyShot:
+			return {http::status::bad_request, "Cell is already shot"};
+		case GameError::GameOver:
+			return {http::status::gone, "Game is over"};
+		}
+		return {http::status::internal_server_error, "Unknown error"};
+	}
+
+	// /status tells only about unknown players & closed rooms
+	Rejection status_error(GameError error) {
+		if (error == GameError::NoSuchPlayer) {
+			return game_error(error);
+		}
+		return {http::status::gone, "Room is closed"};
+	}
+
+	// The longest time /status?wait may hold a request
+	constexpr std::chrono::seconds MAX_STATUS_WAIT {25};
+	// Operations in one /batch, so that a batch can't hold the game state for long
+	constexpr size_t MAX_BATCH_OPS = 1024;
+	// Rooms listed by /rooms
+	constexpr size_t MAX_LISTED_ROOMS = 1024;
+
+	// HTTP status of /status
+	http::status status_code(const Status& status) {
+		return status.is_waiting() ? http::status::locked : http::status::ok;
+	}
+
+	// Body of /status, which is empty while waiting for an enemy:
+	// {"enemy_move": [[row, col], ...], "status": N} is written without a json tree
+	void write_status(CborWriter& cbor, const Status& status) {
+		using State = Status::State;
+		bool has_enemy_move = status.state == State::YourMove && !status.enemy_move.empty();
+		cbor.map(has_enemy_move ? 2 : 1);
+		if (has_enemy_move) {
+			cbor.text("enemy_move");
+			cbor.array(status.enemy_move.size());
+			for (const Position& pos: status.enemy_move) {
+				cbor.array(2);
+				cbor.integer(pos.row);
+				cbor.integer(pos.col);
 			}
-			UUID enemy_uuid = enemy_uuid_option.value();
-			if (!room.is_my_move(uuid)) {
-				return send(cbor_str_response(
-					http::status::locked, "Wait for enemy's move"
-				));
+		}
+		cbor.text("status");
+		switch (status.state) {
+		case State::Won:
+			cbor.integer(1);
+			break;
+		case State::Lost:
+			cbor.integer(-1);
+			break;
+		default:
+			cbor.integer(0);
+			break;
+		}
+	}
+
+	// Bitset of a grid, in the format of the serializer of `Bitboard` in V2
+	// & of `Bitboard::to_string()` in V1
+	template<typename Cells>
+	void write_cells(CborWriter& cbor, const Cells& cells, ProtocolVersion version) {
+		if (version == ProtocolVersion::V2) {
+			return cbor.bytes(cells.to_bytes());
+		}
+		std::array<char, Cells::size()> text;
+		text.fill('0');
+		cells.for_each_set([&text](size_t i) { text[text.size() - 1 - i] = '1'; });
+		cbor.text({text.data(), text.size()});
+	}
+
+	void write_position(CborWriter& cbor, const Position& pos) {
+		cbor.map(2);
+		cbor.text("col");
+		cbor.integer(pos.col);
+		cbor.text("row");
+		cbor.integer(pos.row);
+	}
+
+	// {"grid": {"ships": cells, "shots": cells}, "ships": {"ships": [{"zone": rect}, ...]}},
+	// the same as `PlayerField::serialize()`
+	template<typename Field>
+	void write_player_field(CborWriter& cbor, const Field& field, ProtocolVersion version) {
+		cbor.map(2);
+		cbor.text("grid");
+		cbor.map(2);
+		cbor.text("ships");
+		write_cells(cbor, field.grid.ship_cells(), version);
+		cbor.text("shots");
+		write_cells(cbor, field.grid.shot_cells(), version);
+		cbor.text("ships");
+		cbor.map(1);
+		cbor.text("ships");
+		cbor.array(field.ships.ships.size());
+		for (const Ship& ship: field.ships.ships) {
+			cbor.map(1);
+			cbor.text("zone");
+			cbor.map(2);
+			cbor.text("first");
+			write_position(cbor, ship.zone.first);
+			cbor.text("last");
+			write_position(cbor, ship.zone.last);
+		}
+	}
+
+	// Body of /field: the whole field, or the shots at it since the client's revision
+	// & the ships they sank. The shots are [[row, col], ...] in V1 & a byte string
+	// of cell indices in V2. Keys are in the order `json::to_cbor()` writes them.
+	void write_field(CborWriter& cbor, const FieldUpdate& update, ProtocolVersion version) {
+		if (update.field.has_value()) {
+			cbor.map(3);
+			cbor.text("field");
+			std::visit([&](const auto& field) { write_player_field(cbor, field, version); }, *update.field);
+			cbor.text("revision");
+			cbor.integer(update.revision);
+		} else {
+			cbor.map(update.sunk.empty() ? 3 : 4);
+			cbor.text("revision");
+			cbor.integer(update.revision);
+			cbor.text("shots");
+			if (version == ProtocolVersion::V2) {
+				std::array<u8, GameEngines<GameKind>::MAX_CELLS> cells {};
+				std::visit([&]<typename Game>(Game /*kind*/) {
+					for (size_t i = 0; i < update.shots.size(); ++i) {
+						cells[i] = static_cast<u8>(Game::GameGrid::index(update.shots[i]));
+					}
+				}, update.kind);
+				cbor.bytes({cells.data(), update.shots.size()});
+			} else {
+				cbor.array(update.shots.size());
+				for (const Position& pos: update.shots) {
+					cbor.array(2);
+					cbor.integer(pos.row);
+					cbor.integer(pos.col);
+				}
+			}
+			if (!update.sunk.empty()) {
+				cbor.text("sunk");
+				cbor.array(update.sunk.size());
+				for (u8 ship: update.sunk) {
+					cbor.integer(ship);
+				}
 			}
+		}
+		cbor.text("version");
+		cbor.integer(static_cast<i64>(version));
+	}
 
-			Player& enemy = players[enemy_uuid_option.value()];
+	// Responds with the status of the player's game.
+	// If the player has to wait & `wait` is non-zero, the request is parked
+	// until the game changes or `wait` expires, so that the client doesn't have to poll.
+	template<class Send>
+	void send_status(
+		ServerState& state,
+		const UUID& uuid,
+		unsigned version,
+		bool keep_alive,
+		Send& send,
+		std::chrono::seconds wait
+	) {
+		GameStore::Watcher watcher;
+		if (wait.count() > 0) {
+			watcher = send.waker();
+		}
+		auto status_result = state.store.status(uuid, std::move(watcher));
+		if (is_err(status_result)) {
+			auto [http_status, message] = status_error(std::get<GameError>(status_result));
+			return send(make_cbor_response(http_status, version, keep_alive, pooled_cbor(json{message})));
+		}
+		const Status& status = std::get<Status>(status_result);
+		if (status.is_waiting() && wait.count() > 0) {
+			return send.park(wait, [&state, uuid, version, keep_alive, &send, wait](bool timed_out) {
+				send_status(
+					state, uuid, version, keep_alive, send,
+					timed_out ? std::chrono::seconds{0} : wait
+				);
+			});
+		}
 
-			std::vector<u8> shot_vec = req_body;
-			auto shot_pos = Position{shot_vec[0], shot_vec[1]};
-			if (enemy.grid.contains(shot_pos)) {
-				bool shot_result = enemy.grid.place_shot(shot_pos);
-				if (shot_result) {
-					room.move = uuid;
-				} else {
-					room.move = enemy_uuid;
+		if (status.state == Status::State::WaitingForEnemy) {
+			return send(make_cbor_response(http::status::locked, version, keep_alive, {}));
+		}
+		std::vector<u8> body = BufferPool::local().acquire();
+		CborWriter cbor {body};
+		write_status(cbor, status);
+		send(make_cbor_response(status_code(status), version, keep_alive, std::move(body)));
+	}
+
+	// Decoded requests, which route handlers receive
+
+	struct NoBody {};
+
+	struct StartRequest {
+		// ?rules=<name> of `GAME_KIND_NAMES`, the first kind by default
+		GameKind kind {};
+		// Nothing if the server places the ships (?auto), otherwise of the kind
+		std::optional<PlayerShips> ships;
+		ProtocolVersion version {ProtocolVersion::V1};
+		// ?bot[=easy|normal|hard] plays against a bot instead of waiting for a human
+		std::optional<BotLevel> bot;
+	};
+
+	struct ShootRequest {
+		UUID uuid;
+		Position shot;
+	};
+
+	struct StatusRequest {
+		UUID uuid;
+		// ?wait=<seconds> holds the request until something changes
+		std::chrono::seconds wait {0};
+	};
+
+	struct FieldRequest {
+		UUID uuid;
+		ProtocolVersion version;
+		// ?since=<revision> asks only for what has changed since it
+		std::optional<u32> since;
+	};
+
+	struct BatchRequest {
+		std::vector<BatchOp> ops;
+		// Of every operation, for the fields
+		std::vector<ProtocolVersion> versions;
+	};
+
+	struct WatchRequest {
+		// ?room=<id>, public id of the room
+		u64 room;
+	};
+
+	// Decoders of the requests, chosen by the type the handler takes
+
+	Result<NoBody, Rejection> decode(
+		std::type_identity<NoBody> /*type*/,
+		[[maybe_unused]] const Request& req,
+		[[maybe_unused]] std::string_view query
+	) {
+		return NoBody{};
+	}
+
+	Result<StartRequest, Rejection> decode(
+		std::type_identity<StartRequest> /*type*/,
+		const Request& req,
+		std::string_view query
+	) {
+		StartRequest start;
+		if (auto rules_param = query_param(query, "rules"); rules_param.has_value()) {
+			auto kind = game_kind(*rules_param);
+			if (!kind.has_value()) {
+				return Rejection{http::status::bad_request, "Unknown rules"};
+			}
+			start.kind = *kind;
+		}
+		if (auto bot_param = query_param(query, "bot"); bot_param.has_value()) {
+			start.bot = bot_param->empty() ? BotLevel::Normal : bot_level(*bot_param);
+			if (!start.bot.has_value()) {
+				return Rejection{http::status::bad_request, "Unknown bot level"};
+			}
+		}
+		// Ships are placed by the server, the body is optional
+		if (query_param(query, "auto").has_value()) {
+			if (!req.body().empty()) {
+				auto body = player_request_from_cbor(req.body());
+				if (!body.has_value()) {
+					return Rejection{http::status::bad_request, "Malformed request body"};
 				}
-				return send(cbor_response(
-					http::status::ok, json::to_cbor(json{shot_result})
-				));
+				start.version = body->version;
 			}
-		} else if ( (req.target() == "/field") && (req.method() == http::verb::get) ) {
-			json req_body = json::from_cbor(req.body());
-			UUIDVec uuid_vec {req_body.value("uuid", UUIDVec{})};
-			UUID uuid = uuid_from_span(UUIDSpan{uuid_vec});
+			return start;
+		}
+		auto version = std::visit([&]<typename Game>(Game /*kind*/) {
+			using Fleet = typename Game::Fleet;
+			return ships_from_cbor(req.body(), std::get<Fleet>(start.ships.emplace(std::in_place_type<Fleet>)));
+		}, start.kind);
+		if (!version.has_value()) {
+			return Rejection{http::status::bad_request, "Malformed ships"};
+		}
+		start.version = *version;
+		return start;
+	}
 
-			if (!players.contains(uuid)) {
-				return send(cbor_str_response(
-					http::status::unauthorized, "No player with such UUID"
-				));
+	// Body of /shoot, /status & /field, which has to name the player
+	Result<PlayerRequest, Rejection> decode_player(const Request& req) {
+		auto player_req = player_request_from_cbor(req.body());
+		if (!player_req.has_value()) {
+			return Rejection{http::status::bad_request, "Malformed request body"};
+		}
+		if (!player_req->uuid.has_value()) {
+			return Rejection{http::status::unauthorized, "No player with such UUID"};
+		}
+		return *player_req;
+	}
+
+	Result<ShootRequest, Rejection> decode(
+		std::type_identity<ShootRequest> /*type*/,
+		const Request& req,
+		[[maybe_unused]] std::string_view query
+	) {
+		auto player_req = decode_player(req);
+		if (is_err(player_req)) {
+			return std::get<Rejection>(player_req);
+		}
+		const auto& body = std::get<PlayerRequest>(player_req);
+		if (!body.shot.has_value()) {
+			return Rejection{http::status::bad_request, "Bad shot"};
+		}
+		return ShootRequest{*body.uuid, *body.shot};
+	}
+
+	Result<StatusRequest, Rejection> decode(
+		std::type_identity<StatusRequest> /*type*/,
+		const Request& req,
+		std::string_view query
+	) {
+		auto player_req = decode_player(req);
+		if (is_err(player_req)) {
+			return std::get<Rejection>(player_req);
+		}
+		StatusRequest status {*std::get<PlayerRequest>(player_req).uuid};
+		if (auto wait_param = query_param(query, "wait"); wait_param.has_value()) {
+			unsigned seconds = 0;
+			auto [end, error] = std::from_chars(wait_param->data(), wait_param->data() + wait_param->size(), seconds);
+			if (error != std::errc{} || end != wait_param->data() + wait_param->size()) {
+				return Rejection{http::status::bad_request, "Bad wait"};
 			}
+			status.wait = std::min(std::chrono::seconds{seconds}, MAX_STATUS_WAIT);
+		}
+		return status;
+	}
 
-			Player& me = players[uuid];
+	Result<FieldRequest, Rejection> decode(
+		std::type_identity<FieldRequest> /*type*/,
+		const Request& req,
+		std::string_view query
+	) {
+		auto player_req = decode_player(req);
+		if (is_err(player_req)) {
+			return std::get<Rejection>(player_req);
+		}
+		const auto& body = std::get<PlayerRequest>(player_req);
+		FieldRequest field {*body.uuid, body.version, {}};
+		if (auto since_param = query_param(query, "since"); since_param.has_value()) {
+			u32 since = 0;
+			auto [end, error] = std::from_chars(since_param->data(), since_param->data() + since_param->size(), since);
+			if (error != std::errc{} || end != since_param->data() + since_param->size()) {
+				return Rejection{http::status::bad_request, "Bad revision"};
+			}
+			field.since = since;
+		}
+		return field;
+	}
 
-			auto room = rooms[room_map[uuid]];
-			auto enemy_uuid_option = room.my_enemy(uuid);
-			if (!enemy_uuid_option.has_value()) {
-				return send(cbor_str_response(
-					http::status::internal_server_error,
-					"This UUID was mapped to the room, but this room doesn't contain this UUID"
-				));
+	Result<BatchRequest, Rejection> decode(
+		std::type_identity<BatchRequest> /*type*/,
+		const Request& req,
+		[[maybe_unused]] std::string_view query
+	) {
+		auto requests = batch_from_cbor(req.body());
+		if (!requests.has_value()) {
+			return Rejection{http::status::bad_request, "Malformed request body"};
+		}
+		if (requests->size() > MAX_BATCH_OPS) {
+			return Rejection{http::status::payload_too_large, "Too many operations"};
+		}
+		BatchRequest batch;
+		batch.ops.reserve(requests->size());
+		batch.versions.reserve(requests->size());
+		for (const PlayerRequest& request: *requests) {
+			if (!request.op.has_value()) {
+				return Rejection{http::status::bad_request, "Unknown operation"};
+			}
+			if (*request.op == BatchOp::Kind::Shoot && !request.shot.has_value()) {
+				return Rejection{http::status::bad_request, "Bad shot"};
+			}
+			// No UUID is an unknown player, as nobody gets the nil one
+			batch.ops.push_back({
+				*request.op, request.uuid.value_or(UUID{}), request.shot.value_or(Position{}), request.since
+			});
+			batch.versions.push_back(request.version);
+		}
+		return batch;
+	}
+
+	Result<WatchRequest, Rejection> decode(
+		std::type_identity<WatchRequest> /*type*/,
+		[[maybe_unused]] const Request& req,
+		std::string_view query
+	) {
+		auto room_param = query_param(query, "room");
+		WatchRequest watch {0};
+		if (!room_param.has_value()) {
+			return Rejection{http::status::bad_request, "Bad room"};
+		}
+		auto [end, error] = std::from_chars(room_param->data(), room_param->data() + room_param->size(), watch.room);
+		if (error != std::errc{} || end != room_param->data() + room_param->size()) {
+			return Rejection{http::status::bad_request, "Bad room"};
+		}
+		return watch;
+	}
+
+	// Request being handled & the ways to answer it
+	template<class Send>
+	struct Exchange {
+		ServerState& state;
+		const Request& req;
+		Send& send;
+
+		void reply(http::status status, std::vector<u8>&& data) const {
+			send(make_cbor_response(status, req.version(), req.keep_alive(), std::move(data)));
+		}
+
+		// Body is ["message"]
+		void reply_message(http::status status, std::string_view message) const {
+			reply(status, pooled_cbor(json{message}));
+		}
+
+		void reply_error(GameError error) const {
+			auto [status, message] = game_error(error);
+			reply_message(status, message);
+		}
+	};
+
+	// Start game: registers the player & returns their UUID & field
+	template<class Send>
+	void on_start(const Exchange<Send>& ex, StartRequest&& start) {
+		std::optional<Player> player;
+		if (start.ships.has_value()) {
+			// The ships are decoded for the kind of the request
+			player = std::visit([&]<typename Game>(Game /*kind*/) -> std::optional<Player> {
+				using Field = typename Game::Field;
+				auto field = Field::try_from_ships(std::get<typename Game::Fleet>(std::move(*start.ships)));
+				if (is_err(field)) {
+					return {};
+				}
+				return std::get<Field>(std::move(field));
+			}, start.kind);
+			if (!player.has_value()) {
+				return ex.reply_message(http::status::bad_request, "Bad ships layout");
+			}
+		} else {
+			player = random_player(start.kind);
+		}
+		UUID uuid = UuidGenerator::local()();
+		json response_body;
+		response_body["uuid"] = json::binary(vec_from_uuid(uuid));
+		response_body["version"] = start.version;
+		response_body["field"] = std::visit([&](const auto& field) { return field.serialize(start.version); }, *player);
+		ex.state.store.add_player(uuid, std::move(*player));
+		if (start.bot.has_value()) {
+			if (!ex.state.matchmaker.pair_with_bot(
+				uuid, UuidGenerator::local()(), random_player(start.kind),
+				make_bot(start.kind, *start.bot, random_seed())
+			)) {
+				ex.state.store.remove_player(uuid);
+				return ex.reply_message(http::status::service_unavailable, "Couldn't start a game with a bot");
 			}
-			if (!room.is_my_move(uuid)) {
-				return send(cbor_str_response(http::status::locked, "Wait for enemy's move"));
+		} else if (!ex.state.matchmaker.enqueue(uuid, start.kind)) {
+			ex.state.store.remove_player(uuid);
+			return ex.reply_message(http::status::service_unavailable, "Too many players are waiting");
+		}
+		BATTLESHIP_LOG(Debug, "player started",
+			log::kv("version", static_cast<int>(start.version)),
+			log::kv("rules", game_kind_name(start.kind)),
+			log::kv("bot", start.bot.has_value() ? bot_level_name(*start.bot) : "none")
+		);
+		ex.reply(http::status::ok, pooled_cbor(response_body));
+	}
+
+	template<class Send>
+	void on_shoot(const Exchange<Send>& ex, ShootRequest&& shoot) {
+		auto shot_result = ex.state.store.shoot(shoot.uuid, shoot.shot);
+		if (is_err(shot_result)) {
+			return ex.reply_error(std::get<GameError>(shot_result));
+		}
+		// [hit]
+		std::vector<u8> body = BufferPool::local().acquire();
+		CborWriter cbor {body};
+		cbor.array(1);
+		cbor.boolean(std::get<bool>(shot_result));
+		ex.reply(http::status::ok, std::move(body));
+	}
+
+	template<class Send>
+	void on_status(const Exchange<Send>& ex, StatusRequest&& status) {
+		send_status(ex.state, status.uuid, ex.req.version(), ex.req.keep_alive(), ex.send, status.wait);
+	}
+
+	template<class Send>
+	void on_field(const Exchange<Send>& ex, FieldRequest&& field) {
+		auto field_result = ex.state.store.field(field.uuid, field.since);
+		if (is_err(field_result)) {
+			return ex.reply_error(std::get<GameError>(field_result));
+		}
+		std::vector<u8> body = BufferPool::local().acquire();
+		CborWriter cbor {body};
+		write_field(cbor, std::get<FieldUpdate>(field_result), field.version);
+		ex.reply(http::status::ok, std::move(body));
+	}
+
+	// Runs the operations in one pass over the game state & returns [[code, body], ...],
+	// where code & body are the ones of the operation's own request (body is null if empty)
+	template<class Send>
+	void on_batch(const Exchange<Send>& ex, BatchRequest&& batch) {
+		auto results = ex.state.store.batch(batch.ops);
+		std::vector<u8> body = BufferPool::local().acquire();
+		CborWriter cbor {body};
+		cbor.array(results.size());
+		for (size_t i = 0; i < results.size(); ++i) {
+			cbor.array(2);
+			const BatchOp& op = batch.ops[i];
+			if (const auto* error = std::get_if<GameError>(&results[i])) {
+				auto [status, message] = (op.kind == BatchOp::Kind::Status) ? status_error(*error) : game_error(*error);
+				cbor.integer(static_cast<int>(status));
+				cbor.array(1);
+				cbor.text(message);
+			} else if (const auto* hit = std::get_if<bool>(&results[i])) {
+				cbor.integer(static_cast<int>(http::status::ok));
+				cbor.array(1);
+				cbor.boolean(*hit);
+			} else if (const auto* status = std::get_if<Status>(&results[i])) {
+				cbor.integer(static_cast<int>(status_code(*status)));
+				if (status->state == Status::State::WaitingForEnemy) {
+					cbor.null();
+				} else {
+					write_status(cbor, *status);
+				}
+			} else {
+				cbor.integer(static_cast<int>(http::status::ok));
+				write_field(cbor, std::get<FieldUpdate>(results[i]), batch.versions[i]);
 			}
+		}
+		ex.reply(http::status::ok, std::move(body));
+	}
 
-			json j;
-			j["field"] = me;
-			return send(cbor_response(http::status::ok, std::move(json::to_cbor(j))));
+	// Turns the connection into a stream of the room's updates, see `SpectatorHub`:
+	// the response is chunked, every chunk is a CBOR item, the stream ends with the game
+	template<class Send>
+	void on_watch(const Exchange<Send>& ex, WatchRequest&& watch) {
+		if (!ex.state.store.watch(watch.room, ex.send.spectate(ex.req.version(), ex.req.keep_alive()))) {
+			ex.reply_message(http::status::not_found, "No such room");
 		}
 	}
+
+	// Public ids of rooms where the game goes on, for spectators to choose from
+	template<class Send>
+	void on_rooms(const Exchange<Send>& ex, [[maybe_unused]] NoBody&& body) {
+		std::vector<u64> rooms = ex.state.store.live_rooms(MAX_LISTED_ROOMS);
+		std::vector<u8> out = BufferPool::local().acquire();
+		CborWriter cbor {out};
+		cbor.array(rooms.size());
+		for (u64 room: rooms) {
+			cbor.integer(static_cast<i64>(room));
+		}
+		ex.reply(http::status::ok, std::move(out));
+	}
+
+	// Telemetry in Prometheus text format
+	template<class Send>
+	void on_metrics(const Exchange<Send>& ex, [[maybe_unused]] NoBody&& body) {
+		ServerState& state = ex.state;
+		boost::container::static_vector<SampledMetric, 17> sampled {{
+			{"battleship_players", "gauge", "Registered players, including bots.",
+				static_cast<double>(state.store.player_count())},
+			{"battleship_rooms", "gauge", "Rooms, finished games included.",
+				static_cast<double>(state.store.room_count())},
+			{"battleship_matchmaking_queue_depth", "gauge", "Players waiting for an enemy.",
+				static_cast<double>(state.matchmaker.waiting())},
+			{"battleship_pairings_total", "counter", "Rooms formed by the matchmaker.",
+				static_cast<double>(state.matchmaker.pairings())},
+			{"battleship_bot_pairings_total", "counter", "Rooms formed with a bot.",
+				static_cast<double>(state.matchmaker.bot_pairings())},
+			{"battleship_expired_players_total", "counter", "Players forgotten after being idle.",
+				static_cast<double>(state.store.expired_players())},
+			{"battleship_forfeits_total", "counter", "Games lost by timeout.",
+				static_cast<double>(state.store.forfeits())},
+			{"battleship_spectators", "gauge", "Connections streaming a room.",
+				static_cast<double>(state.spectators.spectators())},
+			{"battleship_dropped_spectators_total", "counter", "Spectators cut off for falling behind or leaving.",
+				static_cast<double>(state.spectators.dropped())},
+		}};
+		if (const Persistence* persistence = state.persistence; persistence != nullptr) {
+			const Journal& journal = persistence->journal();
+			const std::array<SampledMetric, 6> saved {{
+				{"battleship_journal_records_total", "counter", "Game changes appended to the journal.",
+					static_cast<double>(journal.records())},
+				{"battleship_journal_bytes_total", "counter", "Bytes written to the journal.",
+					static_cast<double>(journal.bytes_written())},
+				{"battleship_journal_syncs_total", "counter", "Group commits of the journal.",
+					static_cast<double>(journal.syncs())},
+				{"battleship_snapshots_total", "counter", "Snapshots written since the start.",
+					static_cast<double>(persistence->snapshots())},
+				{"battleship_snapshot_duration_seconds", "gauge", "Time of the latest snapshot.",
+					std::chrono::duration<double>(persistence->last_snapshot()).count()},
+				{"battleship_recovery_duration_seconds", "gauge", "Time of loading the games at the start.",
+					std::chrono::duration<double>(persistence->recovery().duration).count()},
+			}};
+			sampled.insert(sampled.end(), saved.begin(), saved.end());
+		}
+		if (const GameArchive* archive = state.archive; archive != nullptr) {
+			const std::array<SampledMetric, 2> archived {{
+				{"battleship_archived_games_total", "counter", "Finished games written to the archive.",
+					static_cast<double>(archive->games())},
+				{"battleship_archive_bytes_total", "counter", "Bytes written to the archive.",
+					static_cast<double>(archive->bytes_written())},
+			}};
+			sampled.insert(sampled.end(), archived.begin(), archived.end());
+		}
+		TextResponse res {http::status::ok, ex.req.version()};
+		res.set(http::field::server, BOOST_BEAST_VERSION_STRING);
+		res.set(http::field::content_type, "text/plain; version=0.0.4");
+		res.keep_alive(ex.req.keep_alive());
+		res.body() = state.metrics.prometheus({sampled.data(), sampled.size()});
+		res.prepare_payload();
+		ex.send(std::move(res));
+	}
+
+	// Decodes the request & calls the handler with it,
+	// or answers with the reason why the request can't be decoded
+	template<class Send, typename Body, void (*HANDLER)(const Exchange<Send>&, Body&&)>
+	void dispatch(const Exchange<Send>& ex, std::string_view query) {
+		auto body = decode(std::type_identity<Body>{}, ex.req, query);
+		if (is_err(body)) {
+			const auto& [status, message] = std::get<Rejection>(body);
+			return ex.reply_message(status, message);
+		}
+		HANDLER(ex, std::get<Body>(std::move(body)));
+	}
+
+	template<class Send>
+	struct RouteEntry {
+		http::verb method;
+		std::string_view path;
+		// Also the label of the route in metrics
+		Route route;
+		void (*handle)(const Exchange<Send>&, std::string_view query);
+	};
+
+	template<class Send>
+	constexpr RouteTable ROUTES {std::array<RouteEntry<Send>, 8>{{
+		{http::verb::post,  "/start",   Route::Start,   &dispatch<Send, StartRequest, &on_start<Send>>},
+		{http::verb::patch, "/shoot",   Route::Shoot,   &dispatch<Send, ShootRequest, &on_shoot<Send>>},
+		{http::verb::get,   "/status",  Route::Status,  &dispatch<Send, StatusRequest, &on_status<Send>>},
+		{http::verb::get,   "/field",   Route::Field,   &dispatch<Send, FieldRequest, &on_field<Send>>},
+		{http::verb::post,  "/batch",   Route::Batch,   &dispatch<Send, BatchRequest, &on_batch<Send>>},
+		{http::verb::get,   "/watch",   Route::Watch,   &dispatch<Send, WatchRequest, &on_watch<Send>>},
+		{http::verb::get,   "/rooms",   Route::Rooms,   &dispatch<Send, NoBody, &on_rooms<Send>>},
+		{http::verb::get,   "/metrics", Route::Metrics, &dispatch<Send, NoBody, &on_metrics<Send>>},
+	}}};
+
+	// This function produces an HTTP response for the given
+	// request. The type of the response object depends on the
+	// contents of the request, so the interface requires the
+	// caller to pass a generic lambda for receiving the response.
+	template<class Send>
+	void handle_request(
+		ServerState& state,
+		Request&& req,
+		Send&& send
+	) {
+		using SendRef = std::remove_reference_t<Send>;
+		const Exchange<SendRef> ex {state, req, send};
+
+		// Request path must be absolute
+		if (req.target().empty() || req.target()[0] != '/') {
+			return ex.reply_message(http::status::bad_request, "Illegal request target");
+		}
+
+		auto [path, query] = split_target(req.target());
+		constexpr const auto& routes = ROUTES<SendRef>;
+		auto [outcome, entry] = routes.find(req.method(), path);
+		using Outcome = typename std::remove_cvref_t<decltype(routes)>::Outcome;
+		switch (outcome) {
+		case Outcome::Found:
+			send.route(
+				(entry->route == Route::Status && query_param(query, "wait").has_value())
+					? Route::StatusWait : entry->route
+			);
+			return entry->handle(ex, query);
+		case Outcome::MethodNotAllowed: {
+			CborResponse res = make_cbor_response(
+				http::status::method_not_allowed, req.version(), req.keep_alive(),
+				pooled_cbor(json{"Method not allowed"})
+			);
+			res.set(http::field::allow, routes.allowed(path));
+			return send(std::move(res));
+		}
+		case Outcome::NotFound:
+			break;
+		}
+		ex.reply_message(http::status::not_found, "Unknown request target");
+	}
 	
 	//------------------------------------------------------------------------------
 	
 	// Report a failure
 	void fail(beast::error_code ec, char const* what) {
 	    if (ec == net::ssl::error::stream_truncated) { return; }
-	    std::cerr << what << ": " << ec.message() << "\n";
+		BATTLESHIP_LOG(Warn, "io error", log::kv("op", what), log::kv("error", ec.message()));
 	}
 	
-	// Handles an HTTP server connection
-	class Session: public std::enable_shared_from_this<Session> {
+	// Plain HTTP is for deployments, where TLS is terminated by a proxy in front of the server
+	template<class Stream>
+	constexpr bool IS_TLS = !std::is_same_v<Stream, TcpStream>;
+
+	// Header of a spectator's stream, the frames follow as chunks
+	using StreamHeader = http::response<http::empty_body>;
+
+	// Handles an HTTP server connection over `TlsStream` or `TcpStream`.
+	// A spectator's session only streams the frames of its room until the game ends.
+	template<class Stream>
+	class Session: public std::enable_shared_from_this<Session<Stream>>, public Spectator {
 	    // This is the C++11 equivalent of a generic lambda.
 	    // The function object is used to send an HTTP message.
 	    struct SendLambda {
@@ -208,36 +885,140 @@ namespace battleship {
 			template<bool isRequest, class Body, class Fields>
 			void operator()(http::message<isRequest, Body, Fields>&& msg) const {
 			    // The lifetime of the message has to extend
-			    // for the duration of the async operation so
-			    // we use a shared_ptr to manage it.
-			    auto sp = std::make_shared<http::message<isRequest, Body, Fields>>(
-				std::move(msg));
-	
-			    // Store a type-erased version of the shared
-			    // pointer in the class to keep it alive.
-			    self_.res_ = sp;
+			    // for the duration of the async operation, so
+			    // the session keeps it in the slot for its type.
+			    auto& res = std::get<http::message<isRequest, Body, Fields>>(self_.res_);
+			    res = std::move(msg);
+
+				self_.state_.metrics.local().routes[static_cast<size_t>(self_.route_)].record(
+					std::chrono::steady_clock::now() - self_.request_start_
+				);
 	
 			    // Write the response
-			    http::async_write(self_.stream_, *sp, beast::bind_front_handler(
-					&Session::on_write,
+			    http::async_write(self_.stream_, res, pooled(beast::bind_front_handler(
+					&Session<Stream>::on_write,
 					self_.shared_from_this(),
-					sp->need_eof()
-				));
+					res.need_eof()
+				)));
+			}
+
+			// Labels the request in metrics
+			void route(Route route) const {
+				self_.route_ = route;
+			}
+
+			// Returns a one-shot function, which may be called from any thread
+			// to resume the request parked by the next call to `park()`
+			[[nodiscard]] std::function<void()> waker() const {
+				return [weak = self_.weak_from_this(), id = ++self_.park_id_] {
+					if (auto self = weak.lock()) {
+						net::post(self->stream_.get_executor(), [self, id] {
+							self->unpark(id, false);
+						});
+					}
+				};
+			}
+
+			// Leaves the request without a response for now:
+			// `resume(timed_out)` is called on the session's strand
+			// when the waker is called or when `timeout` expires
+			template<class Resume>
+			void park(std::chrono::steady_clock::duration timeout, Resume&& resume) const {
+				self_.resume_ = std::forward<Resume>(resume);
+				self_.park_timer_.expires_after(timeout);
+				self_.park_timer_.async_wait(pooled(beast::bind_front_handler(
+					&Session<Stream>::on_park_timeout,
+					self_.shared_from_this(),
+					self_.park_id_
+				)));
+			}
+
+			// Turns the session into a spectator: the response starts with the first
+			// frame pushed to it, & the session reads no more requests until it ends
+			[[nodiscard]] std::shared_ptr<Spectator> spectate(unsigned version, bool keep_alive) const {
+				StreamHeader& header = self_.stream_header_.emplace(http::status::ok, version);
+				header.set(http::field::server, BOOST_BEAST_VERSION_STRING);
+				header.set(http::field::content_type, "application/cbor-seq");
+				header.keep_alive(keep_alive);
+				header.chunked(true);
+				return self_.shared_from_this();
 			}
 	    };
 	
-		beast::ssl_stream<beast::tcp_stream> stream_;
+		Stream stream_;
 	    beast::flat_buffer buffer_;
-	    http::request<http::vector_body<u8>> req_;
-	    std::shared_ptr<void> res_;
+	    Request req_;
+	    // Reused by every response of its type
+	    std::tuple<CborResponse, TextResponse> res_;
 		SendLambda lambda_;
+		ServerState& state_;
+		// Parked request (e.g. long-polled /status)
+		Timer park_timer_;
+		// Deadline of the read or write in progress, `time_point::max()` if there's none.
+		// Beast's own timeouts arm a timer per operation & put its executor on the heap,
+		// this one only moves the deadline & its timer wakes up about once per TIMEOUT.
+		std::chrono::steady_clock::time_point deadline_ {std::chrono::steady_clock::time_point::max()};
+		Timer timeout_timer_;
+		bool is_timer_armed_ {false};
+		std::function<void(bool)> resume_;
+		u64 park_id_ {0};
+		// Spectator's stream: frames are queued by any thread & written by the session's strand
+		std::mutex frames_mutex_;
+		std::deque<Frame> frames_;
+		bool is_sending_ {false};
+		// The stream was cut, frames aren't taken anymore
+		bool is_cut_ {false};
+		// Frame being written, the write reads it in place
+		Frame sending_;
+		std::optional<StreamHeader> stream_header_;
+		std::optional<http::response_serializer<http::empty_body>> stream_serializer_;
+		// For metrics
+		std::chrono::steady_clock::time_point handshake_start_;
+		std::chrono::steady_clock::time_point request_start_;
+		Route route_ {Route::Other};
 	
 		static constexpr std::chrono::seconds TIMEOUT{30};
+		// Frames a spectator may lag behind before it's dropped
+		static constexpr size_t MAX_QUEUED_FRAMES = 64;
 	
 	public:
-		// Take ownership of the socket
-		explicit Session(tcp::socket&& socket, ssl::context& ctx)
-		 	: stream_{std::move(socket), ctx}, lambda_(*this) {}
+		using std::enable_shared_from_this<Session<Stream>>::shared_from_this;
+		using std::enable_shared_from_this<Session<Stream>>::weak_from_this;
+
+		// Take ownership of the stream
+		explicit Session(Stream&& stream, ServerState& state)
+		 	: stream_{std::move(stream)}, lambda_(*this), state_{state},
+			  park_timer_{stream_.get_executor()}, timeout_timer_{stream_.get_executor()}
+		{
+			state_.metrics.local().sessions_opened.add();
+		}
+
+		~Session() {
+			state_.metrics.local().sessions_closed.add();
+		}
+
+		Session(const Session&) = delete;
+		Session& operator=(const Session&) = delete;
+
+		bool push(const Frame& frame) override {
+			std::scoped_lock lock{frames_mutex_};
+			if (is_cut_) { return false; }
+			if (frames_.size() == MAX_QUEUED_FRAMES) {
+				is_cut_ = true;
+				net::post(stream_.get_executor(), beast::bind_front_handler(
+					&Session<Stream>::drop_spectator, shared_from_this()
+				));
+				return false;
+			}
+			frames_.push_back(frame);
+			if (!is_sending_) {
+				is_sending_ = true;
+				net::post(stream_.get_executor(), beast::bind_front_handler(
+					&Session<Stream>::send_frame, shared_from_this()
+				));
+			}
+			return true;
+		}
 	
 	    // Start the asynchronous operation
 	    void run() {
@@ -247,94 +1028,276 @@ namespace battleship {
 			// thread-safe by default.
 			net::dispatch(
 				stream_.get_executor(),
-				beast::bind_front_handler(&Session::on_run, shared_from_this())
+				beast::bind_front_handler(&Session<Stream>::on_run, shared_from_this())
 			);
 	    }
 	
 	    void on_run() {
-			// Set the timeout.
-			beast::get_lowest_layer(stream_).expires_after(TIMEOUT);
-	
-			// Perform the SSL handshake
-			stream_.async_handshake(
-			    ssl::stream_base::server,
-			    beast::bind_front_handler(&Session::on_handshake, shared_from_this())
-			);
+			if constexpr (!IS_TLS<Stream>) {
+				return do_read();
+			} else {
+				// Set the timeout.
+				expires_after(TIMEOUT);
+				handshake_start_ = std::chrono::steady_clock::now();
+
+				// Perform the SSL handshake
+				stream_.async_handshake(
+					ssl::stream_base::server,
+					beast::bind_front_handler(&Session<Stream>::on_handshake, shared_from_this())
+				);
+			}
 	    }
 	
 	    void on_handshake(beast::error_code ec) {
-			if (ec) { return fail(ec, "handshake"); }
+			expires_never();
+			if (ec) {
+				state_.metrics.local().handshake_failures.add();
+				return battleship::fail(ec, "handshake");
+			}
+			ThreadMetrics& metrics = state_.metrics.local();
+			metrics.handshake.record(std::chrono::steady_clock::now() - handshake_start_);
+			// By a session ticket or from the session cache
+			if (SSL_session_reused(stream_.native_handle()) == 1) {
+				metrics.handshakes_resumed.add();
+			}
 			do_read();
 	    }
 	
 	    void do_read() {
 			// Make the request empty before reading,
 			// otherwise the operation behavior is undefined.
+			// The body keeps its capacity for the next request.
+			std::vector<u8> body = std::move(req_.body());
+			body.clear();
 			req_ = {};
+			req_.body() = std::move(body);
 	
 			// Set the timeout.
-			beast::get_lowest_layer(stream_).expires_after(TIMEOUT);
+			expires_after(TIMEOUT);
 	
 			// Read a request
 			http::async_read(
 				stream_, buffer_, req_,
-				beast::bind_front_handler(&Session::on_read, shared_from_this())
+				pooled(beast::bind_front_handler(&Session<Stream>::on_read, shared_from_this()))
 			);
 	    }
 	
 		void on_read(beast::error_code ec, std::size_t bytes_transferred) {
-			boost::ignore_unused(bytes_transferred);
-	
+			expires_never();
+
 			// This means they closed the connection
 			if (ec == http::error::end_of_stream) { return do_close(); }
 	
 			if (ec) { return fail(ec, "read"); }
+
+			request_start_ = std::chrono::steady_clock::now();
+			state_.metrics.local().bytes_in.add(bytes_transferred);
+			route_ = Route::Other;
 	
 			// Send the response
-			handle_request(std::move(req_), lambda_);
+			unsigned version = req_.version();
+			bool keep_alive = req_.keep_alive();
+			try {
+				handle_request(state_, std::move(req_), lambda_);
+			} catch (const std::exception&) {
+				// json errors or containers overflowed by the body
+				lambda_(make_cbor_response(
+					http::status::bad_request, version, keep_alive,
+					pooled_cbor(json{"Malformed request body"})
+				));
+			}
 	    }
 	
+		void unpark(u64 id, bool timed_out) {
+			// Stale wake up or the request has already been resumed
+			if (id != park_id_ || !resume_) { return; }
+			park_timer_.cancel();
+			auto resume = std::move(resume_);
+			resume_ = nullptr;
+			resume(timed_out);
+		}
+
+		void on_park_timeout(u64 id, beast::error_code ec) {
+			if (ec == net::error::operation_aborted) { return; }
+			unpark(id, true);
+		}
+
+		// Writes the next frame of the spectator's stream, the header goes first.
+		// Frames are shared by all spectators of the room & written without a copy.
+		void send_frame() {
+			if (!stream_serializer_.has_value()) {
+				state_.metrics.local().routes[static_cast<size_t>(route_)].record(
+					std::chrono::steady_clock::now() - request_start_
+				);
+				expires_after(TIMEOUT);
+				http::async_write_header(stream_, stream_serializer_.emplace(*stream_header_), pooled(
+					beast::bind_front_handler(&Session<Stream>::on_frame_sent, shared_from_this())
+				));
+				return;
+			}
+			{
+				std::scoped_lock lock{frames_mutex_};
+				if (frames_.empty()) {
+					is_sending_ = false;
+					return;
+				}
+				sending_ = std::move(frames_.front());
+				frames_.pop_front();
+			}
+			expires_after(TIMEOUT);
+			// An empty frame ends the stream
+			if (sending_ == nullptr) {
+				net::async_write(stream_, http::make_chunk_last(), pooled(
+					beast::bind_front_handler(&Session<Stream>::on_stream_end, shared_from_this())
+				));
+				return;
+			}
+			net::async_write(stream_, http::make_chunk(net::buffer(*sending_)), pooled(
+				beast::bind_front_handler(&Session<Stream>::on_frame_sent, shared_from_this())
+			));
+		}
+
+		void on_frame_sent(beast::error_code ec, std::size_t bytes_transferred) {
+			expires_never();
+			if (ec) { return cut_stream(ec); }
+			state_.metrics.local().bytes_out.add(bytes_transferred);
+			sending_ = nullptr;
+			send_frame();
+		}
+
+		void on_stream_end(beast::error_code ec, std::size_t bytes_transferred) {
+			expires_never();
+			if (ec) { return cut_stream(ec); }
+			state_.metrics.local().bytes_out.add(bytes_transferred);
+			bool keep_alive = stream_header_->keep_alive();
+			stream_serializer_.reset();
+			stream_header_.reset();
+			{
+				std::scoped_lock lock{frames_mutex_};
+				is_sending_ = false;
+			}
+			if (!keep_alive) { return do_close(); }
+			do_read();
+		}
+
+		// The spectator fell too far behind: the pending write fails & the session ends
+		void drop_spectator() {
+			beast::error_code ec;
+			beast::get_lowest_layer(stream_).socket().close(ec);
+		}
+
+		void cut_stream(beast::error_code ec) {
+			bool was_cut = false;
+			{
+				std::scoped_lock lock{frames_mutex_};
+				was_cut = is_cut_;
+				is_cut_ = true;
+				frames_.clear();
+			}
+			// The hub forgets the spectator with the next frame of the room
+			if (!was_cut) {
+				fail(ec, "stream");
+			}
+		}
+
 	    void on_write(bool close, beast::error_code ec, std::size_t bytes_transferred) {
-			boost::ignore_unused(bytes_transferred);
-	
+			expires_never();
 			if (ec) { return fail(ec, "write"); }
+			state_.metrics.local().bytes_out.add(bytes_transferred);
 	
 			// This means we should close the connection, usually because
 			// the response indicated the "Connection: close" semantic.
 			if (close) { return do_close(); }
 	
-			// We're done with the response so delete it
-			res_ = nullptr;
+			// We're done with the response, its body goes back to the pool
+			BufferPool::local().release(std::move(std::get<CborResponse>(res_).body()));
 	
 			// Read another request
 			do_read();
 	    }
 	
 	    void do_close() {
-			// Set the timeout.
-			beast::get_lowest_layer(stream_).expires_after(TIMEOUT);
-	
-			// Perform the SSL shutdown
-			stream_.async_shutdown(
-			    beast::bind_front_handler(&Session::on_shutdown, shared_from_this()));
+			if constexpr (!IS_TLS<Stream>) {
+				// Send a TCP shutdown, the peer closes the connection
+				beast::error_code ec;
+				stream_.socket().shutdown(tcp::socket::shutdown_send, ec);
+			} else {
+				// Set the timeout.
+				expires_after(TIMEOUT);
+
+				// Perform the SSL shutdown
+				stream_.async_shutdown(
+					beast::bind_front_handler(&Session<Stream>::on_shutdown, shared_from_this()));
+			}
 	    }
 	
 	    void on_shutdown(beast::error_code ec) {
+			expires_never();
 			if (ec) { return fail(ec, "shutdown"); }
 			// At this point the connection is closed gracefully
 	    }
+
+		// The read or write started next times out after `timeout`, until it completes
+		void expires_after(std::chrono::steady_clock::duration timeout) {
+			deadline_ = std::chrono::steady_clock::now() + timeout;
+			if (!is_timer_armed_) {
+				wait_for_timeout(deadline_);
+			}
+		}
+
+		void expires_never() {
+			deadline_ = std::chrono::steady_clock::time_point::max();
+		}
+
+		void wait_for_timeout(std::chrono::steady_clock::time_point at) {
+			is_timer_armed_ = true;
+			timeout_timer_.expires_at(at);
+			// The timer doesn't keep the session alive
+			timeout_timer_.async_wait(pooled([weak = weak_from_this()](beast::error_code ec) {
+				if (auto self = weak.lock()) {
+					self->on_timeout(ec);
+				}
+			}));
+		}
+
+		void on_timeout(beast::error_code ec) {
+			is_timer_armed_ = false;
+			if (ec == net::error::operation_aborted) { return; }
+			// Nothing in progress, the next operation arms the timer again
+			if (deadline_ == std::chrono::steady_clock::time_point::max()) { return; }
+			if (std::chrono::steady_clock::now() < deadline_) {
+				return wait_for_timeout(deadline_);
+			}
+			// The operation in progress fails, as with Beast's timeout
+			beast::get_lowest_layer(stream_).close();
+		}
+
+		// Reports & counts the failure
+		void fail(beast::error_code ec, char const* what) {
+			if (ec != net::ssl::error::stream_truncated) {
+				state_.metrics.local().io_errors.add();
+			}
+			battleship::fail(ec, what);
+		}
 	};
 	
 	//------------------------------------------------------------------------------
 	
 	// Accepts incoming connections and launches the sessions
-	class Listener: public std::enable_shared_from_this<Listener> {
+	template<class Stream>
+	class Listener: public std::enable_shared_from_this<Listener<Stream>> {
 	    net::io_context& ioc_;
-	    ssl::context& ctx_;
+	    // Only for TLS
+	    ssl::context* ctx_;
+	    ServerState& state_;
 	    tcp::acceptor acceptor_;
 	public:
-	    Listener(net::io_context& ioc, ssl::context& ctx, const tcp::endpoint& endpoint)
-	    : ioc_{ioc}, ctx_{ctx}, acceptor_{ioc} {
+	    Listener(
+			net::io_context& ioc,
+			ssl::context* ctx,
+			ServerState& state,
+			const tcp::endpoint& endpoint
+		): ioc_{ioc}, ctx_{ctx}, state_{state}, acceptor_{ioc} {
 			beast::error_code ec;
 	
 			// Open the acceptor
@@ -370,85 +1333,315 @@ namespace battleship {
 	    void run() {
 			do_accept();
 	    }
+
+	    [[nodiscard]] tcp::endpoint local_endpoint() const {
+			beast::error_code ec;
+			return acceptor_.local_endpoint(ec);
+	    }
 	
 	private:
 	    void do_accept() {
 		// The new connection gets its own strand
 		acceptor_.async_accept(
 		    net::make_strand(ioc_),
-		    beast::bind_front_handler(&Listener::on_accept, shared_from_this()));
+		    beast::bind_front_handler(&Listener<Stream>::on_accept, this->shared_from_this()));
 	    }
 	
-	    void on_accept(beast::error_code ec, tcp::socket socket) {
+	    void on_accept(beast::error_code ec, TcpSocket socket) {
 			if (ec) {
 			    fail(ec, "accept");
 			} else {
 				// Create the session and run it
-				std::make_shared<Session>(std::move(socket), ctx_)->run();
+				if constexpr (IS_TLS<Stream>) {
+					std::make_shared<Session<Stream>>(Stream{std::move(socket), *ctx_}, state_)->run();
+				} else {
+					std::make_shared<Session<Stream>>(Stream{std::move(socket)}, state_)->run();
+				}
 			}
 			// Accept another connection
 			do_accept();
 	    }
 	};
 	
-	void load_server_certificate(
-		ssl::context& ctx,
-		const std::string& cert_path,
-		const std::string& chain_path,
-		const std::string& privkey_path,
-		const std::string& dh_path
-	) {
-		ctx.set_password_callback([](
-			[[maybe_unused]] std::size_t size,
-			[[maybe_unused]] ssl::context_base::password_purpose password_purpose
-		) {
-			return "test";
-		});
-		
-		ctx.set_options(
-		    boost::asio::ssl::context::default_workarounds |
-		    boost::asio::ssl::context::no_sslv2 |
-		    boost::asio::ssl::context::single_dh_use
-		);
-		
-		ctx.use_certificate_chain_file(chain_path);
-		ctx.use_certificate_file(cert_path, ssl::context::file_format::pem);
-		ctx.use_private_key_file(privkey_path, ssl::context::file_format::pem);
-		ctx.use_tmp_dh_file(dh_path);
+	// Turns the timer wheels of the game store, one timer for all players
+	class Expirer: public std::enable_shared_from_this<Expirer> {
+	    net::steady_timer timer_;
+	    GameStore& store_;
+	public:
+	    Expirer(net::io_context& ioc, GameStore& store): timer_{ioc}, store_{store} {}
+
+	    void run() {
+			do_wait();
+	    }
+
+	private:
+	    void do_wait() {
+			timer_.expires_after(GameStore::TICK);
+			timer_.async_wait(beast::bind_front_handler(&Expirer::on_tick, shared_from_this()));
+	    }
+
+	    void on_tick(beast::error_code ec) {
+			if (ec) { return fail(ec, "expire"); }
+			size_t expired = store_.expire(std::chrono::steady_clock::now());
+			if (expired > 0) {
+				BATTLESHIP_LOG(Debug, "timers fired", log::kv("count", expired));
+			}
+			do_wait();
+	    }
+	};
+
+	// Replaces the TLS session ticket keys every `TlsConfig::ticket_rotation`
+	class TicketRotator: public std::enable_shared_from_this<TicketRotator> {
+	    net::steady_timer timer_;
+	    TicketKeys& keys_;
+	    std::chrono::seconds period_;
+	public:
+	    TicketRotator(net::io_context& ioc, TicketKeys& keys, std::chrono::seconds period)
+			: timer_{ioc}, keys_{keys}, period_{period} {}
+
+	    void run() {
+			do_wait();
+	    }
+
+	private:
+	    void do_wait() {
+			timer_.expires_after(period_);
+			timer_.async_wait(beast::bind_front_handler(&TicketRotator::on_tick, shared_from_this()));
+	    }
+
+	    void on_tick(beast::error_code ec) {
+			if (ec) { return fail(ec, "ticket rotation"); }
+			keys_.rotate();
+			BATTLESHIP_LOG(Debug, "ticket keys rotated");
+			do_wait();
+	    }
+	};
+
+	// Gives bots to the players who have waited for a human too long
+	class BotFallback: public std::enable_shared_from_this<BotFallback> {
+	    net::steady_timer timer_;
+	    Matchmaker& matchmaker_;
+	public:
+	    BotFallback(net::io_context& ioc, Matchmaker& matchmaker): timer_{ioc}, matchmaker_{matchmaker} {}
+
+	    void run() {
+			do_wait();
+	    }
+
+	private:
+	    static constexpr std::chrono::seconds PERIOD {1};
+
+	    void do_wait() {
+			timer_.expires_after(PERIOD);
+			timer_.async_wait(beast::bind_front_handler(&BotFallback::on_tick, shared_from_this()));
+	    }
+
+	    void on_tick(beast::error_code ec) {
+			if (ec) { return fail(ec, "bot fallback"); }
+			size_t paired = matchmaker_.pair_stale_with_bots(std::chrono::steady_clock::now());
+			if (paired > 0) {
+				BATTLESHIP_LOG(Debug, "waiting players paired with bots", log::kv("count", paired));
+			}
+			do_wait();
+	    }
+	};
+
+	// Command line of the server
+	struct ServerOptions {
+		net::ip::address address;
+		u16 port {0};
+		// Also serve plain HTTP on this port, e.g. to a local proxy which terminates TLS
+		std::optional<u16> plain_port;
+		// Serve only plain HTTP on `port`, certificates aren't loaded
+		bool plain_only {false};
+		TlsConfig tls;
+		// Games are kept in memory only, unless a data directory is given
+		std::optional<PersistenceConfig> persistence;
+		// Finished games are archived only if an archive directory is given
+		std::optional<ArchiveConfig> archive;
+		// Players waiting for a human this long get a bot instead, never if it's zero
+		std::chrono::seconds bot_fallback {10};
+	};
+
+	void print_usage() {
+		std::cerr << "Usage: battleship-server <address> <port> [options]\n"
+			"    --plain-port PORT          also serve plain HTTP on PORT (for a TLS terminating proxy)\n"
+			"    --plain-only               serve plain HTTP instead of HTTPS on <port>\n"
+			"    --ticket-rotation SECONDS  lifetime of a TLS session ticket key (default 3600)\n"
+			"    --data-dir DIR             save games to DIR & recover them from it on start\n"
+			"    --snapshot-interval SEC    time between snapshots of the games in seconds (default 60)\n"
+			"    --flush-interval MS        time between syncs of the journal to the disk (default 10)\n"
+			"    --archive-dir DIR          write replays of finished games to DIR\n"
+			"    --bot-fallback SECONDS     pair a player with a bot after waiting that long (default 10, 0 = never)\n"
+			"Passphrase of tls/privkey.pem is read from BATTLESHIP_TLS_KEY_PASSWORD.\n"
+			"Example:\n"
+			"    battleship-server 0.0.0.0 8443 --plain-port 8080\n";
+	}
+
+	template<typename T>
+	bool parse_number(std::string_view str, T& value) {
+		auto [end, error] = std::from_chars(str.data(), str.data() + str.size(), value);
+		return error == std::errc{} && end == str.data() + str.size();
+	}
+
+	std::optional<ServerOptions> parse_options(std::span<char*> args) {
+		if (args.size() < 3) {
+			return {};
+		}
+		ServerOptions options;
+		beast::error_code ec;
+		options.address = net::ip::make_address(args[1], ec);
+		if (ec || !parse_number(std::string_view{args[2]}, options.port)) {
+			return {};
+		}
+		PersistenceConfig persistence;
+		bool has_data_dir = false;
+		for (size_t i = 3; i < args.size(); ++i) {
+			std::string_view arg = args[i];
+			if (arg == "--plain-only") {
+				options.plain_only = true;
+				continue;
+			}
+			if (i + 1 == args.size()) {
+				return {};
+			}
+			std::string_view value = args[++i];
+			if (arg == "--plain-port") {
+				if (!parse_number(value, options.plain_port.emplace())) { return {}; }
+			} else if (arg == "--ticket-rotation") {
+				u32 seconds = 0;
+				if (!parse_number(value, seconds) || seconds == 0) { return {}; }
+				options.tls.ticket_rotation = std::chrono::seconds{seconds};
+			} else if (arg == "--data-dir") {
+				if (value.empty()) { return {}; }
+				persistence.dir = value;
+				has_data_dir = true;
+			} else if (arg == "--archive-dir") {
+				if (value.empty()) { return {}; }
+				options.archive.emplace().dir = value;
+			} else if (arg == "--snapshot-interval") {
+				u32 seconds = 0;
+				if (!parse_number(value, seconds) || seconds == 0) { return {}; }
+				persistence.snapshot_interval = std::chrono::seconds{seconds};
+			} else if (arg == "--bot-fallback") {
+				u32 seconds = 0;
+				if (!parse_number(value, seconds)) { return {}; }
+				options.bot_fallback = std::chrono::seconds{seconds};
+			} else if (arg == "--flush-interval") {
+				u32 ms = 0;
+				if (!parse_number(value, ms) || ms == 0) { return {}; }
+				persistence.flush_interval = std::chrono::milliseconds{ms};
+			} else {
+				return {};
+			}
+		}
+		if (const char* password = std::getenv("BATTLESHIP_TLS_KEY_PASSWORD")) {
+			options.tls.key_password = password;
+		}
+		if (has_data_dir) {
+			options.persistence = std::move(persistence);
+		}
+		return options;
 	}
 	
 	//------------------------------------------------------------------------------
+
+	tcp::endpoint listen_plain(net::io_context& ioc, ServerState& state, const tcp::endpoint& endpoint) {
+		auto listener = std::make_shared<Listener<TcpStream>>(ioc, nullptr, state, endpoint);
+		listener->run();
+		return listener->local_endpoint();
+	}
 	
 	int server_main(int argc, char** argv) {
-	    const std::span<char*> args{ argv, static_cast<size_t>(argc) };
-	
-		const std::string CERT_PATH    = "tls/fullchain.pem";
-		const std::string CHAIN_PATH   = "tls/chain.pem";
-		const std::string PRIVKEY_PATH = "tls/privkey.pem";
-		const std::string DH_PATH      = "tls/dhparam.pem";
-	
-	    // Check command line arguments.
-	    if (args.size() != 3) {
-			std::cerr << "Usage: http-server-async-ssl <address> <port>"
-				"Example:\n"
-				"    http-server-async-ssl 0.0.0.0 8443\n";
+	    auto options = parse_options(std::span<char*>{argv, static_cast<size_t>(argc)});
+	    if (!options.has_value()) {
+			print_usage();
 			return EXIT_FAILURE;
 	    }
-	    const auto address  = net::ip::make_address(args[1]);
-	    const auto port     = static_cast<u16>(std::stoul(args[2]));
-	    const auto threads  = std::thread::hardware_concurrency();
-	
-	    // The io_context is required for all I/O
-	    net::io_context io_ctx { static_cast<int>(threads) };
+	    const auto threads = std::thread::hardware_concurrency();
 	
+	    // Ticket keys must outlive the SSL context, which refers to them
+	    TicketKeys ticket_keys;
 	    // The SSL context is required, and holds certificates
 	    ssl::context ctx{ ssl::context::tls_server };
+	    if (!options->plain_only) {
+			load_server_certificate(ctx, options->tls);
+			// Reconnecting clients skip the full handshake
+			enable_session_resumption(ctx, options->tls, ticket_keys);
+	    }
 	
-	    // This holds the self-signed certificate used by the server
-	    load_server_certificate(ctx, CERT_PATH, CHAIN_PATH, PRIVKEY_PATH, DH_PATH);
-	
-	    // Create and launch a listening port
-	    std::make_shared<Listener>(io_ctx, ctx, tcp::endpoint{ address, port })->run();
+	    // Logging from I/O threads must not wait for the console
+	    log::StreamSink console{std::clog};
+	    log::AsyncSink async_log{console};
+	    log::set_sink(&async_log);
+
+	    // Game state shared by all sessions
+	    ServerState state;
+	    state.store.set_spectators(&state.spectators);
+
+	    // Recover the games saved by the previous run & save them from now on
+	    std::optional<Persistence> persistence;
+	    if (options->persistence.has_value()) {
+			persistence.emplace(state.store, *options->persistence);
+			state.persistence = &*persistence;
+			const Recovery& recovery = persistence->recovery();
+			for (const auto& [uuid, kind]: recovery.waiting) {
+				state.matchmaker.enqueue(uuid, kind);
+			}
+			BATTLESHIP_LOG(Info, "games recovered",
+				log::kv("players", state.store.player_count()), log::kv("rooms", state.store.room_count()),
+				log::kv("snapshot_records", recovery.snapshot_records),
+				log::kv("journal_records", recovery.journal_records), log::kv("segments", recovery.segments),
+				log::kv("torn_bytes", recovery.torn_bytes), log::kv("us", recovery.duration.count())
+			);
+	    }
+
+	    // Keep replays of the games finished from now on
+	    std::optional<GameArchive> archive;
+	    if (options->archive.has_value()) {
+			archive.emplace(*options->archive);
+			state.store.set_archive(&*archive);
+			state.archive = &*archive;
+	    }
+
+	    // The io_context is required for all I/O. It's destroyed before the state, the archive
+	    // & the journal, so the sessions left in it don't outlive what they refer to.
+	    net::io_context io_ctx { static_cast<int>(threads) };
+
+	    // SIGINT & SIGTERM stop the server, then the archive & the journal are flushed
+	    // by their destructors
+	    net::signal_set signals {io_ctx, SIGINT, SIGTERM};
+	    signals.async_wait([&io_ctx](const beast::error_code& ec, int signal) {
+			if (!ec) {
+				BATTLESHIP_LOG(Info, "stopping", log::kv("signal", signal));
+			}
+			io_ctx.stop();
+	    });
+
+	    // Create and launch the listening ports
+	    const tcp::endpoint endpoint {options->address, options->port};
+	    if (options->plain_only) {
+			listen_plain(io_ctx, state, endpoint);
+	    } else {
+			std::make_shared<Listener<TlsStream>>(io_ctx, &ctx, state, endpoint)->run();
+			std::make_shared<TicketRotator>(io_ctx, ticket_keys, options->tls.ticket_rotation)->run();
+	    }
+	    if (options->plain_port.has_value()) {
+			listen_plain(io_ctx, state, {options->address, *options->plain_port});
+	    }
+
+	    // Expire idle players & stalled moves
+	    std::make_shared<Expirer>(io_ctx, state.store)->run();
+
+	    // Nobody waits for a human forever
+	    if (options->bot_fallback.count() > 0) {
+			state.matchmaker.set_bot_fallback(options->bot_fallback, [](const GameKind& kind) {
+				return Matchmaker::BotOpponent{
+					UuidGenerator::local()(), random_player(kind), make_bot(kind, BotLevel::Normal, random_seed())
+				};
+			});
+			std::make_shared<BotFallback>(io_ctx, state.matchmaker)->run();
+	    }
 	
 	    // Run the I/O service on the requested number of threads
 	    std::vector<std::thread> v;
@@ -456,10 +1649,17 @@ namespace battleship {
 	    for (unsigned i = 0; i < threads; ++i) {
 			v.emplace_back([&io_ctx] { io_ctx.run(); });
 		}
+		BATTLESHIP_LOG(Info, "listening",
+			log::kv("address", options->address.to_string()), log::kv("port", options->port),
+			log::kv("tls", !options->plain_only), log::kv("plain_port", options->plain_port.value_or(0)),
+			log::kv("threads", threads)
+		);
 	    io_ctx.run();
-	
-		std::cout << "Running on " << address << ":" << port << "\n";
-	
+	    for (std::thread& thread: v) {
+			thread.join();
+	    }
+
+	    log::set_sink(nullptr);
 	    return EXIT_SUCCESS;
 	}
 } // namespace battleship
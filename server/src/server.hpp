@@ -1,8 +1,18 @@
 #ifndef BATTLESHIP_SERVER_SERVER_HPP
 #define BATTLESHIP_SERVER_SERVER_HPP
 
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include "server_state.hpp"
+
 namespace battleship {
 	int server_main(int argc, char** argv);
+
+	// Serves plain HTTP sessions on `endpoint` from `ioc`, as `--plain-port` does.
+	// Returns the bound endpoint, e.g. the port picked for port 0.
+	boost::asio::ip::tcp::endpoint listen_plain(
+		boost::asio::io_context& ioc, ServerState& state, const boost::asio::ip::tcp::endpoint& endpoint
+	);
 }
 
 #endif // BATTLESHIP_SERVER_SERVER_HPP
@@ -0,0 +1,26 @@
+#ifndef BATTLESHIP_SERVER_SERVER_STATE_HPP
+#define BATTLESHIP_SERVER_SERVER_STATE_HPP
+
+#include "archive.hpp"
+#include "game_store.hpp"
+#include "matchmaker.hpp"
+#include "metrics.hpp"
+#include "persistence.hpp"
+#include "spectators.hpp"
+
+namespace battleship {
+	// Everything shared by all sessions, lives as long as the server
+	struct ServerState {
+		GameStore store;
+		Matchmaker matchmaker {store};
+		Metrics metrics;
+		// Streams of the watched rooms, the store publishes to them
+		SpectatorHub spectators;
+		// Saves the games to disk, if enabled
+		const Persistence* persistence {nullptr};
+		// Archives finished games, if enabled
+		const GameArchive* archive {nullptr};
+	};
+} // namespace battleship
+
+#endif // BATTLESHIP_SERVER_SERVER_STATE_HPP
@@ -0,0 +1,90 @@
+#include "cbor_writer.hpp"
+#include "spectators.hpp"
+
+namespace battleship {
+	SpectatorHub::SpectatorHub(): shards_{std::make_unique<Shard[]>(SHARD_COUNT)} {} // NOLINT
+
+	bool SpectatorHub::is_watched(u64 room) const {
+		if (spectators() == 0) { return false; }
+		Shard& s = shard(room);
+		std::scoped_lock lock{s.mutex};
+		return s.rooms.contains(room);
+	}
+
+	void SpectatorHub::subscribe(u64 room, std::shared_ptr<Spectator> spectator, const Frame& state) {
+		if (!spectator->push(state)) {
+			dropped_.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		Shard& s = shard(room);
+		std::scoped_lock lock{s.mutex};
+		s.rooms[room].push_back(std::move(spectator));
+		spectators_.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void SpectatorHub::publish(u64 room, const Frame& frame) {
+		Shard& s = shard(room);
+		std::scoped_lock lock{s.mutex};
+		auto watched = s.rooms.find(room);
+		if (watched == s.rooms.end()) { return; }
+		auto& spectators = watched->second;
+		// Order of the spectators doesn't matter, the dropped ones are swapped with the last
+		for (size_t i = 0; i < spectators.size();) {
+			if (spectators[i]->push(frame)) {
+				++i;
+				continue;
+			}
+			spectators[i] = std::move(spectators.back());
+			spectators.pop_back();
+			spectators_.fetch_sub(1, std::memory_order_relaxed);
+			dropped_.fetch_add(1, std::memory_order_relaxed);
+		}
+		if (spectators.empty()) {
+			s.rooms.erase(watched);
+		}
+	}
+
+	void SpectatorHub::close(u64 room) {
+		Shard& s = shard(room);
+		std::scoped_lock lock{s.mutex};
+		auto watched = s.rooms.extract(room);
+		if (watched.empty()) { return; }
+		for (const auto& spectator: watched.mapped()) {
+			if (!spectator->push(nullptr)) {
+				dropped_.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+		spectators_.fetch_sub(watched.mapped().size(), std::memory_order_relaxed);
+	}
+
+	Frame SpectatorHub::encode(const RoomView& view) {
+		auto frame = std::make_shared<std::vector<u8>>();
+		frame->reserve(16 + 5 * view.shots.size());
+		CborWriter cbor {*frame};
+		cbor.map((view.winner.has_value() ? size_t{5} : size_t{3}) + (view.rules.has_value() ? size_t{1} : size_t{0}));
+		cbor.text("room");
+		cbor.integer(static_cast<i64>(view.room));
+		cbor.text("shots");
+		cbor.array(view.shots.size());
+		for (const SpectatorShot& shot: view.shots) {
+			cbor.array(4);
+			cbor.integer(shot.field);
+			cbor.integer(shot.pos.row);
+			cbor.integer(shot.pos.col);
+			cbor.integer(static_cast<u8>(shot.result));
+		}
+		cbor.text("move");
+		cbor.integer(view.move);
+		if (view.winner.has_value()) {
+			cbor.text("winner");
+			cbor.integer(*view.winner);
+			cbor.text("forfeit");
+			cbor.boolean(view.is_forfeit);
+		}
+		if (view.rules.has_value()) {
+			cbor.text("rules");
+			cbor.text(*view.rules);
+		}
+		return frame;
+	}
+} // namespace battleship
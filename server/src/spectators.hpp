@@ -0,0 +1,111 @@
+#ifndef BATTLESHIP_SERVER_SPECTATORS_HPP
+#define BATTLESHIP_SERVER_SPECTATORS_HPP
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "game.hpp"
+
+namespace battleship {
+	// Encoded update of a room, shared by all of its spectators & never changed once encoded
+	using Frame = std::shared_ptr<const std::vector<u8>>;
+
+	// Connection which streams the updates of a room, i.e. a session of the server
+	class Spectator {
+	public:
+		virtual ~Spectator() = default;
+
+		// Queues the frame to be sent, an empty frame ends the stream.
+		// Called under the locks of the room, so it must not block.
+		// Returns false if the spectator can't keep up or is gone, then it's dropped.
+		virtual bool push(const Frame& frame) = 0;
+	};
+
+	// Shot as spectators see it: where it landed, but not the ships around it
+	struct SpectatorShot {
+		enum class Result : u8 {
+			Miss,
+			Hit,
+			Sunk
+		};
+
+		// Player whose field was shot, 0 for the first one of the room
+		u8 field;
+		Position pos;
+		Result result;
+	};
+
+	// Public state of a room, or its change since the previous update
+	struct RoomView {
+		u64 room;
+		// Shots since the previous update, or all of them in the first one
+		std::vector<SpectatorShot> shots;
+		// Player who has the move, 0 for the first one of the room
+		u8 move;
+		std::optional<u8> winner;
+		// The loser ran out of time
+		bool is_forfeit;
+		// Name of the kind of game, only in the first update a spectator gets
+		std::optional<std::string_view> rules {};
+	};
+
+	// Spectators of the rooms, by public ids of the rooms.
+	// Every update of a room is encoded once into an immutable buffer, which all of its
+	// spectators send as is, so a room watched by thousands costs one encoding per update.
+	// A spectator which falls behind is dropped instead of being buffered without bound.
+	// Rooms are spread over shards by id, like players in the game store.
+	class SpectatorHub {
+	public:
+		SpectatorHub();
+
+		// The room has spectators, checked before encoding its updates.
+		// A single relaxed load while nobody watches anything.
+		[[nodiscard]] bool is_watched(u64 room) const;
+
+		// Sends the state of the room to the spectator & subscribes it to the updates.
+		// The caller holds the locks of the room, so no update is missed or sent twice.
+		void subscribe(u64 room, std::shared_ptr<Spectator> spectator, const Frame& state);
+
+		// Hands the update to every spectator of the room, under the locks of the room,
+		// so spectators get the updates in the order of the game store
+		void publish(u64 room, const Frame& frame);
+
+		// Ends the streams of the room's spectators & forgets them
+		void close(u64 room);
+
+		// CBOR of the view: {"room": id, "shots": [[field, row, col, result], ...], "move": N}
+		// with "winner": N & "forfeit": bool once the game is over & "rules": name in the first one
+		[[nodiscard]] static Frame encode(const RoomView& view);
+
+		[[nodiscard]] inline size_t spectators() const {
+			return spectators_.load(std::memory_order_relaxed);
+		}
+
+		// Spectators which couldn't keep up or left before the end of the game
+		[[nodiscard]] inline u64 dropped() const {
+			return dropped_.load(std::memory_order_relaxed);
+		}
+
+	private:
+		static constexpr size_t SHARD_COUNT = 64;
+
+		struct alignas(64) Shard {
+			mutable std::mutex mutex;
+			std::unordered_map<u64, std::vector<std::shared_ptr<Spectator>>> rooms;
+		};
+
+		std::unique_ptr<Shard[]> shards_; // NOLINT
+		std::atomic<size_t> spectators_ {0};
+		std::atomic<u64> dropped_ {0};
+
+		[[nodiscard]] inline Shard& shard(u64 room) const {
+			return shards_[room % SHARD_COUNT];
+		}
+	};
+} // namespace battleship
+
+#endif // BATTLESHIP_SERVER_SPECTATORS_HPP
@@ -0,0 +1,215 @@
+#ifndef BATTLESHIP_SERVER_TIMER_WHEEL_HPP
+#define BATTLESHIP_SERVER_TIMER_WHEEL_HPP
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <vector>
+#include "battleship/common/util/num_types.hpp"
+
+namespace battleship {
+	// Refers to a timer of a `TimerWheel`, stays safe to use after the timer
+	// has fired or has been cancelled: the slot's generation won't match anymore
+	struct TimerHandle {
+		static constexpr u32 NONE = std::numeric_limits<u32>::max();
+
+		u32 index {NONE};
+		u32 generation {0};
+	};
+
+	// Hierarchical timer wheel (as in the Linux kernel) counting abstract ticks.
+	// Level `l` has SLOTS slots, each covering SLOTS^l ticks. A timer is put
+	// into the finest level which reaches its expiry & moves down a level
+	// whenever the wheel turns past its slot, so schedule & cancel are O(1)
+	// and every tick touches one slot of level 0 (plus a cascade once per SLOTS ticks).
+	// Timers are nodes of intrusive lists in one vector, freed nodes are reused.
+	// Not thread safe.
+	template<typename T>
+	class TimerWheel {
+	public:
+		static constexpr size_t SLOT_BITS = 6;
+		static constexpr size_t SLOTS = 1 << SLOT_BITS;
+		static constexpr size_t LEVELS = 4;
+		// Longer delays are cut to this one
+		static constexpr u64 MAX_DELAY = (u64{1} << (SLOT_BITS * LEVELS)) - 1;
+
+		TimerWheel() {
+			slots_.fill(NIL);
+		}
+
+		[[nodiscard]] inline u64 now() const {
+			return now_;
+		}
+
+		// Timers which haven't fired yet
+		[[nodiscard]] inline size_t size() const {
+			return size_;
+		}
+
+		// Timer which fires after `delay` ticks (at least one)
+		TimerHandle schedule(u64 delay, T value) {
+			u32 i = allocate();
+			Node& node = nodes_[i];
+			node.value = std::move(value);
+			node.expiry = deadline(delay);
+			link(i);
+			++size_;
+			return {i, node.generation};
+		}
+
+		// Returns false if the timer has already fired or has been cancelled
+		bool cancel(TimerHandle handle) {
+			if (!pending(handle)) {
+				return false;
+			}
+			unlink(handle.index);
+			release(handle.index);
+			--size_;
+			return true;
+		}
+
+		// Moves the timer to fire after `delay` ticks from now.
+		// Returns false if the timer has already fired or has been cancelled.
+		bool reschedule(TimerHandle handle, u64 delay) {
+			if (!pending(handle)) {
+				return false;
+			}
+			unlink(handle.index);
+			nodes_[handle.index].expiry = deadline(delay);
+			link(handle.index);
+			return true;
+		}
+
+		[[nodiscard]] bool pending(TimerHandle handle) const {
+			return handle.index < nodes_.size()
+				&& nodes_[handle.index].generation == handle.generation
+				&& nodes_[handle.index].linked;
+		}
+
+		// Turns the wheel up to `tick`, appending values of the fired timers to `expired`
+		void advance(u64 tick, std::vector<T>& expired) {
+			while (now_ < tick) {
+				if (size_ == 0) {
+					now_ = tick;
+					return;
+				}
+				++now_;
+				cascade();
+				fire(expired);
+			}
+		}
+
+	private:
+		static constexpr u32 NIL = TimerHandle::NONE;
+		static constexpr u64 SLOT_MASK = SLOTS - 1;
+
+		struct Node {
+			T value {};
+			u64 expiry {0};
+			u32 prev {NIL};
+			// The next free node while the node is free
+			u32 next {NIL};
+			u32 generation {0};
+			// Index into `slots_` of the list holding the node
+			u16 slot {0};
+			bool linked {false};
+		};
+
+		std::vector<Node> nodes_;
+		u32 free_ {NIL};
+		// Heads of the lists, level by level
+		std::array<u32, SLOTS * LEVELS> slots_ {};
+		u64 now_ {0};
+		size_t size_ {0};
+
+		[[nodiscard]] inline u64 deadline(u64 delay) const {
+			return now_ + std::clamp<u64>(delay, 1, MAX_DELAY);
+		}
+
+		u32 allocate() {
+			if (free_ == NIL) {
+				nodes_.emplace_back();
+				return static_cast<u32>(nodes_.size() - 1);
+			}
+			u32 i = free_;
+			free_ = nodes_[i].next;
+			return i;
+		}
+
+		void release(u32 i) {
+			Node& node = nodes_[i];
+			node.value = T{};
+			++node.generation;
+			node.next = free_;
+			free_ = i;
+		}
+
+		void link(u32 i) {
+			Node& node = nodes_[i];
+			u64 delta = node.expiry - now_;
+			size_t level = 0;
+			while (level + 1 < LEVELS && delta >= (u64{1} << (SLOT_BITS * (level + 1)))) {
+				++level;
+			}
+			node.slot = static_cast<u16>(level * SLOTS + ((node.expiry >> (SLOT_BITS * level)) & SLOT_MASK));
+			u32& head = slots_[node.slot];
+			node.prev = NIL;
+			node.next = head;
+			if (head != NIL) {
+				nodes_[head].prev = i;
+			}
+			head = i;
+			node.linked = true;
+		}
+
+		void unlink(u32 i) {
+			Node& node = nodes_[i];
+			if (node.prev != NIL) {
+				nodes_[node.prev].next = node.next;
+			} else {
+				slots_[node.slot] = node.next;
+			}
+			if (node.next != NIL) {
+				nodes_[node.next].prev = node.prev;
+			}
+			node.linked = false;
+		}
+
+		// Takes the whole list out of the slot
+		u32 take(size_t level, size_t slot) {
+			u32 head = slots_[level * SLOTS + slot];
+			slots_[level * SLOTS + slot] = NIL;
+			return head;
+		}
+
+		// When the lower level has made a full turn, the current slot
+		// of the upper one is spread over the lower levels
+		void cascade() {
+			for (size_t level = 1; level < LEVELS; ++level) {
+				if ((now_ & ((u64{1} << (SLOT_BITS * level)) - 1)) != 0) {
+					break;
+				}
+				u32 i = take(level, (now_ >> (SLOT_BITS * level)) & SLOT_MASK);
+				while (i != NIL) {
+					u32 next = nodes_[i].next;
+					link(i);
+					i = next;
+				}
+			}
+		}
+
+		void fire(std::vector<T>& expired) {
+			u32 i = take(0, now_ & SLOT_MASK);
+			while (i != NIL) {
+				u32 next = nodes_[i].next;
+				nodes_[i].linked = false;
+				expired.push_back(std::move(nodes_[i].value));
+				release(i);
+				--size_;
+				i = next;
+			}
+		}
+	};
+} // namespace battleship
+
+#endif // BATTLESHIP_SERVER_TIMER_WHEEL_HPP
@@ -0,0 +1,150 @@
+#include <algorithm>
+#include <mutex>
+#include <stdexcept>
+#include <string_view>
+#include <openssl/core_names.h>
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#include <openssl/ssl.h>
+#include "tls.hpp"
+
+namespace battleship {
+	namespace {
+		// Distinguishes sessions of this server in the cache
+		constexpr std::string_view SESSION_ID_CONTEXT = "battleship";
+
+		void cleanse(auto& bytes) {
+			OPENSSL_cleanse(bytes.data(), bytes.size());
+		}
+
+		// Slot of the context's ex data which holds its `TicketKeys`.
+		// The app data slot is taken by Boost.Asio, which deletes whatever is there
+		// as its verify callback when the context is destroyed.
+		int ticket_keys_index() {
+			static const int INDEX = SSL_CTX_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+			return INDEX;
+		}
+	} // namespace
+
+	TicketKeys::TicketKeys(): current_{generate()} {}
+
+	TicketKeys::~TicketKeys() {
+		cleanse(current_.aes);
+		cleanse(current_.hmac);
+		if (previous_.has_value()) {
+			cleanse(previous_->aes);
+			cleanse(previous_->hmac);
+		}
+	}
+
+	TicketKeys::Key TicketKeys::generate() {
+		Key key {};
+		if (RAND_bytes(key.name.data(), static_cast<int>(key.name.size())) != 1
+		 || RAND_bytes(key.aes.data(), static_cast<int>(key.aes.size())) != 1
+		 || RAND_bytes(key.hmac.data(), static_cast<int>(key.hmac.size())) != 1) {
+			throw std::runtime_error("RAND_bytes() failed to generate a ticket key");
+		}
+		return key;
+	}
+
+	void TicketKeys::rotate() {
+		Key key = generate();
+		std::scoped_lock lock{mutex_};
+		if (previous_.has_value()) {
+			cleanse(previous_->aes);
+			cleanse(previous_->hmac);
+		}
+		previous_ = current_;
+		current_ = key;
+		cleanse(key.aes);
+		cleanse(key.hmac);
+	}
+
+	void TicketKeys::attach(ssl::context& ctx) {
+		if (ticket_keys_index() < 0 || SSL_CTX_set_ex_data(ctx.native_handle(), ticket_keys_index(), this) != 1) {
+			throw std::runtime_error("SSL_CTX_set_ex_data() failed to attach ticket keys");
+		}
+		SSL_CTX_set_tlsext_ticket_key_evp_cb(ctx.native_handle(), &TicketKeys::on_ticket);
+	}
+
+	// Called by OpenSSL during handshakes, from any I/O thread.
+	// Returns 1 if the ticket is fine, 2 if it's fine but has to be renewed,
+	// 0 if the ticket is unknown (full handshake) & -1 on errors.
+	int TicketKeys::on_ticket(
+		SSL* ssl,
+		unsigned char* name,
+		unsigned char* iv,
+		EVP_CIPHER_CTX* cipher,
+		EVP_MAC_CTX* mac,
+		int encrypt
+	) {
+		auto* keys = static_cast<TicketKeys*>(SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), ticket_keys_index()));
+		if (keys == nullptr) {
+			return -1;
+		}
+		std::shared_lock lock{keys->mutex_};
+		Key* key = nullptr;
+		int result = 1;
+		if (encrypt == 1) {
+			key = &keys->current_;
+			if (RAND_bytes(iv, EVP_CIPHER_get_iv_length(EVP_aes_256_cbc())) != 1) {
+				return -1;
+			}
+			std::copy(key->name.begin(), key->name.end(), name);
+		} else if (std::equal(keys->current_.name.begin(), keys->current_.name.end(), name)) {
+			key = &keys->current_;
+		} else if (keys->previous_.has_value()
+		 && std::equal(keys->previous_->name.begin(), keys->previous_->name.end(), name)) {
+			key = &*keys->previous_;
+			result = 2;
+		} else {
+			return 0;
+		}
+
+		std::array<OSSL_PARAM, 3> params {
+			OSSL_PARAM_construct_octet_string(OSSL_MAC_PARAM_KEY, key->hmac.data(), key->hmac.size()),
+			OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, const_cast<char*>("SHA256"), 0),
+			OSSL_PARAM_construct_end()
+		};
+		if (EVP_MAC_CTX_set_params(mac, params.data()) != 1
+		 || EVP_CipherInit_ex(cipher, EVP_aes_256_cbc(), nullptr, key->aes.data(), iv, encrypt) != 1) {
+			return -1;
+		}
+		return result;
+	}
+
+	void load_server_certificate(ssl::context& ctx, const TlsConfig& config) {
+		ctx.set_password_callback([password = config.key_password](
+			[[maybe_unused]] std::size_t size,
+			[[maybe_unused]] ssl::context_base::password_purpose password_purpose
+		) {
+			return password;
+		});
+
+		ctx.set_options(
+			ssl::context::default_workarounds |
+			ssl::context::no_sslv2 |
+			ssl::context::single_dh_use
+		);
+
+		ctx.use_certificate_chain_file(config.chain_path);
+		ctx.use_certificate_file(config.cert_path, ssl::context::file_format::pem);
+		ctx.use_private_key_file(config.privkey_path, ssl::context::file_format::pem);
+		ctx.use_tmp_dh_file(config.dh_path);
+	}
+
+	void enable_session_resumption(ssl::context& ctx, const TlsConfig& config, TicketKeys& keys) {
+		SSL_CTX* native = ctx.native_handle();
+		SSL_CTX_set_session_cache_mode(native, SSL_SESS_CACHE_SERVER);
+		SSL_CTX_sess_set_cache_size(native, config.session_cache_size);
+		SSL_CTX_set_session_id_context(
+			native,
+			reinterpret_cast<const unsigned char*>(SESSION_ID_CONTEXT.data()),
+			static_cast<unsigned>(SESSION_ID_CONTEXT.size())
+		);
+		// Neither cached sessions nor tickets outlive the previous ticket key
+		SSL_CTX_set_timeout(native, 2 * config.ticket_rotation.count());
+		keys.attach(ctx);
+	}
+} // namespace battleship
@@ -0,0 +1,76 @@
+#ifndef BATTLESHIP_SERVER_TLS_HPP
+#define BATTLESHIP_SERVER_TLS_HPP
+
+#include <array>
+#include <chrono>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <boost/asio/ssl/context.hpp>
+#include "battleship/common/util/num_types.hpp"
+
+namespace battleship {
+	namespace ssl = boost::asio::ssl;
+
+	// Certificate of the server & how TLS sessions are resumed
+	struct TlsConfig {
+		std::string cert_path {"tls/fullchain.pem"};
+		std::string chain_path {"tls/chain.pem"};
+		std::string privkey_path {"tls/privkey.pem"};
+		std::string dh_path {"tls/dhparam.pem"};
+		// Passphrase of the private key, empty if it isn't encrypted
+		std::string key_password;
+		// Sessions remembered by the server for resumption by session ID (TLS 1.2)
+		long session_cache_size {20480};
+		// Ticket keys are replaced this often. Tickets of the previous key are still
+		// accepted & renewed, so a session may be resumed for up to twice as long.
+		std::chrono::seconds ticket_rotation {std::chrono::hours{1}};
+	};
+
+	// Keys of TLS session tickets, so that a reconnecting client resumes its session
+	// instead of paying for a full handshake. The current key encrypts new tickets,
+	// the previous one only decrypts tickets issued before the last rotation.
+	// Keys are random & never leave the process, so a restart invalidates all tickets.
+	class TicketKeys {
+	public:
+		TicketKeys();
+		TicketKeys(const TicketKeys&) = delete;
+		TicketKeys& operator=(const TicketKeys&) = delete;
+		~TicketKeys();
+
+		// Makes the current key the previous one & generates a new one, thread safe
+		void rotate();
+
+		// Makes the context issue & accept tickets of these keys, they must outlive it
+		void attach(ssl::context& ctx);
+
+	private:
+		// Name of the key is sent in the ticket, so that the server knows how to decrypt it
+		struct Key {
+			std::array<u8, 16> name;
+			std::array<u8, 32> aes;
+			std::array<u8, 32> hmac;
+		};
+
+		mutable std::shared_mutex mutex_;
+		Key current_;
+		std::optional<Key> previous_;
+
+		static Key generate();
+		static int on_ticket(
+			SSL* ssl,
+			unsigned char* name,
+			unsigned char* iv,
+			EVP_CIPHER_CTX* cipher,
+			EVP_MAC_CTX* mac,
+			int encrypt
+		);
+	};
+
+	void load_server_certificate(ssl::context& ctx, const TlsConfig& config);
+
+	// Enables the session cache & session tickets of `keys`
+	void enable_session_resumption(ssl::context& ctx, const TlsConfig& config, TicketKeys& keys);
+} // namespace battleship
+
+#endif // BATTLESHIP_SERVER_TLS_HPP
@@ -0,0 +1,62 @@
+#include <algorithm>
+#include <stdexcept>
+#include <openssl/crypto.h>
+#include <openssl/rand.h>
+#include "uuid_generator.hpp"
+
+namespace battleship {
+	namespace {
+		void random_bytes(std::span<u8> bytes) {
+			if (RAND_bytes(bytes.data(), static_cast<int>(bytes.size())) != 1) {
+				throw std::runtime_error("RAND_bytes() failed to generate UUIDs");
+			}
+		}
+	} // namespace
+
+	UuidGenerator::~UuidGenerator() {
+		OPENSSL_cleanse(batch_.data(), batch_.size());
+	}
+
+	UuidGenerator& UuidGenerator::local() {
+		thread_local UuidGenerator generator;
+		return generator;
+	}
+
+	void UuidGenerator::refill() {
+		random_bytes(batch_);
+		used_ = 0;
+	}
+
+	void UuidGenerator::fill(std::span<u8> bytes) {
+		// Big requests don't go through the batch
+		if (bytes.size() >= BATCH_SIZE) {
+			return random_bytes(bytes);
+		}
+		while (!bytes.empty()) {
+			if (used_ == BATCH_SIZE) {
+				refill();
+			}
+			size_t count = std::min(bytes.size(), BATCH_SIZE - used_);
+			std::copy_n(batch_.begin() + static_cast<std::ptrdiff_t>(used_), count, bytes.begin());
+			// Handed out tokens must not stay in memory
+			OPENSSL_cleanse(&batch_[used_], count);
+			used_ += count;
+			bytes = bytes.subspan(count);
+		}
+	}
+
+	UUID UuidGenerator::operator()() {
+		UUID uuid {};
+		fill({uuid.begin(), uuid.size()});
+		// RFC 4122: variant 1, version 4 (random)
+		uuid.data[8] = static_cast<u8>((uuid.data[8] & 0x3F) | 0x80);
+		uuid.data[6] = static_cast<u8>((uuid.data[6] & 0x0F) | 0x40);
+		return uuid;
+	}
+
+	void UuidGenerator::generate(std::span<UUID> uuids) {
+		for (UUID& uuid: uuids) {
+			uuid = (*this)();
+		}
+	}
+} // namespace battleship
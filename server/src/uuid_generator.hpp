@@ -0,0 +1,44 @@
+#ifndef BATTLESHIP_SERVER_UUID_GENERATOR_HPP
+#define BATTLESHIP_SERVER_UUID_GENERATOR_HPP
+
+#include <array>
+#include <span>
+#include "game.hpp"
+
+namespace battleship {
+	// Generator of random (version 4) UUIDs, which are used as session tokens.
+	// Bytes come from OpenSSL's CSPRNG, which reseeds itself, BATCH_SIZE bytes per RAND_bytes()
+	// call, so minting a UUID is a copy out of the batch most of the time
+	// instead of seeding a new MT19937 from the OS every time.
+	// Not thread safe, every thread uses its own instance via `local()`.
+	class UuidGenerator {
+	public:
+		// 256 UUIDs
+		static constexpr size_t BATCH_SIZE = 4096;
+
+		UuidGenerator() = default;
+		UuidGenerator(const UuidGenerator&) = delete;
+		UuidGenerator& operator=(const UuidGenerator&) = delete;
+		~UuidGenerator();
+
+		UUID operator()();
+
+		// Mints UUIDs in bulk
+		void generate(std::span<UUID> uuids);
+
+		// Fills the buffer with random bytes
+		void fill(std::span<u8> bytes);
+
+		// Generator of the calling thread
+		static UuidGenerator& local();
+
+	private:
+		std::array<u8, BATCH_SIZE> batch_ {};
+		// bytes of `batch_` already handed out
+		size_t used_ {BATCH_SIZE};
+
+		void refill();
+	};
+} // namespace battleship
+
+#endif // BATTLESHIP_SERVER_UUID_GENERATOR_HPP
@@ -0,0 +1,74 @@
+#include <optional>
+#include <variant>
+#include <vector>
+#include <gtest/gtest.h>
+#include "game_store.hpp"
+#include "pch.hpp"
+#include "test_util.hpp"
+
+namespace battleship {
+	namespace {
+		using test::make_uuid;
+		using Field = PostSovietGame::Field;
+
+		// Cells of the field without ships
+		std::vector<Position> empty_cells(const Field& field) {
+			std::vector<Position> cells;
+			for (size_t i = 0; i < PostSovietGame::GameGrid::SIZE; ++i) {
+				Position pos = PostSovietGame::GameGrid::position(i);
+				if (!field.grid.has_ship(pos)) {
+					cells.push_back(pos);
+				}
+			}
+			return cells;
+		}
+
+		// A human against an easy bot, the human has the move
+		class BotBatchTest: public ::testing::Test {
+		protected:
+			GameStore store;
+			const UUID human = make_uuid(1);
+			const UUID bot = make_uuid(2);
+			std::vector<Position> misses;
+
+			void SetUp() override {
+				PostSovietGame::FleetGen fleet {42};
+				Field bot_field = fleet();
+				misses = empty_cells(bot_field);
+				store.add_player(human, Player{fleet()});
+				ASSERT_TRUE(store.create_bot_room(
+					human, bot, Player{std::move(bot_field)}, make_bot(PostSovietGame{}, BotLevel::Easy, 7)
+				));
+			}
+		};
+
+		// The bot answers a shot before the next operation of the batch, as it does
+		// before a single /shoot returns
+		TEST_F(BotBatchTest, BotAnswersBeforeNextStatus) {
+			std::vector<BatchOp> ops {
+				{BatchOp::Kind::Shoot, human, misses[0], {}},
+				{BatchOp::Kind::Status, human, {}, {}}
+			};
+			auto results = store.batch(ops);
+			ASSERT_TRUE(std::holds_alternative<bool>(results[0]));
+			EXPECT_FALSE(std::get<bool>(results[0]));
+			ASSERT_TRUE(std::holds_alternative<Status>(results[1]));
+			const auto& status = std::get<Status>(results[1]);
+			EXPECT_EQ(status.state, Status::State::YourMove);
+			EXPECT_FALSE(status.enemy_move.empty());
+		}
+
+		TEST_F(BotBatchTest, BotAnswersBeforeNextShot) {
+			std::vector<BatchOp> ops {
+				{BatchOp::Kind::Shoot, human, misses[0], {}},
+				{BatchOp::Kind::Shoot, human, misses[1], {}},
+				{BatchOp::Kind::Shoot, human, misses[2], {}}
+			};
+			auto results = store.batch(ops);
+			for (const auto& result: results) {
+				ASSERT_TRUE(std::holds_alternative<bool>(result));
+				EXPECT_FALSE(std::get<bool>(result));
+			}
+		}
+	} // namespace
+} // namespace battleship
@@ -0,0 +1,85 @@
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <gtest/gtest.h>
+#include "persistence.hpp"
+#include "pch.hpp"
+#include "test_util.hpp"
+
+namespace battleship {
+	namespace {
+		namespace fs = std::filesystem;
+		using test::make_uuid;
+
+		// Journal of players 1..3 in segment 0 & 4..6 in segment 1, no snapshot
+		class RecoveryTest: public ::testing::Test {
+		protected:
+			fs::path dir;
+
+			void SetUp() override {
+				dir = fs::temp_directory_path()
+					/ ("battleship-recovery-" + std::string{::testing::UnitTest::GetInstance()->current_test_info()->name()});
+				fs::remove_all(dir);
+				GameStore store;
+				PostSovietGame::FleetGen fleet {42};
+				Journal journal {dir, 0, std::chrono::milliseconds{1}};
+				store.set_journal(&journal);
+				for (u64 i = 1; i <= 6; ++i) {
+					store.add_player(make_uuid(i), Player{fleet()});
+					if (i == 3) {
+						journal.rotate();
+					}
+				}
+				journal.flush();
+				store.set_journal(nullptr);
+			}
+
+			void TearDown() override {
+				fs::remove_all(dir);
+			}
+
+			void append(u64 segment, std::string_view bytes) const {
+				std::ofstream file {Journal::segment_path(dir, segment), std::ios::binary | std::ios::app};
+				file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+			}
+
+			void flip_byte(u64 segment, std::streamoff at) const {
+				std::fstream file {Journal::segment_path(dir, segment), std::ios::binary | std::ios::in | std::ios::out};
+				file.seekg(at);
+				char byte = 0;
+				file.get(byte);
+				file.seekp(at);
+				file.put(static_cast<char>(byte ^ 0x40));
+			}
+		};
+
+		TEST_F(RecoveryTest, CutsTornTailOfLastSegment) {
+			auto size = fs::file_size(Journal::segment_path(dir, 1));
+			// Header of a record whose body never made it to the disk
+			append(1, std::string_view{"\x20\x00\x00\x00\x12\x34", 6});
+			GameStore store;
+			Recovery recovery = recover(store, dir);
+			EXPECT_EQ(recovery.segments, 2U);
+			EXPECT_EQ(recovery.journal_records, 6U);
+			EXPECT_EQ(recovery.torn_bytes, 6U);
+			EXPECT_EQ(recovery.next_segment, 2U);
+			EXPECT_EQ(store.player_count(), 6U);
+			EXPECT_EQ(fs::file_size(Journal::segment_path(dir, 1)), size);
+
+			// The journal is whole again
+			GameStore again;
+			EXPECT_EQ(recover(again, dir).torn_bytes, 0U);
+			EXPECT_EQ(again.player_count(), 6U);
+		}
+
+		TEST_F(RecoveryTest, ThrowsOnCorruptedEarlierSegment) {
+			// In the payload of the last record of segment 0, which fails its CRC
+			auto size = fs::file_size(Journal::segment_path(dir, 0));
+			flip_byte(0, static_cast<std::streamoff>(size) - 1);
+			GameStore store;
+			EXPECT_THROW(recover(store, dir), std::runtime_error);
+			// Nothing is cut off, the history is left for a human to look at
+			EXPECT_EQ(fs::file_size(Journal::segment_path(dir, 0)), size);
+		}
+	} // namespace
+} // namespace battleship
@@ -0,0 +1,249 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <gtest/gtest.h>
+#include "server.hpp"
+#include "pch.hpp"
+
+// Every allocation of the process is counted while `counting` is set
+namespace {
+	std::atomic<bool> counting {false};
+	std::atomic<size_t> allocations {0};
+
+	void* counted_new(std::size_t size) {
+		if (counting.load(std::memory_order_relaxed)) {
+			allocations.fetch_add(1, std::memory_order_relaxed);
+		}
+		if (void* p = std::malloc(size == 0 ? 1 : size)) {
+			return p;
+		}
+		throw std::bad_alloc{};
+	}
+
+	void* counted_new(std::size_t size, std::align_val_t align) {
+		if (counting.load(std::memory_order_relaxed)) {
+			allocations.fetch_add(1, std::memory_order_relaxed);
+		}
+		auto alignment = static_cast<std::size_t>(align);
+		if (void* p = std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment)) {
+			return p;
+		}
+		throw std::bad_alloc{};
+	}
+} // namespace
+
+void* operator new(std::size_t size) { return counted_new(size); }
+void* operator new[](std::size_t size) { return counted_new(size); }
+void* operator new(std::size_t size, std::align_val_t align) { return counted_new(size, align); }
+void* operator new[](std::size_t size, std::align_val_t align) { return counted_new(size, align); }
+void* operator new(std::size_t size, const std::nothrow_t& /*tag*/) noexcept {
+	try { return counted_new(size); } catch (...) { return nullptr; }
+}
+void* operator new[](std::size_t size, const std::nothrow_t& /*tag*/) noexcept {
+	try { return counted_new(size); } catch (...) { return nullptr; }
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t /*size*/) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t /*size*/) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t /*align*/) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t /*align*/) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t /*size*/, std::align_val_t /*align*/) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t /*size*/, std::align_val_t /*align*/) noexcept { std::free(p); }
+
+namespace battleship::test {
+	namespace {
+		namespace net = boost::asio;
+		using tcp = net::ip::tcp;
+
+		// Blocking keep-alive HTTP client, which doesn't allocate once connected
+		class Client {
+		public:
+			explicit Client(u16 port): fd_{::socket(AF_INET, SOCK_STREAM, 0)} {
+				sockaddr_in addr {};
+				addr.sin_family = AF_INET;
+				addr.sin_port = htons(port);
+				addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+				int one = 1;
+				::setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+				connected_ = ::connect(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0;
+			}
+
+			Client(const Client&) = delete;
+			Client& operator=(const Client&) = delete;
+
+			~Client() {
+				::close(fd_);
+			}
+
+			[[nodiscard]] bool connected() const {
+				return connected_;
+			}
+
+			// Sends the whole request & returns the response's status line & body,
+			// which stay valid until the next call
+			[[nodiscard]] std::pair<std::string_view, std::string_view> exchange(std::string_view request) {
+				for (size_t sent = 0; sent < request.size();) {
+					ssize_t n = ::send(fd_, request.data() + sent, request.size() - sent, MSG_NOSIGNAL);
+					if (n <= 0) { return {}; }
+					sent += static_cast<size_t>(n);
+				}
+				size_t received = 0;
+				while (received < buffer_.size()) {
+					ssize_t n = ::recv(fd_, buffer_.data() + received, buffer_.size() - received, 0);
+					if (n <= 0) { return {}; }
+					received += static_cast<size_t>(n);
+					std::string_view response {buffer_.data(), received};
+					size_t header_end = response.find("\r\n\r\n");
+					if (header_end == std::string_view::npos) { continue; }
+					size_t body_size = content_length(response.substr(0, header_end));
+					if (received < header_end + 4 + body_size) { continue; }
+					return {response.substr(0, response.find("\r\n")), response.substr(header_end + 4, body_size)};
+				}
+				return {};
+			}
+
+		private:
+			int fd_;
+			bool connected_ {false};
+			std::array<char, 4096> buffer_ {};
+
+			static size_t content_length(std::string_view header) {
+				constexpr std::string_view FIELD = "Content-Length: ";
+				size_t at = header.find(FIELD);
+				if (at == std::string_view::npos) { return 0; }
+				size_t length = 0;
+				for (size_t i = at + FIELD.size(); i < header.size() && header[i] >= '0' && header[i] <= '9'; ++i) {
+					length = length * 10 + static_cast<size_t>(header[i] - '0');
+				}
+				return length;
+			}
+		};
+
+		std::string request(std::string_view method, std::string_view target, std::string_view body) {
+			std::string req;
+			req.append(method).append(" ").append(target).append(" HTTP/1.1\r\n")
+				.append("Host: 127.0.0.1\r\n")
+				.append("Content-Length: ").append(std::to_string(body.size())).append("\r\n\r\n")
+				.append(body);
+			return req;
+		}
+
+		std::string cbor_request(std::string_view method, std::string_view target, const json& body) {
+			std::vector<u8> cbor = json::to_cbor(body);
+			return request(method, target, {reinterpret_cast<const char*>(cbor.data()), cbor.size()});
+		}
+
+		// The session of a plain HTTP connection, served by one I/O thread
+		class PlainServer {
+		public:
+			PlainServer() {
+				state_.store.set_spectators(&state_.spectators);
+				port_ = listen_plain(ioc_, state_, {net::ip::address_v4::loopback(), 0}).port();
+				thread_ = std::thread{[this] { ioc_.run(); }};
+			}
+
+			PlainServer(const PlainServer&) = delete;
+			PlainServer& operator=(const PlainServer&) = delete;
+
+			~PlainServer() {
+				ioc_.stop();
+				thread_.join();
+			}
+
+			[[nodiscard]] u16 port() const {
+				return port_;
+			}
+
+		private:
+			ServerState state_;
+			net::io_context ioc_ {1};
+			u16 port_ {0};
+			std::thread thread_;
+		};
+
+		TEST(SessionAllocations, KeepAliveStatusAllocatesNothingAfterWarmUp) {
+			constexpr size_t WARM_UP = 64;
+			constexpr size_t REQUESTS = 1000;
+
+			PlainServer server;
+			Client client {server.port()};
+			ASSERT_TRUE(client.connected());
+
+			auto [start_status, start_body] = client.exchange(request("POST", "/start?auto&bot=easy", ""));
+			ASSERT_EQ(start_status, "HTTP/1.1 200 OK");
+			json started = json::from_cbor(start_body);
+			const std::string status_req = cbor_request("GET", "/status", {{"uuid", started["uuid"]}});
+
+			// Fills the pools & lets every lazily built structure settle
+			for (size_t i = 0; i < WARM_UP; ++i) {
+				ASSERT_EQ(client.exchange(status_req).first, "HTTP/1.1 200 OK");
+			}
+
+			size_t failed = 0;
+			allocations = 0;
+			counting = true;
+			for (size_t i = 0; i < REQUESTS; ++i) {
+				if (client.exchange(status_req).first != "HTTP/1.1 200 OK") { ++failed; }
+			}
+			counting = false;
+
+			EXPECT_EQ(failed, 0U);
+			EXPECT_EQ(allocations.load(), 0U) << "over " << REQUESTS << " keep-alive /status requests";
+		}
+
+		// Every turn shoots the next cell of the top rows, which can't hold the whole fleet,
+		// & fetches the whole field & the shots at it since revision 0, to which the bot has answered.
+		// The bot can't sink the fleet in that many turns either, so every request succeeds.
+		TEST(SessionAllocations, KeepAliveShootAndFieldAllocateNothingAfterWarmUp) {
+			constexpr size_t WARM_UP = 10;
+			constexpr size_t TURNS = 20;
+
+			PlainServer server;
+			Client client {server.port()};
+			ASSERT_TRUE(client.connected());
+
+			auto [start_status, start_body] = client.exchange(request("POST", "/start?auto&bot=easy", ""));
+			ASSERT_EQ(start_status, "HTTP/1.1 200 OK");
+			json uuid = json::from_cbor(start_body)["uuid"];
+			std::vector<std::string> shoot_reqs;
+			for (u8 cell = 0; cell < WARM_UP + TURNS; ++cell) {
+				json shot = json::array({cell / 10, cell % 10});
+				shoot_reqs.push_back(cbor_request("PATCH", "/shoot", {{"uuid", uuid}, {"shot", shot}}));
+			}
+			const std::string field_req = cbor_request("GET", "/field", {{"uuid", uuid}, {"version", 2}});
+			const std::string delta_req = cbor_request("GET", "/field?since=0", {{"uuid", uuid}, {"version", 2}});
+			const std::string delta_v1_req = cbor_request("GET", "/field?since=0", {{"uuid", uuid}});
+
+			size_t failed = 0;
+			auto turn = [&](const std::string& shoot_req) {
+				for (const std::string* req: {&shoot_req, &field_req, &delta_req, &delta_v1_req}) {
+					if (client.exchange(*req).first != "HTTP/1.1 200 OK") { ++failed; }
+				}
+			};
+			for (size_t i = 0; i < WARM_UP; ++i) {
+				turn(shoot_reqs[i]);
+			}
+			ASSERT_EQ(failed, 0U);
+
+			allocations = 0;
+			counting = true;
+			for (size_t i = WARM_UP; i < WARM_UP + TURNS; ++i) {
+				turn(shoot_reqs[i]);
+			}
+			counting = false;
+
+			EXPECT_EQ(failed, 0U);
+			EXPECT_EQ(allocations.load(), 0U) << "over " << TURNS << " turns of /shoot & /field";
+		}
+	} // namespace
+} // namespace battleship::test
@@ -0,0 +1,17 @@
+#ifndef BATTLESHIP_SERVER_TEST_UTIL_HPP
+#define BATTLESHIP_SERVER_TEST_UTIL_HPP
+
+#include "game.hpp"
+
+namespace battleship::test {
+	// Distinct UUIDs by number, the same on every run
+	inline UUID make_uuid(u64 n) {
+		UUID uuid {};
+		for (size_t i = 0; i < sizeof(n); ++i) {
+			uuid.data[i] = static_cast<u8>(n >> (8 * i));
+		}
+		return uuid;
+	}
+} // namespace battleship::test
+
+#endif // BATTLESHIP_SERVER_TEST_UTIL_HPP
@@ -0,0 +1,4 @@
+file(GLOB exe_sources
+	src/*.cpp
+	src/*.hpp
+)
@@ -0,0 +1,107 @@
+#include <charconv>
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+#include <span>
+#include <string_view>
+#include "tournament.hpp"
+
+namespace battleship {
+	namespace {
+		void print_usage() {
+			std::cerr << "Usage: battleship-simulator [options]\n"
+				"    --games N        number of games (default 1000000)\n"
+				"    --threads N      worker threads (default: all hardware threads)\n"
+				"    --bots A B       levels of both sides: easy, normal or hard (default normal normal)\n"
+				"    --rules R        post-soviet or american (default post-soviet)\n"
+				"    --seed N         seed of the whole tournament (default 0)\n"
+				"    --report-ms N    progress report interval (default 1000)\n"
+				"    --replay-out F   write every game to the replay file F, see battleship-replay\n";
+		}
+
+		template<typename T>
+		bool parse_number(std::string_view str, T& value) {
+			auto [end, error] = std::from_chars(str.data(), str.data() + str.size(), value);
+			return error == std::errc{} && end == str.data() + str.size();
+		}
+
+		template<u8 SHIP_TYPE_COUNT, const std::array<u8, SHIP_TYPE_COUNT>& RULES>
+		void run(TournamentConfig config, const char* replay_out) {
+			std::optional<ReplayFileWriter> writer;
+			if (replay_out != nullptr) {
+				config.replay_out = &writer.emplace(replay_out, ReplayFormat::of<10, 10, SHIP_TYPE_COUNT, RULES>());
+			}
+			Tournament<10, 10, SHIP_TYPE_COUNT, RULES> tournament {config};
+			auto start = std::chrono::steady_clock::now();
+			const auto elapsed = [&start] {
+				return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			};
+			auto stats = tournament.run([&](u64 done) {
+				std::cerr << done << " games, " << static_cast<u64>(static_cast<double>(done) / elapsed())
+					<< " games/s\n";
+			});
+			print_stats(std::cout, stats, elapsed());
+			if (writer.has_value()) {
+				writer->close();
+				std::cout << "replay bytes:     " << writer->bytes_written() << '\n';
+			}
+		}
+	} // namespace
+
+	int simulator_main(int argc, char** argv) {
+		const std::span<char*> args {argv, static_cast<size_t>(argc)};
+		TournamentConfig config;
+		std::string_view rules = "post-soviet";
+		const char* replay_out = nullptr;
+		for (size_t i = 1; i < args.size(); ++i) {
+			std::string_view arg = args[i];
+			bool has_value = i + 1 < args.size();
+			bool ok = has_value;
+			if (arg == "--games" && has_value) {
+				ok = parse_number(args[++i], config.games) && config.games <= UINT32_MAX;
+			} else if (arg == "--threads" && has_value) {
+				ok = parse_number(args[++i], config.threads) && config.threads > 0;
+			} else if (arg == "--bots" && i + 2 < args.size()) {
+				auto first = bot_level(args[++i]);
+				auto second = bot_level(args[++i]);
+				ok = first.has_value() && second.has_value();
+				if (ok) {
+					config.levels = {*first, *second};
+				}
+			} else if (arg == "--rules" && has_value) {
+				rules = args[++i];
+				ok = rules == "post-soviet" || rules == "american";
+			} else if (arg == "--seed" && has_value) {
+				ok = parse_number(args[++i], config.seed);
+			} else if (arg == "--report-ms" && has_value) {
+				u32 ms = 0;
+				ok = parse_number(args[++i], ms) && ms > 0;
+				config.report_every = std::chrono::milliseconds{ms};
+			} else if (arg == "--replay-out" && has_value) {
+				replay_out = args[++i];
+			} else {
+				ok = false;
+			}
+			if (!ok) {
+				print_usage();
+				return EXIT_FAILURE;
+			}
+		}
+
+		try {
+			if (rules == "american") {
+				run<AMERICAN_RULES.size(), AMERICAN_RULES>(config, replay_out);
+			} else {
+				run<POST_SOVIET_RULES.size(), POST_SOVIET_RULES>(config, replay_out);
+			}
+		} catch (const std::exception& e) {
+			std::cerr << e.what() << '\n';
+			return EXIT_FAILURE;
+		}
+		return EXIT_SUCCESS;
+	}
+} // namespace battleship
+
+int main(int argc, char** argv) {
+	return battleship::simulator_main(argc, argv);
+}
@@ -0,0 +1,239 @@
+#ifndef BATTLESHIP_SIMULATOR_TOURNAMENT_HPP
+#define BATTLESHIP_SIMULATOR_TOURNAMENT_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <vector>
+#include "battleship/common/bot.hpp"
+#include "battleship/common/common.hpp"
+#include "battleship/common/fleet_generator.hpp"
+#include "battleship/common/replay_file.hpp"
+#include "battleship/common/util/random.hpp"
+#include "tournament_stats.hpp"
+#include "work_range.hpp"
+
+namespace battleship {
+	struct TournamentConfig {
+		// At most 2^32 - 1
+		u64 games {1'000'000};
+		u32 threads {std::max(std::thread::hardware_concurrency(), 1U)};
+		// Bots of the first & the second side
+		std::array<BotLevel, 2> levels {BotLevel::Normal, BotLevel::Normal};
+		u64 seed {0};
+		std::chrono::milliseconds report_every {1000};
+		// Every game is written there, if given; the writer must outlive the tournament
+		ReplayFileWriter* replay_out {nullptr};
+	};
+
+	// Plays bot vs bot games in-process on a pool of threads.
+	// Every worker owns a range of game indices & steals halves of other ranges when
+	// its own one is empty (see `WorkRange`), so the load stays balanced without locks.
+	// Game i is seeded from (seed, i) only, so results don't depend on scheduling.
+	// Each worker keeps its own stats & game state in its own cache lines,
+	// so workers share nothing but the ranges & scale with cores.
+	template<u8 ROWS, u8 COLS, u8 SHIP_TYPE_COUNT, const std::array<u8, SHIP_TYPE_COUNT>& RULES>
+	class Tournament {
+	public:
+		using Field = PlayerField<ROWS, COLS, SHIP_TYPE_COUNT, RULES>;
+		using Player = Bot<ROWS, COLS, SHIP_TYPE_COUNT, RULES>;
+		using Stats = TournamentStats<Grid<ROWS, COLS>::SIZE>;
+		using Replay = GameReplay<ROWS, COLS, SHIP_TYPE_COUNT, RULES>;
+
+		// Games a worker takes from its range at once
+		static constexpr u32 BATCH = 64;
+
+		explicit Tournament(const TournamentConfig& config):
+			config_{config},
+			workers_(std::max(config.threads, 1U))
+		{
+			auto games = static_cast<u32>(std::min<u64>(config.games, UINT32_MAX));
+			auto count = static_cast<u32>(workers_.size());
+			for (u32 i = 0; i < count; ++i) {
+				workers_[i].range.reset(
+					static_cast<u32>(u64{games} * i / count),
+					static_cast<u32>(u64{games} * (i + 1) / count)
+				);
+			}
+		}
+
+		// Plays all games. Meanwhile calls `report(games_done)` on the calling thread
+		// every `report_every`.
+		template<typename Report>
+		Stats run(Report&& report) {
+			{
+				std::vector<std::jthread> threads;
+				threads.reserve(workers_.size());
+				for (size_t i = 0; i < workers_.size(); ++i) {
+					threads.emplace_back([this, i] { work(i); });
+				}
+				// Polls often enough not to oversleep the end of the tournament
+				const auto poll = std::min<std::chrono::milliseconds>(config_.report_every, std::chrono::milliseconds{10});
+				auto next_report = std::chrono::steady_clock::now() + config_.report_every;
+				while (!is_finished()) {
+					std::this_thread::sleep_for(poll);
+					if (std::chrono::steady_clock::now() >= next_report) {
+						report(games_done());
+						next_report += config_.report_every;
+					}
+				}
+			}
+			Stats total;
+			for (const Worker& worker: workers_) {
+				total.merge(worker.stats);
+			}
+			return total;
+		}
+
+		[[nodiscard]] u64 games_done() const {
+			u64 sum = 0;
+			for (const Worker& worker: workers_) {
+				sum += worker.done.load(std::memory_order_relaxed);
+			}
+			return sum;
+		}
+
+	private:
+		// Everything a game needs, built in place for every game, so games don't allocate
+		struct Game {
+			std::array<Field, 2> fields;
+			std::array<std::optional<Player>, 2> players;
+		};
+
+		struct alignas(64) Worker {
+			WorkRange range;
+			std::atomic<u64> done {0};
+			std::atomic<bool> is_finished {false};
+			Stats stats;
+			Game game;
+			// Games to write, if they are written
+			Replay replay;
+			ReplayBlock block;
+		};
+
+		TournamentConfig config_;
+		std::vector<Worker> workers_;
+
+		[[nodiscard]] bool is_finished() const {
+			return std::all_of(workers_.begin(), workers_.end(), [](const Worker& worker) {
+				return worker.is_finished.load(std::memory_order_acquire);
+			});
+		}
+
+		void work(size_t me) {
+			Worker& worker = workers_[me];
+			for (;;) {
+				if (auto jobs = worker.range.take(BATCH)) {
+					for (u32 game = jobs->begin; game < jobs->end; ++game) {
+						play(worker, game);
+					}
+					worker.done.fetch_add(jobs->end - jobs->begin, std::memory_order_relaxed);
+					continue;
+				}
+				if (!steal(me)) {
+					break;
+				}
+			}
+			if (config_.replay_out != nullptr) {
+				config_.replay_out->write(worker.block);
+			}
+			worker.is_finished.store(true, std::memory_order_release);
+		}
+
+		// Moves half of the fullest range of another worker into ours.
+		// Returns false if there is nothing left anywhere. Jobs which are being moved
+		// by another thief at the moment are skipped, but that thief will play them anyway.
+		bool steal(size_t me) {
+			for (;;) {
+				size_t victim = workers_.size();
+				u32 most = 0;
+				for (size_t i = 0; i < workers_.size(); ++i) {
+					u32 size = workers_[i].range.size();
+					if (i != me && size > most) {
+						most = size;
+						victim = i;
+					}
+				}
+				if (victim == workers_.size()) {
+					return false;
+				}
+				if (auto jobs = workers_[victim].range.steal()) {
+					workers_[me].range.reset(jobs->begin, jobs->end);
+					return true;
+				}
+			}
+		}
+
+		void play(Worker& worker, u32 index) {
+			Xoshiro256 rng {config_.seed ^ (index * 0x9E3779B97F4A7C15ULL)};
+			Game& game = worker.game;
+			for (size_t side = 0; side < 2; ++side) {
+				game.fields[side] = FleetGenerator<ROWS, COLS, SHIP_TYPE_COUNT, RULES>{rng()}();
+				game.players[side].emplace(config_.levels[side], rng());
+			}
+
+			// Sides take turns to move first
+			size_t first = index % 2;
+			size_t shooter = first;
+			std::array<size_t, 2> shots {};
+			const bool is_recorded = config_.replay_out != nullptr;
+			worker.replay.shots.clear();
+			for (;;) {
+				Grid<ROWS, COLS>& target = game.fields[1 - shooter].grid;
+				Position pos = game.players[shooter]->next_shot();
+				target.place_shot(pos);
+				bool hit = target.has_ship(pos);
+				game.players[shooter]->observe(pos, hit);
+				++shots[shooter];
+				if (is_recorded) {
+					worker.replay.shots.push_back(static_cast<u8>(Grid<ROWS, COLS>::index(pos)));
+				}
+				if (hit && target.all_ships_shot()) {
+					break;
+				}
+				if (!hit) {
+					shooter = 1 - shooter;
+				}
+			}
+
+			Stats& stats = worker.stats;
+			++stats.games;
+			stats.shots += shots[0] + shots[1];
+			++stats.wins[shooter];
+			stats.first_move_wins += (shooter == first) ? 1 : 0;
+			++stats.winner_shots[shots[shooter]];
+			if (is_recorded) {
+				record(worker, index, first);
+			}
+		}
+
+		// Appends the game just played to the worker's block, writes the block once it's full.
+		// The game id is its index, so the file is ordered by workers, not by games.
+		void record(Worker& worker, u32 index, size_t first) {
+			Replay& replay = worker.replay;
+			replay.id = {};
+			for (size_t byte = 0; byte < sizeof(index); ++byte) {
+				replay.id[byte] = static_cast<u8>(index >> (8 * byte));
+			}
+			replay.finished_at = static_cast<u64>(std::chrono::duration_cast<std::chrono::milliseconds>(
+				std::chrono::system_clock::now().time_since_epoch()
+			).count());
+			replay.first = static_cast<u8>(first);
+			for (size_t side = 0; side < 2; ++side) {
+				replay.ships[side] = worker.game.fields[side].ships;
+			}
+			replay.encode(worker.block.bytes);
+			++worker.block.games;
+			if (worker.block.is_full()) {
+				config_.replay_out->write(worker.block);
+				worker.block.clear();
+			}
+		}
+	};
+} // namespace battleship
+
+#endif // BATTLESHIP_SIMULATOR_TOURNAMENT_HPP
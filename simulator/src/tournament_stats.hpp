@@ -0,0 +1,69 @@
+#ifndef BATTLESHIP_SIMULATOR_TOURNAMENT_STATS_HPP
+#define BATTLESHIP_SIMULATOR_TOURNAMENT_STATS_HPP
+
+#include <algorithm>
+#include <array>
+#include <iomanip>
+#include <optional>
+#include <ostream>
+#include "battleship/common/util/num_types.hpp"
+
+namespace battleship {
+	// Aggregate results, games aren't stored one by one
+	template<size_t MAX_SHOTS>
+	struct TournamentStats {
+		u64 games {0};
+		// Shots of both sides
+		u64 shots {0};
+		std::array<u64, 2> wins {};
+		// Games won by the side which moved first
+		u64 first_move_wins {0};
+		// Games won because the enemy ran out of time, bots never do
+		u64 forfeits {0};
+		// Games by number of shots made by the winner
+		std::array<u64, MAX_SHOTS + 1> winner_shots {};
+
+		void merge(const TournamentStats& other) {
+			games += other.games;
+			shots += other.shots;
+			wins[0] += other.wins[0];
+			wins[1] += other.wins[1];
+			first_move_wins += other.first_move_wins;
+			forfeits += other.forfeits;
+			for (size_t i = 0; i < winner_shots.size(); ++i) {
+				winner_shots[i] += other.winner_shots[i];
+			}
+		}
+	};
+
+	// Prints the stats of games played (or scanned) in `seconds`, if known
+	template<size_t MAX_SHOTS>
+	void print_stats(std::ostream& os, const TournamentStats<MAX_SHOTS>& stats, std::optional<double> seconds) {
+		auto games = static_cast<double>(std::max<u64>(stats.games, 1));
+		u64 winner_shots = 0;
+		for (size_t shots = 0; shots < stats.winner_shots.size(); ++shots) {
+			winner_shots += shots * stats.winner_shots[shots];
+		}
+		os << std::fixed << std::setprecision(4)
+			<< "games:            " << stats.games << '\n';
+		if (seconds.has_value()) {
+			os << "games/s:          " << static_cast<double>(stats.games) / *seconds << '\n';
+		}
+		os << "first side wins:  " << static_cast<double>(stats.wins[0]) / games << '\n'
+			<< "second side wins: " << static_cast<double>(stats.wins[1]) / games << '\n'
+			<< "first move wins:  " << static_cast<double>(stats.first_move_wins) / games << '\n';
+		if (stats.forfeits != 0) {
+			os << "forfeits:         " << static_cast<double>(stats.forfeits) / games << '\n';
+		}
+		os << "shots per game:   " << static_cast<double>(stats.shots) / games << '\n'
+			<< "shots to win:     " << static_cast<double>(winner_shots) / games << '\n'
+			<< "shots to win histogram:\n";
+		for (size_t shots = 0; shots < stats.winner_shots.size(); ++shots) {
+			if (stats.winner_shots[shots] != 0) {
+				os << std::setw(5) << shots << ' ' << stats.winner_shots[shots] << '\n';
+			}
+		}
+	}
+} // namespace battleship
+
+#endif // BATTLESHIP_SIMULATOR_TOURNAMENT_STATS_HPP
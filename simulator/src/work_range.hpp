@@ -0,0 +1,71 @@
+#ifndef BATTLESHIP_SIMULATOR_WORK_RANGE_HPP
+#define BATTLESHIP_SIMULATOR_WORK_RANGE_HPP
+
+#include <atomic>
+#include <optional>
+#include "battleship/common/util/num_types.hpp"
+
+namespace battleship {
+	// Range of job indices [begin, end) of one worker packed into a single atomic word.
+	// The owner takes jobs from the front & thieves take the back half,
+	// each with one CAS, so an idle worker steals from busy ones without any locks.
+	class WorkRange {
+	public:
+		struct Jobs {
+			u32 begin, end;
+		};
+
+		// Only the owner may call it, when its range is empty
+		void reset(u32 begin, u32 end) {
+			packed_.store(pack(begin, end), std::memory_order_release);
+		}
+
+		// Takes up to `count` jobs from the front
+		std::optional<Jobs> take(u32 count) {
+			u64 old = packed_.load(std::memory_order_acquire);
+			for (;;) {
+				auto [begin, end] = unpack(old);
+				if (begin >= end) {
+					return {};
+				}
+				u32 taken_end = (end - begin > count) ? begin + count : end;
+				if (packed_.compare_exchange_weak(old, pack(taken_end, end), std::memory_order_acq_rel)) {
+					return Jobs{begin, taken_end};
+				}
+			}
+		}
+
+		// Takes the back half of the jobs, at least one
+		std::optional<Jobs> steal() {
+			u64 old = packed_.load(std::memory_order_acquire);
+			for (;;) {
+				auto [begin, end] = unpack(old);
+				if (begin >= end) {
+					return {};
+				}
+				u32 middle = begin + (end - begin) / 2;
+				if (packed_.compare_exchange_weak(old, pack(begin, middle), std::memory_order_acq_rel)) {
+					return Jobs{middle, end};
+				}
+			}
+		}
+
+		[[nodiscard]] u32 size() const {
+			auto [begin, end] = unpack(packed_.load(std::memory_order_relaxed));
+			return (begin < end) ? end - begin : 0;
+		}
+
+	private:
+		std::atomic<u64> packed_ {0};
+
+		static constexpr u64 pack(u32 begin, u32 end) {
+			return (static_cast<u64>(end) << 32) | begin;
+		}
+
+		static constexpr Jobs unpack(u64 packed) {
+			return {static_cast<u32>(packed), static_cast<u32>(packed >> 32)};
+		}
+	};
+} // namespace battleship
+
+#endif // BATTLESHIP_SIMULATOR_WORK_RANGE_HPP
@@ -0,0 +1,250 @@
+// Reads replay files written by the server's archive or by `battleship-simulator --replay-out`:
+// computes statistics of all games in parallel, or shows a single game at any move.
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "battleship/common/replay_file.hpp"
+#include "tournament_stats.hpp"
+
+namespace battleship {
+	namespace {
+		constexpr u8 ROWS = 10;
+		constexpr u8 COLS = 10;
+
+		void print_usage() {
+			std::cerr << "Usage:\n"
+				"    battleship-replay stats [--threads N] FILE...\n"
+				"        statistics of all games of the files, scanned in parallel\n"
+				"    battleship-replay show FILE GAME [MOVE]\n"
+				"        both grids of the game (numbered from 0) after MOVE shots (default: all)\n";
+		}
+
+		template<typename T>
+		bool parse_number(std::string_view str, T& value) {
+			auto [end, error] = std::from_chars(str.data(), str.data() + str.size(), value);
+			return error == std::errc{} && end == str.data() + str.size();
+		}
+
+		// Calls `f.template operator()<SHIP_TYPE_COUNT, RULES>()` with the rules of the format,
+		// returns false if they are unknown
+		template<typename F>
+		bool with_rules(const ReplayFormat& format, F&& f) {
+			if (format == ReplayFormat::of<ROWS, COLS, POST_SOVIET_RULES.size(), POST_SOVIET_RULES>()) {
+				f.template operator()<POST_SOVIET_RULES.size(), POST_SOVIET_RULES>();
+			} else if (format == ReplayFormat::of<ROWS, COLS, AMERICAN_RULES.size(), AMERICAN_RULES>()) {
+				f.template operator()<AMERICAN_RULES.size(), AMERICAN_RULES>();
+			} else {
+				return false;
+			}
+			return true;
+		}
+
+		// Block of one of the files, the unit of parallel work
+		struct Job {
+			size_t file;
+			size_t block;
+		};
+
+		template<u8 SHIP_TYPE_COUNT, const std::array<u8, SHIP_TYPE_COUNT>& RULES>
+		void scan(const std::vector<std::unique_ptr<ReplayFile>>& files, u32 thread_count) {
+			using Replay = GameReplay<ROWS, COLS, SHIP_TYPE_COUNT, RULES>;
+			using Stats = TournamentStats<Grid<ROWS, COLS>::SIZE>;
+
+			std::vector<Job> jobs;
+			for (size_t file = 0; file < files.size(); ++file) {
+				for (size_t block = 0; block < files[file]->block_count(); ++block) {
+					jobs.push_back({file, block});
+				}
+			}
+			auto start = std::chrono::steady_clock::now();
+			std::atomic<size_t> next_job {0};
+			std::vector<Stats> stats(thread_count);
+			std::vector<u64> unfinished(thread_count);
+			{
+				std::vector<std::jthread> threads;
+				for (u32 t = 0; t < thread_count; ++t) {
+					threads.emplace_back([&, t] {
+						Stats& mine = stats[t];
+						for (;;) {
+							size_t i = next_job.fetch_add(1, std::memory_order_relaxed);
+							if (i >= jobs.size()) { return; }
+							ReplayStream<ROWS, COLS, SHIP_TYPE_COUNT, RULES> stream {
+								*files[jobs[i].file], jobs[i].block, jobs[i].block + 1
+							};
+							while (auto game = stream.next()) {
+								typename Replay::Cursor cursor {*game};
+								while (cursor.step()) {}
+								auto winner = cursor.winner();
+								if (!winner.has_value()) {
+									++unfinished[t];
+									continue;
+								}
+								++mine.games;
+								mine.shots += cursor.move();
+								++mine.wins[*winner];
+								mine.first_move_wins += (*winner == game->first()) ? u64{1} : u64{0};
+								mine.forfeits += game->forfeit_winner().has_value() ? u64{1} : u64{0};
+								++mine.winner_shots[cursor.shots(*winner)];
+							}
+						}
+					});
+				}
+			}
+			Stats total;
+			u64 total_unfinished = 0;
+			for (u32 t = 0; t < thread_count; ++t) {
+				total.merge(stats[t]);
+				total_unfinished += unfinished[t];
+			}
+			double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			print_stats(std::cout, total, seconds);
+			if (total_unfinished != 0) {
+				std::cout << "without winner:   " << total_unfinished << '\n';
+			}
+		}
+
+		int stats(std::span<char*> args) {
+			u32 thread_count = std::max(std::thread::hardware_concurrency(), 1U);
+			std::vector<std::unique_ptr<ReplayFile>> files;
+			std::string_view first_path;
+			for (size_t i = 0; i < args.size(); ++i) {
+				std::string_view arg = args[i];
+				if (arg == "--threads") {
+					if (i + 1 == args.size() || !parse_number(std::string_view{args[++i]}, thread_count) || thread_count == 0) {
+						print_usage();
+						return EXIT_FAILURE;
+					}
+					continue;
+				}
+				files.push_back(std::make_unique<ReplayFile>(args[i]));
+				if (files.size() == 1) {
+					first_path = arg;
+				}
+				if (!files.back()->is_complete()) {
+					std::cerr << args[i] << " wasn't closed, its blocks were found without the index\n";
+				}
+				if (files.back()->format() != files.front()->format()) {
+					std::cerr << args[i] << " has games of other grid or rules than " << first_path << '\n';
+					return EXIT_FAILURE;
+				}
+			}
+			if (files.empty()) {
+				print_usage();
+				return EXIT_FAILURE;
+			}
+			bool known = with_rules(files.front()->format(), [&]<u8 SHIP_TYPE_COUNT, const std::array<u8, SHIP_TYPE_COUNT>& RULES>() {
+				scan<SHIP_TYPE_COUNT, RULES>(files, thread_count);
+			});
+			if (!known) {
+				std::cerr << "unknown grid or rules\n";
+				return EXIT_FAILURE;
+			}
+			return EXIT_SUCCESS;
+		}
+
+		template<u8 SHIP_TYPE_COUNT, const std::array<u8, SHIP_TYPE_COUNT>& RULES>
+		bool show_game(const ReplayFile& file, u64 number, std::optional<size_t> move) {
+			using Replay = GameReplay<ROWS, COLS, SHIP_TYPE_COUNT, RULES>;
+			size_t block = file.find_block(number);
+			if (block == file.block_count()) {
+				std::cerr << "the file has " << file.game_count() << " games\n";
+				return false;
+			}
+			ReplayStream<ROWS, COLS, SHIP_TYPE_COUNT, RULES> stream {file, block, block + 1};
+			for (u64 skipped = file.first_game(block); skipped < number; ++skipped) {
+				stream.next();
+			}
+			auto game = stream.next();
+			typename Replay::Cursor cursor {*game};
+			while (cursor.step()) {}
+			auto winner = cursor.winner();
+			size_t total = cursor.move();
+
+			std::cout << "id:          ";
+			for (u8 byte: game->id()) {
+				std::cout << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(byte);
+			}
+			std::cout << std::dec << std::setfill(' ') << '\n'
+				<< "finished at: " << game->finished_at() << " ms\n"
+				<< "first move:  side " << static_cast<int>(game->first()) << '\n'
+				<< "shots:       " << total << '\n'
+				<< "winner:      ";
+			if (winner.has_value()) {
+				std::cout << "side " << static_cast<int>(*winner)
+					<< (game->forfeit_winner().has_value() ? " by timeout" : "") << '\n';
+			} else {
+				std::cout << "none\n";
+			}
+
+			cursor.seek(move.value_or(total));
+			std::cout << "\nafter " << cursor.move() << " shots, ";
+			if (cursor.is_done() && winner.has_value()) {
+				std::cout << "game over\n";
+			} else {
+				std::cout << "side " << static_cast<int>(cursor.mover()) << " moves\n";
+			}
+			for (u8 side = 0; side < 2; ++side) {
+				std::cout << "side " << static_cast<int>(side) << ", " << cursor.shots(1 - side)
+					<< " shots at it\n" << cursor.grid(side);
+			}
+			return true;
+		}
+
+		int show(std::span<char*> args) {
+			u64 number = 0;
+			size_t move = 0;
+			if (args.size() < 2 || args.size() > 3
+			 || !parse_number(std::string_view{args[1]}, number)
+			 || (args.size() == 3 && !parse_number(std::string_view{args[2]}, move))) {
+				print_usage();
+				return EXIT_FAILURE;
+			}
+			ReplayFile file {args[0]};
+			bool shown = false;
+			bool known = with_rules(file.format(), [&]<u8 SHIP_TYPE_COUNT, const std::array<u8, SHIP_TYPE_COUNT>& RULES>() {
+				shown = show_game<SHIP_TYPE_COUNT, RULES>(
+					file, number, (args.size() == 3) ? std::optional<size_t>{move} : std::nullopt
+				);
+			});
+			if (!known) {
+				std::cerr << "unknown grid or rules\n";
+			}
+			return shown ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+	} // namespace
+
+	int replay_main(int argc, char** argv) {
+		const std::span<char*> args {argv, static_cast<size_t>(argc)};
+		if (args.size() < 2) {
+			print_usage();
+			return EXIT_FAILURE;
+		}
+		std::string_view command = args[1];
+		try {
+			if (command == "stats") {
+				return stats(args.subspan(2));
+			}
+			if (command == "show") {
+				return show(args.subspan(2));
+			}
+		} catch (const std::exception& e) {
+			std::cerr << e.what() << '\n';
+			return EXIT_FAILURE;
+		}
+		print_usage();
+		return EXIT_FAILURE;
+	}
+} // namespace battleship
+
+int main(int argc, char** argv) {
+	return battleship::replay_main(argc, argv);
+}